@@ -0,0 +1,125 @@
+#include "BatchRunner.h"
+#include "BufferedOutput.h"
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+
+BatchRunner::BatchRunner(std::istream& input, std::ostream& output, bool stopOnError, bool reportStatus)
+	: input(input), output(output), stopOnError(stopOnError), reportStatus(reportStatus) {}
+
+int BatchRunner::run(CommandProcessor& commandProcessor)
+{
+	std::string commandLine;
+	size_t lineNumber = 0;
+	int failures = 0;
+
+	while (std::getline(input, commandLine))
+	{
+		++lineNumber;
+		if (!commandLine.empty() && commandLine.back() == '\r')
+		{
+			commandLine.pop_back(); // scripts written on Windows
+		}
+
+		size_t start = commandLine.find_first_not_of(" \t");
+		if (start == std::string::npos || commandLine[start] == '#')
+		{
+			continue; // blank lines and comments
+		}
+		if (commandLine == "exit")
+		{
+			break;
+		}
+
+		try
+		{
+			if (commandLine == "help")
+			{
+				commandProcessor.showHelp();
+			}
+			else
+			{
+				commandProcessor.processCommand(commandLine);
+			}
+
+			if (reportStatus)
+			{
+				output << "[line " << lineNumber << "] OK\n";
+			}
+		}
+		catch (const std::exception& e)
+		{
+			++failures;
+			if (reportStatus)
+			{
+				output << "[line " << lineNumber << "] ERROR: " << e.what() << '\n';
+			}
+			else
+			{
+				output << "Error (line " << lineNumber << "): " << e.what() << '\n';
+			}
+
+			if (stopOnError)
+			{
+				break;
+			}
+		}
+	}
+
+	output.flush();
+	return failures == 0 ? 0 : 1;
+}
+
+int BatchRunner::runFromArguments(const std::vector<std::string>& args)
+{
+	// args[0] is "--batch"
+	if (args.size() < 2)
+	{
+		std::cerr << "Usage: --batch <file|-> [--stop-on-error] [--status]" << std::endl;
+		return 1;
+	}
+
+	bool stopOnError = false;
+	bool reportStatus = false;
+	for (size_t i = 2; i < args.size(); ++i)
+	{
+		if (args[i] == "--stop-on-error")
+		{
+			stopOnError = true;
+		}
+		else if (args[i] == "--status")
+		{
+			reportStatus = true;
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown batch option: " + args[i]);
+		}
+	}
+
+	std::ifstream scriptFile;
+	if (args[1] != "-")
+	{
+		scriptFile.open(args[1]);
+		if (!scriptFile.is_open())
+		{
+			throw std::runtime_error("Cannot open batch script: " + args[1]);
+		}
+	}
+	else
+	{
+		std::ios::sync_with_stdio(false); // stdin is only read through std::cin from here on
+	}
+	std::istream& script = args[1] == "-" ? std::cin : scriptFile;
+
+	// declared first so it outlives the processor, whose password manager reports while saving on exit
+	BufferedOutput sink(stdout);
+	int exitCode;
+	{
+		CommandProcessor commandProcessor(sink);
+		BatchRunner runner(script, sink, stopOnError, reportStatus);
+		exitCode = runner.run(commandProcessor);
+	}
+	sink.flush();
+	return exitCode;
+}
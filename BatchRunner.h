@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include "CommandProcessor.h"
+
+// Runs a script of commands without prompts. Results and errors share one
+// output stream so they stay in order, and nothing is flushed per line.
+class BatchRunner
+{
+private:
+	std::istream& input;
+	std::ostream& output;
+	bool stopOnError;   //abort the script at the first failing command
+	bool reportStatus;  //print "[line N] OK" / "[line N] ERROR: ..." after every command
+
+public:
+	BatchRunner(std::istream& input, std::ostream& output, bool stopOnError, bool reportStatus);
+
+	int run(CommandProcessor& commandProcessor); //exit code: 0 when every command succeeded
+
+	// --batch <file|-> [--stop-on-error] [--status]
+	static int runFromArguments(const std::vector<std::string>& args);
+};
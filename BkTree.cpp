@@ -0,0 +1,187 @@
+#include "BkTree.h"
+#include <algorithm>
+#include <cstring>
+
+BkTree::Pattern::Pattern(const std::string& text) : text(text)
+{
+	std::memset(positions, 0, sizeof(positions));
+	for (size_t i = 0; i < text.size() && i < 64; ++i)
+	{
+		positions[static_cast<unsigned char>(text[i])] |= uint64_t(1) << i;
+	}
+}
+
+int BkTree::Pattern::distance(const std::string& other) const
+{
+	const size_t m = text.size();
+	if (m == 0)
+	{
+		return static_cast<int>(other.size());
+	}
+
+	if (m > 64)
+	{
+		// longer than a word: the plain two-row table
+		std::vector<int> previous(m + 1), current(m + 1);
+		for (size_t i = 0; i <= m; ++i)
+		{
+			previous[i] = static_cast<int>(i);
+		}
+		for (size_t j = 1; j <= other.size(); ++j)
+		{
+			current[0] = static_cast<int>(j);
+			for (size_t i = 1; i <= m; ++i)
+			{
+				int substitution = previous[i - 1] + (text[i - 1] == other[j - 1] ? 0 : 1);
+				current[i] = std::min(std::min(previous[i] + 1, current[i - 1] + 1), substitution);
+			}
+			previous.swap(current);
+		}
+		return previous[m];
+	}
+
+	// Myers (1999) in Hyyro's formulation: Pv/Mv hold the +1/-1 vertical
+	// differences of the current column, score follows its last cell
+	const uint64_t last = uint64_t(1) << (m - 1);
+	uint64_t pv = ~uint64_t(0);
+	uint64_t mv = 0;
+	int score = static_cast<int>(m);
+	for (char c : other)
+	{
+		uint64_t eq = positions[static_cast<unsigned char>(c)];
+		uint64_t xv = eq | mv;
+		uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+		uint64_t ph = mv | ~(xh | pv);
+		uint64_t mh = pv & xh;
+		if (ph & last)
+		{
+			++score;
+		}
+		else if (mh & last)
+		{
+			--score;
+		}
+		ph = (ph << 1) | 1; // row 0 grows by one per character
+		mh <<= 1;
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+	}
+	return score;
+}
+
+void BkTree::insert(const std::string& key)
+{
+	auto existing = index.find(key);
+	if (existing != index.end())
+	{
+		if (!nodes[existing->second].alive)
+		{
+			nodes[existing->second].alive = true;
+			--dead;
+		}
+		return;
+	}
+
+	uint32_t added = static_cast<uint32_t>(nodes.size());
+	index.emplace(key, added);
+	if (nodes.empty())
+	{
+		nodes.push_back(Node{ key, true, {} });
+		return;
+	}
+
+	Pattern pattern(key);
+	uint32_t current = 0;
+	while (true)
+	{
+		int d = pattern.distance(nodes[current].key);
+		auto child = std::find_if(nodes[current].children.begin(), nodes[current].children.end(),
+			[d](const std::pair<int, uint32_t>& edge) { return edge.first == d; });
+		if (child == nodes[current].children.end())
+		{
+			nodes[current].children.push_back({ d, added });
+			break;
+		}
+		current = child->second;
+	}
+	nodes.push_back(Node{ key, true, {} });
+}
+
+void BkTree::erase(const std::string& key)
+{
+	auto existing = index.find(key);
+	if (existing == index.end() || !nodes[existing->second].alive)
+	{
+		return;
+	}
+	nodes[existing->second].alive = false;
+	++dead;
+	if (dead > index.size() - dead && dead > 64)
+	{
+		rebuild();
+	}
+}
+
+void BkTree::clear()
+{
+	nodes.clear();
+	index.clear();
+	dead = 0;
+}
+
+void BkTree::rebuild()
+{
+	std::vector<std::string> live;
+	for (const Node& node : nodes)
+	{
+		if (node.alive)
+		{
+			live.push_back(node.key);
+		}
+	}
+	clear();
+	for (const std::string& key : live)
+	{
+		insert(key);
+	}
+}
+
+std::vector<BkTree::Match> BkTree::find(const std::string& query, int maxDistance, size_t limit) const
+{
+	std::vector<Match> matches;
+	if (nodes.empty())
+	{
+		return matches;
+	}
+
+	Pattern pattern(query);
+	std::vector<uint32_t> pending{ 0 };
+	while (!pending.empty())
+	{
+		const Node& node = nodes[pending.back()];
+		pending.pop_back();
+
+		int d = pattern.distance(node.key);
+		if (node.alive && d <= maxDistance)
+		{
+			matches.push_back(Match{ node.key, d });
+		}
+		for (const auto& child : node.children)
+		{
+			if (child.first >= d - maxDistance && child.first <= d + maxDistance)
+			{
+				pending.push_back(child.second);
+			}
+		}
+	}
+
+	std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b)
+	{
+		return a.distance != b.distance ? a.distance < b.distance : a.key < b.key;
+	});
+	if (matches.size() > limit)
+	{
+		matches.resize(limit);
+	}
+	return matches;
+}
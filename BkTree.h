@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+// Burkhard-Keller tree of strings under edit distance, for "did you mean"
+// website suggestions. Every child hangs off its parent by its distance to
+// it, so by the triangle inequality a query within maxDistance of d only
+// descends into the children at d - maxDistance .. d + maxDistance.
+// Distances use Myers' bit-parallel algorithm: a column of the DP table per
+// machine word, one step per character of the other string.
+//
+// Erased keys stay in the tree as dead nodes until they outnumber the live
+// ones and the tree is rebuilt.
+class BkTree
+{
+public:
+	struct Match
+	{
+		std::string key;
+		int distance;
+	};
+
+	// one side of the distance, prepared once and compared against many others
+	class Pattern
+	{
+	private:
+		std::string text;
+		uint64_t positions[256]; //bit i set where text[i] is the character, first 64 characters
+
+	public:
+		explicit Pattern(const std::string& text);
+		int distance(const std::string& other) const; //Levenshtein
+	};
+
+private:
+	struct Node
+	{
+		std::string key;
+		bool alive;
+		std::vector<std::pair<int, uint32_t>> children; //distance to this node, child index
+	};
+
+	std::vector<Node> nodes; //nodes[0] is the root
+	std::unordered_map<std::string, uint32_t> index; //key -> node
+	size_t dead;
+
+	void rebuild();
+
+public:
+	BkTree() : dead(0) {}
+
+	void insert(const std::string& key); //revives an erased key
+	void erase(const std::string& key);
+	void clear();
+
+	// live keys within maxDistance, closest first, at most limit of them
+	std::vector<Match> find(const std::string& query, int maxDistance, size_t limit) const;
+	size_t size() const { return index.size() - dead; }
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+// Fixed-capacity hand-off between parallel producers and one consumer.
+// Producers tag every item with its sequence number and the consumer takes
+// them strictly in sequence order, so at most `capacity` items exist at once
+// no matter how far ahead a fast producer gets. close() releases everyone.
+template <typename T>
+class BoundedQueue
+{
+private:
+	std::vector<T> slots;
+	std::vector<bool> filled;
+	size_t nextToTake; //sequence number the consumer waits for
+	size_t total;      //sequence numbers run from 0 to total - 1
+	bool closed;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+
+public:
+	BoundedQueue(size_t capacity, size_t total)
+		: slots(capacity > 0 ? capacity : 1), filled(slots.size(), false), nextToTake(0), total(total), closed(false) {}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	// false when the queue was closed before the item could be stored
+	bool put(size_t sequence, T item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [this, sequence] { return closed || sequence < nextToTake + slots.size(); });
+		if (closed)
+		{
+			return false;
+		}
+
+		size_t slot = sequence % slots.size();
+		slots[slot] = std::move(item);
+		filled[slot] = true;
+		changed.notify_all();
+		return true;
+	}
+
+	// false once every item was taken or the queue was closed
+	bool take(T& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		size_t slot = nextToTake % slots.size();
+		changed.wait(lock, [this, slot] { return closed || nextToTake >= total || filled[slot]; });
+		if (closed || nextToTake >= total)
+		{
+			return false;
+		}
+
+		item = std::move(slots[slot]);
+		slots[slot] = T();
+		filled[slot] = false;
+		++nextToTake;
+		changed.notify_all();
+		return true;
+	}
+
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		changed.notify_all();
+	}
+};
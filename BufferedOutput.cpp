@@ -0,0 +1,73 @@
+#include "BufferedOutput.h"
+#include <cstring>
+
+BufferedOutput::Buffer::Buffer(std::FILE* file, size_t capacity) : file(file), storage(capacity > 0 ? capacity : 1)
+{
+	setp(storage.data(), storage.data() + storage.size());
+}
+
+bool BufferedOutput::Buffer::drain()
+{
+	size_t pending = static_cast<size_t>(pptr() - pbase());
+	if (pending > 0 && std::fwrite(pbase(), 1, pending, file) != pending)
+	{
+		return false;
+	}
+	setp(storage.data(), storage.data() + storage.size());
+	return true;
+}
+
+BufferedOutput::Buffer::int_type BufferedOutput::Buffer::overflow(int_type ch)
+{
+	if (!drain())
+	{
+		return traits_type::eof();
+	}
+	if (!traits_type::eq_int_type(ch, traits_type::eof()))
+	{
+		*pptr() = traits_type::to_char_type(ch);
+		pbump(1);
+	}
+	return traits_type::not_eof(ch);
+}
+
+std::streamsize BufferedOutput::Buffer::xsputn(const char* data, std::streamsize count)
+{
+	std::streamsize written = 0;
+	while (written < count)
+	{
+		std::streamsize room = epptr() - pptr();
+		if (room == 0)
+		{
+			if (!drain())
+			{
+				return written;
+			}
+			room = epptr() - pptr();
+		}
+
+		std::streamsize step = count - written < room ? count - written : room;
+		std::memcpy(pptr(), data + written, static_cast<size_t>(step));
+		pbump(static_cast<int>(step));
+		written += step;
+	}
+	return written;
+}
+
+int BufferedOutput::Buffer::sync()
+{
+	if (!drain())
+	{
+		return -1;
+	}
+	return std::fflush(file) == 0 ? 0 : -1;
+}
+
+BufferedOutput::BufferedOutput(std::FILE* file, size_t capacity) : std::ostream(nullptr), buffer(file, capacity)
+{
+	rdbuf(&buffer);
+}
+BufferedOutput::~BufferedOutput()
+{
+	flush();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+// Fully buffered stream over a C FILE*. Nothing reaches the file until the
+// buffer fills or flush() is called, so '\n' never costs a system call.
+class BufferedOutput : public std::ostream
+{
+private:
+	class Buffer : public std::streambuf
+	{
+	private:
+		std::FILE* file;
+		std::vector<char> storage;
+
+		bool drain();
+
+	protected:
+		int_type overflow(int_type ch) override;
+		std::streamsize xsputn(const char* data, std::streamsize count) override;
+		int sync() override;
+
+	public:
+		Buffer(std::FILE* file, size_t capacity);
+	};
+
+	Buffer buffer;
+
+public:
+	explicit BufferedOutput(std::FILE* file, size_t capacity = 1 << 20);
+	~BufferedOutput();
+
+	BufferedOutput(const BufferedOutput&) = delete;
+	BufferedOutput& operator=(const BufferedOutput&) = delete;
+};
@@ -0,0 +1,253 @@
+#include "BulkExporter.h"
+#include "BoundedQueue.h"
+#include "ThreadPool.h"
+#include <stdexcept>
+#include <memory>
+#include <thread>
+#include <exception>
+#include <cstdio>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+	bool writeFully(int fd, const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			ssize_t written = ::write(fd, data, size);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				return false;
+			}
+			data += written;
+			size -= static_cast<size_t>(written);
+		}
+		return true;
+	}
+}
+
+BulkExporter::BulkExporter(const std::vector<PasswordEntry>& entries, const std::vector<const Cipher*>& ciphers, Format format, bool decrypt)
+	: entries(entries), ciphers(ciphers), format(format), decrypt(decrypt) {}
+
+BulkExporter::Format BulkExporter::parseFormat(const std::string& name)
+{
+	if (name == "csv")
+	{
+		return CSV;
+	}
+	if (name == "jsonl")
+	{
+		return JSONL;
+	}
+	throw std::invalid_argument("Unknown export format: " + name + " (expected csv or jsonl)");
+}
+
+void BulkExporter::appendCsvField(std::string& out, const std::string& value)
+{
+	if (value.find_first_of(",\"\r\n") == std::string::npos)
+	{
+		out += value;
+		return;
+	}
+
+	out.push_back('"');
+	for (char c : value)
+	{
+		if (c == '"')
+		{
+			out.push_back('"');
+		}
+		out.push_back(c);
+	}
+	out.push_back('"');
+}
+
+void BulkExporter::appendJsonString(std::string& out, const std::string& value)
+{
+	static const char hexDigits[] = "0123456789abcdef";
+
+	out.push_back('"');
+	for (char c : value)
+	{
+		unsigned char byte = static_cast<unsigned char>(c);
+		if (c == '"' || c == '\\')
+		{
+			out.push_back('\\');
+			out.push_back(c);
+		}
+		else if (byte < 0x20)
+		{
+			out += "\\u00";
+			out.push_back(hexDigits[byte >> 4]);
+			out.push_back(hexDigits[byte & 0xF]);
+		}
+		else
+		{
+			out.push_back(c);
+		}
+	}
+	out.push_back('"');
+}
+
+std::string BulkExporter::header() const
+{
+	if (format == CSV)
+	{
+		return decrypt ? "website,username,password\n" : "website,username,encrypted_password\n";
+	}
+	return "";
+}
+
+std::string BulkExporter::formatChunk(size_t begin, size_t end) const
+{
+	// ciphers are not required to be thread-safe, every chunk clones the ones it needs
+	std::vector<std::unique_ptr<Cipher>> localCiphers(ciphers.size());
+	const char* passwordKey = decrypt ? "\"password\":" : "\"encrypted_password\":";
+
+	std::string out;
+	out.reserve((end - begin) * 64);
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		const PasswordEntry& entry = entries[i];
+		std::string password = entry.getPassword();
+		if (decrypt)
+		{
+			unsigned generation = entry.getGeneration();
+			if (generation >= ciphers.size() || ciphers[generation] == nullptr)
+			{
+				throw std::runtime_error("No cipher for generation " + std::to_string(generation) + ".");
+			}
+			if (!localCiphers[generation])
+			{
+				localCiphers[generation].reset(ciphers[generation]->clone());
+			}
+			password = localCiphers[generation]->decrypt(password);
+		}
+
+		if (format == CSV)
+		{
+			appendCsvField(out, entry.getWebsite());
+			out.push_back(',');
+			appendCsvField(out, entry.getUsername());
+			out.push_back(',');
+			appendCsvField(out, password);
+			out.push_back('\n');
+		}
+		else
+		{
+			out += "{\"website\":";
+			appendJsonString(out, entry.getWebsite());
+			out += ",\"username\":";
+			appendJsonString(out, entry.getUsername());
+			out.push_back(',');
+			out += passwordKey;
+			appendJsonString(out, password);
+			out += "}\n";
+		}
+	}
+	return out;
+}
+
+uint64_t BulkExporter::run(const std::string& path, JobControl& control) const
+{
+	// owner-only: with --decrypt the file holds every password in plaintext
+	int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0600);
+	if (fd < 0)
+	{
+		throw std::runtime_error("Cannot write export file: " + path);
+	}
+	if (::fchmod(fd, 0600) < 0) // O_CREAT leaves the mode of an existing file alone
+	{
+		::close(fd);
+		throw std::runtime_error("Cannot restrict the permissions of export file: " + path);
+	}
+
+	ThreadPool& pool = ThreadPool::shared();
+	const size_t chunkCount = (entries.size() + ENTRIES_PER_CHUNK - 1) / ENTRIES_PER_CHUNK;
+	BoundedQueue<std::string> queue(pool.size() * 2 + 2, chunkCount);
+
+	uint64_t written = 0;
+	std::exception_ptr writerError;
+
+	// the writer appends finished chunks in entry order while the pool formats the next ones
+	std::string head = header();
+	if (!writeFully(fd, head.data(), head.size()))
+	{
+		::close(fd);
+		std::remove(path.c_str());
+		throw std::runtime_error("Cannot write export file: " + path);
+	}
+	written += head.size();
+
+	std::thread writer([fd, &queue, &control, &written, &writerError]
+	{
+		try
+		{
+			std::string chunk;
+			while (queue.take(chunk))
+			{
+				control.checkpoint();
+				if (!writeFully(fd, chunk.data(), chunk.size()))
+				{
+					throw std::runtime_error("Write failed while exporting.");
+				}
+				written += chunk.size();
+				control.addBytes(chunk.size());
+			}
+		}
+		catch (...)
+		{
+			writerError = std::current_exception();
+			queue.close(); // unblock the producers
+		}
+	});
+
+	try
+	{
+		pool.parallelFor(chunkCount, [this, &queue, &control](size_t chunk)
+		{
+			control.checkpoint();
+			size_t begin = chunk * ENTRIES_PER_CHUNK;
+			size_t end = std::min(begin + ENTRIES_PER_CHUNK, entries.size());
+			if (!queue.put(chunk, formatChunk(begin, end)))
+			{
+				throw std::runtime_error("Export stopped.");
+			}
+			control.addEntries(end - begin);
+		});
+	}
+	catch (...)
+	{
+		queue.close();
+		writer.join();
+		::close(fd);
+		std::remove(path.c_str());
+		if (writerError)
+		{
+			std::rethrow_exception(writerError); // the real reason, e.g. a full disk or a cancel
+		}
+		throw;
+	}
+
+	writer.join();
+	bool closed = ::close(fd) == 0;
+	if (writerError || !closed)
+	{
+		std::remove(path.c_str());
+		if (writerError)
+		{
+			std::rethrow_exception(writerError);
+		}
+		throw std::runtime_error("Cannot write export file: " + path);
+	}
+	return written;
+}
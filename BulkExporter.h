@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Cipher.h"
+#include "PasswordEntry.h"
+#include "JobControl.h"
+
+// Streams vault entries to a CSV or JSON-lines file. Chunks of entries are
+// formatted (and optionally decrypted) in parallel on the shared pool while a
+// writer thread appends them in order through a BoundedQueue, so memory stays
+// at a few chunks regardless of the vault size.
+class BulkExporter
+{
+public:
+	enum Format { CSV, JSONL };
+
+private:
+	const std::vector<PasswordEntry>& entries;
+	std::vector<const Cipher*> ciphers; //indexed by entry generation, see PasswordManager::getCipherGenerations
+	Format format;
+	bool decrypt; //plaintext passwords instead of the stored ciphertext
+
+	static const size_t ENTRIES_PER_CHUNK = 16384;
+
+	std::string formatChunk(size_t begin, size_t end) const;
+	std::string header() const;
+
+	static void appendCsvField(std::string& out, const std::string& value);
+	static void appendJsonString(std::string& out, const std::string& value);
+
+public:
+	BulkExporter(const std::vector<PasswordEntry>& entries, const std::vector<const Cipher*>& ciphers, Format format, bool decrypt);
+
+	uint64_t run(const std::string& path, JobControl& control) const; //returns bytes written
+
+	static Format parseFormat(const std::string& name);
+};
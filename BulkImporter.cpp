@@ -0,0 +1,253 @@
+#include "BulkImporter.h"
+#include "ThreadPool.h"
+#include "Rekeyer.h"
+#include <fstream>
+#include <stdexcept>
+#include <memory>
+#include <algorithm>
+
+BulkImporter::BulkImporter(const std::string& path, Format format, const Cipher& cipher)
+	: path(path), format(format), cipher(cipher) {}
+
+BulkImporter::Format BulkImporter::parseFormat(const std::string& name)
+{
+	if (name == "csv")
+	{
+		return CSV;
+	}
+	if (name == "tsv")
+	{
+		return TSV;
+	}
+	throw std::invalid_argument("Unknown import format: " + name + " (expected csv or tsv)");
+}
+
+size_t BulkImporter::findChunkEnd(const std::string& data, size_t limit) const
+{
+	if (format == TSV)
+	{
+		size_t newline = data.rfind('\n', limit - 1);
+		return newline == std::string::npos ? std::string::npos : newline + 1;
+	}
+
+	// a newline inside a quoted CSV field is not a row boundary
+	size_t boundary = std::string::npos;
+	bool quoted = false;
+	for (size_t i = 0; i < limit; ++i)
+	{
+		if (data[i] == '"')
+		{
+			quoted = !quoted; // "" inside a field flips twice
+		}
+		else if (data[i] == '\n' && !quoted)
+		{
+			boundary = i + 1;
+		}
+	}
+	return boundary;
+}
+
+bool BulkImporter::nextRow(const std::string& text, size_t& pos, std::vector<std::string>& fields) const
+{
+	fields.clear();
+	if (pos >= text.size())
+	{
+		return false;
+	}
+
+	const char separator = format == CSV ? ',' : '\t';
+	std::string field;
+	bool quoted = false;
+
+	while (pos < text.size())
+	{
+		char c = text[pos++];
+		if (quoted)
+		{
+			if (c == '"')
+			{
+				if (pos < text.size() && text[pos] == '"')
+				{
+					field.push_back('"');
+					++pos;
+				}
+				else
+				{
+					quoted = false;
+				}
+			}
+			else
+			{
+				field.push_back(c);
+			}
+		}
+		else if (c == '"' && format == CSV && field.empty())
+		{
+			quoted = true;
+		}
+		else if (c == separator)
+		{
+			fields.push_back(field);
+			field.clear();
+		}
+		else if (c == '\n')
+		{
+			break;
+		}
+		else if (c != '\r')
+		{
+			field.push_back(c);
+		}
+	}
+
+	fields.push_back(field);
+	return true;
+}
+
+bool BulkImporter::isHeader(const std::vector<std::string>& fields)
+{
+	if (fields.size() != 3)
+	{
+		return false;
+	}
+
+	std::vector<std::string> names;
+	for (const std::string& field : fields)
+	{
+		std::string lowered = field;
+		std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](char c)
+		{
+			return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+		});
+		names.push_back(lowered);
+	}
+
+	return (names[0] == "website" || names[0] == "site" || names[0] == "url")
+		&& (names[1] == "username" || names[1] == "user" || names[1] == "login")
+		&& names[2] == "password";
+}
+
+void BulkImporter::parseChunk(Chunk& chunk) const
+{
+	// ciphers are not required to be thread-safe, every chunk gets its own copy
+	std::unique_ptr<Cipher> localCipher(cipher.clone());
+
+	std::vector<std::string> fields;
+	size_t pos = 0;
+	bool headerChecked = !chunk.first;
+
+	while (nextRow(chunk.text, pos, fields))
+	{
+		if (fields.size() == 1 && fields[0].empty())
+		{
+			continue; // blank line
+		}
+		if (!headerChecked)
+		{
+			headerChecked = true;
+			if (isHeader(fields))
+			{
+				continue;
+			}
+		}
+
+		++chunk.rows;
+		// a quoted CSV field may hold a line break, which would split the entry's vault line
+		if (fields.size() != 3 || fields[0].empty() || fields[1].empty() || fields[2].empty()
+			|| fields[0].find_first_of("|\n\r") != std::string::npos || fields[1].find_first_of("|\n\r") != std::string::npos)
+		{
+			++chunk.rejected;
+			continue;
+		}
+
+		// e.g. a character the TextCode reference text lacks, or one Hill folds or pads away
+		std::string encryptedPassword;
+		if (!Rekeyer::encryptLossless(*localCipher, fields[2], encryptedPassword))
+		{
+			++chunk.rejected;
+			continue;
+		}
+
+		chunk.entries.emplace_back(fields[0], fields[1], encryptedPassword);
+	}
+
+	chunk.text.clear();
+	chunk.text.shrink_to_fit();
+}
+
+std::vector<PasswordEntry> BulkImporter::run(JobControl& control, Stats& stats) const
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Cannot open import file: " + path);
+	}
+
+	file.seekg(0, std::ios::end);
+	control.setBytesTotal(static_cast<uint64_t>(file.tellg()));
+	file.seekg(0, std::ios::beg);
+
+	ThreadPool& pool = ThreadPool::shared();
+	const size_t chunksPerWave = std::max<size_t>(2, pool.size() * 2); //bounds how much raw text is held at once
+
+	std::vector<PasswordEntry> imported;
+	stats.rows = 0;
+	stats.rejected = 0;
+
+	std::string carry; //start of a row that did not fit in the previous chunk
+	bool firstChunk = true;
+	bool atEnd = false;
+
+	while (!atEnd)
+	{
+		// 1. read a wave of chunks, each ending on a row boundary
+		std::vector<Chunk> chunks;
+		while (!atEnd && chunks.size() < chunksPerWave)
+		{
+			control.checkpoint();
+
+			std::string data;
+			data.swap(carry);
+			size_t kept = data.size();
+			data.resize(kept + CHUNK_SIZE);
+			file.read(&data[kept], CHUNK_SIZE);
+			data.resize(kept + static_cast<size_t>(file.gcount()));
+			atEnd = !file;
+
+			size_t end = atEnd ? data.size() : findChunkEnd(data, data.size());
+			if (end == std::string::npos)
+			{
+				carry.swap(data); // a single row longer than a chunk, keep reading
+				continue;
+			}
+
+			carry.assign(data, end, std::string::npos);
+			data.resize(end);
+			if (!data.empty())
+			{
+				chunks.push_back(Chunk{ std::move(data), firstChunk, {}, 0, 0 });
+				firstChunk = false;
+			}
+		}
+
+		// 2. parse and encrypt the wave in parallel
+		pool.parallelFor(chunks.size(), [this, &chunks, &control](size_t i)
+		{
+			control.checkpoint();
+			uint64_t bytes = chunks[i].text.size();
+			parseChunk(chunks[i]);
+			control.addBytes(bytes);
+			control.addEntries(chunks[i].entries.size());
+		});
+
+		// 3. collect in file order
+		for (Chunk& chunk : chunks)
+		{
+			stats.rows += chunk.rows;
+			stats.rejected += chunk.rejected;
+			imported.insert(imported.end(), std::make_move_iterator(chunk.entries.begin()), std::make_move_iterator(chunk.entries.end()));
+		}
+	}
+
+	return imported;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Cipher.h"
+#include "PasswordEntry.h"
+#include "JobControl.h"
+
+// Reads a CSV/TSV dump of website,username,password rows and encrypts every
+// password with the vault cipher. The file is cut into chunks on row
+// boundaries, and chunks are parsed and encrypted in parallel on the shared pool.
+// Merging into the vault is left to PasswordManager::mergeEntries.
+class BulkImporter
+{
+public:
+	enum Format { CSV, TSV };
+
+	struct Stats
+	{
+		size_t rows;     //data rows seen, header excluded
+		size_t rejected; //malformed rows or values the vault format cannot hold
+	};
+
+private:
+	struct Chunk
+	{
+		std::string text;
+		bool first; //may start with a header row
+		std::vector<PasswordEntry> entries;
+		size_t rows;
+		size_t rejected;
+	};
+
+	std::string path;
+	Format format;
+	const Cipher& cipher;
+
+	static const size_t CHUNK_SIZE = 4 << 20;
+
+	size_t findChunkEnd(const std::string& data, size_t limit) const; //last row boundary before limit
+	void parseChunk(Chunk& chunk) const;
+	bool nextRow(const std::string& text, size_t& pos, std::vector<std::string>& fields) const;
+	static bool isHeader(const std::vector<std::string>& fields);
+
+public:
+	BulkImporter(const std::string& path, Format format, const Cipher& cipher);
+
+	std::vector<PasswordEntry> run(JobControl& control, Stats& stats) const;
+
+	static Format parseFormat(const std::string& name);
+};
@@ -1,4 +1,13 @@
 #include "CeasarCipher.h"
+#include "CipherRegistry.h"
+#include <stdexcept>
+#include <cstdlib>
+
+namespace
+{
+	const CipherRegistry::Registrar registrar(CipherType{ CeasarCipher::TYPE_ID, "caesar", "<shift>", 1, 1,
+		&CeasarCipher::fromParams, &CeasarCipher::decodeConfig, "Ceasar", &CeasarCipher::fromText });
+}
 
 char CeasarCipher::shiftChar(char ch, int shiftVal) const
 {
@@ -68,10 +77,53 @@ Cipher* CeasarCipher::clone() const
 }
 std::string CeasarCipher::getType() const
 {
-	return "Ceasar";
+	return "Caesar";
 }
 std::string CeasarCipher::getConfig() const
 {
 	return std::to_string(shift);
 }
+bool CeasarCipher::getSubstitution(unsigned char* table, bool decrypting) const
+{
+	for (int c = 0; c < 256; ++c)
+	{
+		table[c] = static_cast<unsigned char>(shiftChar(static_cast<char>(c), decrypting ? -shift : shift));
+	}
+	return true;
+}
+std::string CeasarCipher::encodeConfig() const
+{
+	std::string config;
+	CipherRegistry::appendInt32(config, shift);
+	return config;
+}
+
+Cipher* CeasarCipher::fromParams(const std::vector<std::string>& params)
+{
+	char* end;
+	long shift = std::strtol(params[0].c_str(), &end, 10);
+	if (*end != '\0' || end == params[0].c_str())
+	{
+		throw std::invalid_argument("Invalid shift parameter for Caesar cipher: " + params[0]);
+	}
+	return new CeasarCipher(static_cast<int>(shift));
+}
+Cipher* CeasarCipher::decodeConfig(const std::string& config)
+{
+	if (config.size() != 4)
+	{
+		throw std::runtime_error("Invalid Caesar cipher config");
+	}
+	return new CeasarCipher(CipherRegistry::readInt32(config, 0));
+}
+Cipher* CeasarCipher::fromText(const std::string& config)
+{
+	char* end;
+	long shift = std::strtol(config.c_str(), &end, 10);
+	if (*end != '\0' || end == config.c_str())
+	{
+		throw std::runtime_error("Invalid Caesar cipher config");
+	}
+	return new CeasarCipher(static_cast<int>(shift));
+}
 
@@ -18,7 +18,16 @@ public:
 	std::string getType() const override;
 	virtual std::string getConfig() const override;
 
+	uint8_t getTypeId() const override { return TYPE_ID; }
+	bool getSubstitution(unsigned char* table, bool decrypting) const override;
+	std::string encodeConfig() const override; //shift as int32
+
 	static void validateShift(int& shiftVal);
 
+	static const uint8_t TYPE_ID = 1;
+	static Cipher* fromParams(const std::vector<std::string>& params);
+	static Cipher* decodeConfig(const std::string& config);
+	static Cipher* fromText(const std::string& config);
+
 };
 
@@ -0,0 +1,325 @@
+#include "ChaCha20.h"
+#include <stdexcept>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHACHA20_X86 1
+#endif
+
+namespace
+{
+	inline uint32_t rotateLeft(uint32_t value, int bits)
+	{
+		return (value << bits) | (value >> (32 - bits));
+	}
+
+	inline uint32_t loadLittleEndian(const unsigned char* bytes)
+	{
+		return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+	}
+
+	inline void quarterRound(uint32_t* x, int a, int b, int c, int d)
+	{
+		x[a] += x[b]; x[d] = rotateLeft(x[d] ^ x[a], 16);
+		x[c] += x[d]; x[b] = rotateLeft(x[b] ^ x[c], 12);
+		x[a] += x[b]; x[d] = rotateLeft(x[d] ^ x[a], 8);
+		x[c] += x[d]; x[b] = rotateLeft(x[b] ^ x[c], 7);
+	}
+
+	// one 64-byte keystream block for the given counter
+	void scalarBlock(const uint32_t* input, uint32_t counter, unsigned char* out)
+	{
+		uint32_t x[16];
+		std::memcpy(x, input, sizeof(x));
+		x[12] = counter;
+
+		for (int round = 0; round < 10; ++round)
+		{
+			quarterRound(x, 0, 4, 8, 12);
+			quarterRound(x, 1, 5, 9, 13);
+			quarterRound(x, 2, 6, 10, 14);
+			quarterRound(x, 3, 7, 11, 15);
+			quarterRound(x, 0, 5, 10, 15);
+			quarterRound(x, 1, 6, 11, 12);
+			quarterRound(x, 2, 7, 8, 13);
+			quarterRound(x, 3, 4, 9, 14);
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t word = x[i] + (i == 12 ? counter : input[i]);
+			out[i * 4] = static_cast<unsigned char>(word);
+			out[i * 4 + 1] = static_cast<unsigned char>(word >> 8);
+			out[i * 4 + 2] = static_cast<unsigned char>(word >> 16);
+			out[i * 4 + 3] = static_cast<unsigned char>(word >> 24);
+		}
+	}
+
+	void xorScalar(const uint32_t* input, uint32_t counter, unsigned char* data, size_t blocks)
+	{
+		unsigned char keystream[ChaCha20::BLOCK_SIZE];
+		for (size_t b = 0; b < blocks; ++b, data += ChaCha20::BLOCK_SIZE)
+		{
+			scalarBlock(input, counter + static_cast<uint32_t>(b), keystream);
+			for (size_t i = 0; i < ChaCha20::BLOCK_SIZE; ++i)
+			{
+				data[i] ^= keystream[i];
+			}
+		}
+	}
+
+#ifdef CHACHA20_X86
+	// Every vector holds one state word of 4 consecutive blocks, so the rounds need no shuffles.
+#define SSE2_ROTATE(v, n) _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define SSE2_QUARTER(a, b, c, d) \
+	a = _mm_add_epi32(a, b); d = SSE2_ROTATE(_mm_xor_si128(d, a), 16); \
+	c = _mm_add_epi32(c, d); b = SSE2_ROTATE(_mm_xor_si128(b, c), 12); \
+	a = _mm_add_epi32(a, b); d = SSE2_ROTATE(_mm_xor_si128(d, a), 8); \
+	c = _mm_add_epi32(c, d); b = SSE2_ROTATE(_mm_xor_si128(b, c), 7);
+
+	__attribute__((target("sse2")))
+	void xorSse2(const uint32_t* input, uint32_t counter, unsigned char* data, size_t blocks)
+	{
+		for (; blocks >= 4; blocks -= 4, counter += 4, data += 4 * ChaCha20::BLOCK_SIZE)
+		{
+			__m128i start[16], x[16];
+			for (int i = 0; i < 16; ++i)
+			{
+				start[i] = _mm_set1_epi32(static_cast<int>(input[i]));
+			}
+			start[12] = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(counter)), _mm_set_epi32(3, 2, 1, 0));
+			std::memcpy(x, start, sizeof(x));
+
+			for (int round = 0; round < 10; ++round)
+			{
+				SSE2_QUARTER(x[0], x[4], x[8], x[12]);
+				SSE2_QUARTER(x[1], x[5], x[9], x[13]);
+				SSE2_QUARTER(x[2], x[6], x[10], x[14]);
+				SSE2_QUARTER(x[3], x[7], x[11], x[15]);
+				SSE2_QUARTER(x[0], x[5], x[10], x[15]);
+				SSE2_QUARTER(x[1], x[6], x[11], x[12]);
+				SSE2_QUARTER(x[2], x[7], x[8], x[13]);
+				SSE2_QUARTER(x[3], x[4], x[9], x[14]);
+			}
+
+			// transpose each group of 4 words so every block's 16 bytes are contiguous
+			for (int group = 0; group < 16; group += 4)
+			{
+				__m128i a = _mm_add_epi32(x[group], start[group]);
+				__m128i b = _mm_add_epi32(x[group + 1], start[group + 1]);
+				__m128i c = _mm_add_epi32(x[group + 2], start[group + 2]);
+				__m128i d = _mm_add_epi32(x[group + 3], start[group + 3]);
+
+				__m128i ab0 = _mm_unpacklo_epi32(a, b), ab1 = _mm_unpackhi_epi32(a, b);
+				__m128i cd0 = _mm_unpacklo_epi32(c, d), cd1 = _mm_unpackhi_epi32(c, d);
+				__m128i rows[4] =
+				{
+					_mm_unpacklo_epi64(ab0, cd0), _mm_unpackhi_epi64(ab0, cd0),
+					_mm_unpacklo_epi64(ab1, cd1), _mm_unpackhi_epi64(ab1, cd1)
+				};
+
+				for (int block = 0; block < 4; ++block)
+				{
+					__m128i* target = reinterpret_cast<__m128i*>(data + block * ChaCha20::BLOCK_SIZE + group * 4);
+					_mm_storeu_si128(target, _mm_xor_si128(_mm_loadu_si128(target), rows[block]));
+				}
+			}
+		}
+		xorScalar(input, counter, data, blocks);
+	}
+
+#define AVX2_QUARTER(a, b, c, d) \
+	a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rotate16); \
+	c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = _mm256_or_si256(_mm256_slli_epi32(b, 12), _mm256_srli_epi32(b, 20)); \
+	a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rotate8); \
+	c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = _mm256_or_si256(_mm256_slli_epi32(b, 7), _mm256_srli_epi32(b, 25));
+
+	__attribute__((target("avx2")))
+	void xorAvx2(const uint32_t* input, uint32_t counter, unsigned char* data, size_t blocks)
+	{
+		// byte shuffles rotate by 16 and 8 in one instruction
+		const __m256i rotate16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+			2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+		const __m256i rotate8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+			3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+
+		for (; blocks >= 8; blocks -= 8, counter += 8, data += 8 * ChaCha20::BLOCK_SIZE)
+		{
+			__m256i start[16], x[16];
+			for (int i = 0; i < 16; ++i)
+			{
+				start[i] = _mm256_set1_epi32(static_cast<int>(input[i]));
+			}
+			start[12] = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(counter)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+			std::memcpy(x, start, sizeof(x));
+
+			for (int round = 0; round < 10; ++round)
+			{
+				AVX2_QUARTER(x[0], x[4], x[8], x[12]);
+				AVX2_QUARTER(x[1], x[5], x[9], x[13]);
+				AVX2_QUARTER(x[2], x[6], x[10], x[14]);
+				AVX2_QUARTER(x[3], x[7], x[11], x[15]);
+				AVX2_QUARTER(x[0], x[5], x[10], x[15]);
+				AVX2_QUARTER(x[1], x[6], x[11], x[12]);
+				AVX2_QUARTER(x[2], x[7], x[8], x[13]);
+				AVX2_QUARTER(x[3], x[4], x[9], x[14]);
+			}
+
+			// 4x4 transposes inside each 128-bit lane: the low lane belongs to blocks 0-3, the high lane to 4-7
+			for (int group = 0; group < 16; group += 4)
+			{
+				__m256i a = _mm256_add_epi32(x[group], start[group]);
+				__m256i b = _mm256_add_epi32(x[group + 1], start[group + 1]);
+				__m256i c = _mm256_add_epi32(x[group + 2], start[group + 2]);
+				__m256i d = _mm256_add_epi32(x[group + 3], start[group + 3]);
+
+				__m256i ab0 = _mm256_unpacklo_epi32(a, b), ab1 = _mm256_unpackhi_epi32(a, b);
+				__m256i cd0 = _mm256_unpacklo_epi32(c, d), cd1 = _mm256_unpackhi_epi32(c, d);
+				__m256i rows[4] =
+				{
+					_mm256_unpacklo_epi64(ab0, cd0), _mm256_unpackhi_epi64(ab0, cd0),
+					_mm256_unpacklo_epi64(ab1, cd1), _mm256_unpackhi_epi64(ab1, cd1)
+				};
+
+				for (int block = 0; block < 4; ++block)
+				{
+					__m128i* low = reinterpret_cast<__m128i*>(data + block * ChaCha20::BLOCK_SIZE + group * 4);
+					__m128i* high = reinterpret_cast<__m128i*>(data + (block + 4) * ChaCha20::BLOCK_SIZE + group * 4);
+					_mm_storeu_si128(low, _mm_xor_si128(_mm_loadu_si128(low), _mm256_castsi256_si128(rows[block])));
+					_mm_storeu_si128(high, _mm_xor_si128(_mm_loadu_si128(high), _mm256_extracti128_si256(rows[block], 1)));
+				}
+			}
+		}
+		xorSse2(input, counter, data, blocks);
+	}
+#endif
+}
+
+ChaCha20::ChaCha20(const std::string& key, const std::string& nonce) : implementation(bestImplementation())
+{
+	if (key.size() != KEY_SIZE || nonce.size() != NONCE_SIZE)
+	{
+		throw std::invalid_argument("ChaCha20 needs a 32-byte key and a 12-byte nonce.");
+	}
+
+	// "expand 32-byte k"
+	state[0] = 0x61707865;
+	state[1] = 0x3320646e;
+	state[2] = 0x79622d32;
+	state[3] = 0x6b206574;
+	const unsigned char* keyBytes = reinterpret_cast<const unsigned char*>(key.data());
+	for (int i = 0; i < 8; ++i)
+	{
+		state[4 + i] = loadLittleEndian(keyBytes + i * 4);
+	}
+	state[12] = 0;
+	const unsigned char* nonceBytes = reinterpret_cast<const unsigned char*>(nonce.data());
+	for (int i = 0; i < 3; ++i)
+	{
+		state[13 + i] = loadLittleEndian(nonceBytes + i * 4);
+	}
+}
+
+bool ChaCha20::isSupported(Implementation candidate)
+{
+#ifdef CHACHA20_X86
+	if (candidate == AVX2)
+	{
+		return __builtin_cpu_supports("avx2");
+	}
+	if (candidate == SSE2)
+	{
+		return __builtin_cpu_supports("sse2");
+	}
+#else
+	if (candidate != SCALAR)
+	{
+		return false;
+	}
+#endif
+	return true;
+}
+
+ChaCha20::Implementation ChaCha20::bestImplementation()
+{
+	static const Implementation best = isSupported(AVX2) ? AVX2 : (isSupported(SSE2) ? SSE2 : SCALAR);
+	return best;
+}
+
+const char* ChaCha20::implementationName(Implementation candidate)
+{
+	switch (candidate)
+	{
+	case AVX2: return "AVX2 (8 blocks)";
+	case SSE2: return "SSE2 (4 blocks)";
+	default: return "scalar";
+	}
+}
+
+void ChaCha20::setImplementation(Implementation chosen)
+{
+	if (!isSupported(chosen))
+	{
+		throw std::runtime_error(std::string("This CPU does not support the ") + implementationName(chosen) + " ChaCha20 code.");
+	}
+	implementation = chosen;
+}
+
+void ChaCha20::apply(char* data, size_t length, uint64_t offset) const
+{
+	if (length == 0)
+	{
+		return;
+	}
+	if ((offset + length - 1) / BLOCK_SIZE > UINT32_MAX)
+	{
+		throw std::length_error("ChaCha20 stream is limited to 256 GiB per nonce.");
+	}
+
+	unsigned char* bytes = reinterpret_cast<unsigned char*>(data);
+	uint32_t counter = static_cast<uint32_t>(offset / BLOCK_SIZE);
+	unsigned char keystream[BLOCK_SIZE];
+
+	// a partial first block when offset is not block aligned
+	size_t skip = offset % BLOCK_SIZE;
+	if (skip > 0)
+	{
+		scalarBlock(state, counter++, keystream);
+		size_t take = BLOCK_SIZE - skip < length ? BLOCK_SIZE - skip : length;
+		for (size_t i = 0; i < take; ++i)
+		{
+			bytes[i] ^= keystream[skip + i];
+		}
+		bytes += take;
+		length -= take;
+	}
+
+	size_t blocks = length / BLOCK_SIZE;
+	switch (implementation)
+	{
+#ifdef CHACHA20_X86
+	case AVX2:
+		xorAvx2(state, counter, bytes, blocks);
+		break;
+	case SSE2:
+		xorSse2(state, counter, bytes, blocks);
+		break;
+#endif
+	default:
+		xorScalar(state, counter, bytes, blocks);
+		break;
+	}
+	counter += static_cast<uint32_t>(blocks);
+	bytes += blocks * BLOCK_SIZE;
+	length -= blocks * BLOCK_SIZE;
+
+	if (length > 0)
+	{
+		scalarBlock(state, counter, keystream);
+		for (size_t i = 0; i < length; ++i)
+		{
+			bytes[i] ^= keystream[i];
+		}
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// ChaCha20 stream cipher (RFC 8439) with a seekable keystream, so a file can be
+// processed block by block or in parallel chunks. The block function runs 1
+// (scalar), 4 (SSE2) or 8 (AVX2) blocks at a time; the widest one the CPU
+// supports is picked at runtime.
+class ChaCha20
+{
+public:
+	enum Implementation { SCALAR, SSE2, AVX2 };
+
+	static const size_t KEY_SIZE = 32;
+	static const size_t NONCE_SIZE = 12;
+	static const size_t BLOCK_SIZE = 64;
+
+private:
+	uint32_t state[16]; //constants, key, block counter (word 12) and nonce
+	Implementation implementation;
+
+public:
+	ChaCha20(const std::string& key, const std::string& nonce);
+
+	// XORs the keystream into data; offset is the position of data[0] in the stream
+	void apply(char* data, size_t length, uint64_t offset) const;
+
+	void setImplementation(Implementation chosen); //for benchmarks, throws if the CPU lacks it
+	Implementation getImplementation() const { return implementation; }
+
+	static Implementation bestImplementation();
+	static bool isSupported(Implementation candidate);
+	static const char* implementationName(Implementation candidate);
+};
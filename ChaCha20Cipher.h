@@ -0,0 +1,33 @@
+#pragma once
+#include "Cipher.h"
+
+// Per-password ChaCha20: every encrypt draws a fresh nonce, so equal passwords
+// give different ciphertexts. The result is hex (nonce followed by the
+// ciphertext) to stay clear of the vault's line format.
+class ChaCha20Cipher : public Cipher
+{
+private:
+	std::string key; //32 raw bytes
+
+	static std::string toHex(const std::string& bytes);
+	static std::string fromHex(const std::string& hex); //throws on odd length or non-hex digits
+
+public:
+	explicit ChaCha20Cipher(const std::string& key);
+
+	std::string encrypt(const std::string& input) override;
+	std::string decrypt(const std::string& input) override;
+
+	std::string serialize() const override;
+	Cipher* clone() const override;
+	std::string getType() const override;
+	std::string getConfig() const override; //hex key
+	uint8_t getTypeId() const override { return TYPE_ID; }
+	std::string encodeConfig() const override; //raw key
+
+	static const uint8_t TYPE_ID = 4;
+	static ChaCha20Cipher* fromPassphrase(const std::string& passphrase); //key = SHA-256 of the passphrase
+	static Cipher* fromParams(const std::vector<std::string>& params);
+	static Cipher* decodeConfig(const std::string& config);
+	static Cipher* fromText(const std::string& config); //hex key
+};
@@ -0,0 +1,111 @@
+#include "ChainBenchmark.h"
+#include <iostream>
+#include <stdexcept>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+
+ChainBenchmark::ChainBenchmark(size_t passwordCount) : passwordCount(passwordCount)
+{
+	if (passwordCount == 0)
+	{
+		throw std::invalid_argument("Password count must be positive.");
+	}
+}
+
+std::vector<std::string> ChainBenchmark::makePasswords(size_t length) const
+{
+	static const std::string alphabet = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789!@#$%";
+	std::vector<std::string> passwords(passwordCount, std::string(length, ' '));
+
+	uint64_t state = 0x9E3779B97F4A7C15ULL; // fixed seed, every run encrypts the same passwords
+	for (std::string& password : passwords)
+	{
+		for (char& c : password)
+		{
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+			c = alphabet[(state >> 33) % alphabet.size()];
+		}
+	}
+	return passwords;
+}
+
+double ChainBenchmark::measure(ChainCipher& chain, const std::vector<std::string>& passwords, std::vector<std::string>& results)
+{
+	double best = 0;
+	for (int pass = 0; pass < PASSES; ++pass)
+	{
+		auto started = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < passwords.size(); ++i)
+		{
+			results[i] = chain.decrypt(chain.encrypt(passwords[i]));
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		if (best == 0 || seconds < best)
+		{
+			best = seconds;
+		}
+	}
+	return best;
+}
+
+void ChainBenchmark::runCase(const std::string& spec) const
+{
+	// the same stages twice, once planned for fusion and once run one by one
+	std::unique_ptr<Cipher> parsed(ChainCipher::fromParams({ spec }));
+	ChainCipher& fused = static_cast<ChainCipher&>(*parsed);
+	std::vector<Cipher*> stages;
+	for (const Cipher* stage : fused.getStages())
+	{
+		stages.push_back(stage->clone());
+	}
+	ChainCipher sequential(stages, false);
+
+	std::vector<std::string> passwords = makePasswords(16);
+	std::vector<std::string> fusedResults(passwords.size());
+	std::vector<std::string> sequentialResults(passwords.size());
+	double fusedSeconds = measure(fused, passwords, fusedResults);
+	double sequentialSeconds = measure(sequential, passwords, sequentialResults);
+	if (fusedResults != sequentialResults)
+	{
+		throw std::runtime_error("Fused and sequential chains disagree on " + spec);
+	}
+
+	std::cout << spec << ": " << passwords.size() << " passwords, encrypt + decrypt" << std::endl;
+	std::cout << "  sequential: " << sequential.getStepCount(false) << " passes, " << (passwords.size() / sequentialSeconds) << " passwords/s" << std::endl;
+	std::cout << "  fused:      " << fused.getStepCount(false) << " passes, " << (passwords.size() / fusedSeconds)
+		<< " passwords/s (x" << (sequentialSeconds / fusedSeconds) << ")" << std::endl;
+}
+
+void ChainBenchmark::run() const
+{
+	runCase("caesar:3,hill:2:3:3:2:5");
+	runCase("hill:2:3:3:2:5,caesar:5");
+	runCase("caesar:3,caesar:11,hill:3:GYBNQKURP,caesar:7");
+	runCase("caesar:1,caesar:2,caesar:3");
+}
+
+int ChainBenchmark::runFromArguments(const std::vector<std::string>& args)
+{
+	size_t passwords = 1000000;
+
+	for (size_t i = 1; i < args.size(); i += 2)
+	{
+		if (args[i] != "--passwords" || i + 1 >= args.size())
+		{
+			std::cerr << "Usage: --bench-chain [--passwords N]" << std::endl;
+			return 1;
+		}
+
+		char* end;
+		long value = std::strtol(args[i + 1].c_str(), &end, 10);
+		if (*end != '\0' || value <= 0)
+		{
+			throw std::invalid_argument("Invalid value for " + args[i] + ": " + args[i + 1]);
+		}
+		passwords = static_cast<size_t>(value);
+	}
+
+	ChainBenchmark(passwords).run();
+	return 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "ChainCipher.h"
+
+// Measures ChainCipher with its stages fused into as few passes as possible
+// against the same stages run one after another, each producing its own
+// string. Both must give identical ciphertexts and plaintexts.
+class ChainBenchmark
+{
+private:
+	size_t passwordCount;
+
+	static const int PASSES = 3; //best of
+
+	std::vector<std::string> makePasswords(size_t length) const;
+	static double measure(ChainCipher& chain, const std::vector<std::string>& passwords, std::vector<std::string>& results); //seconds
+	void runCase(const std::string& spec) const;
+
+public:
+	explicit ChainBenchmark(size_t passwordCount);
+
+	void run() const;
+
+	// --bench-chain [--passwords N]
+	static int runFromArguments(const std::vector<std::string>& args);
+};
@@ -0,0 +1,277 @@
+#include "ChainCipher.h"
+#include "CipherRegistry.h"
+#include <memory>
+
+namespace
+{
+	const CipherRegistry::Registrar registrar(CipherType{ ChainCipher::TYPE_ID, "chain", "<cipher>:<param>:...,<cipher>:<param>:...", 1, SIZE_MAX,
+		&ChainCipher::fromParams, &ChainCipher::decodeConfig, "Chain", &ChainCipher::fromText });
+
+	std::vector<std::string> split(const std::string& text, char separator)
+	{
+		std::vector<std::string> parts;
+		size_t start = 0;
+		for (size_t end = text.find(separator); end != std::string::npos; end = text.find(separator, start))
+		{
+			parts.push_back(text.substr(start, end - start));
+			start = end + 1;
+		}
+		parts.push_back(text.substr(start));
+		return parts;
+	}
+
+	// owns the stages until the chain takes them
+	struct Stages
+	{
+		std::vector<Cipher*> list;
+		~Stages() { for (Cipher* stage : list) delete stage; }
+		ChainCipher* release()
+		{
+			if (list.empty())
+			{
+				throw std::invalid_argument("A chain needs at least one cipher");
+			}
+			ChainCipher* chain = new ChainCipher(list);
+			list.clear();
+			return chain;
+		}
+	};
+}
+
+ChainCipher::ChainCipher(const std::vector<Cipher*>& stages, bool fused) : stages(stages), fused(fused)
+{
+	encryptPlan = plan(false);
+	decryptPlan = plan(true);
+}
+
+ChainCipher::ChainCipher(const ChainCipher& other) : fused(other.fused)
+{
+	for (const Cipher* stage : other.stages)
+	{
+		stages.push_back(stage->clone());
+	}
+	encryptPlan = plan(false);
+	decryptPlan = plan(true);
+}
+
+ChainCipher::~ChainCipher()
+{
+	for (Cipher* stage : stages)
+	{
+		delete stage;
+	}
+}
+
+std::vector<ChainCipher::Step> ChainCipher::plan(bool decrypting) const
+{
+	std::vector<Step> steps;
+	std::vector<Cipher*> order(stages);
+	if (decrypting)
+	{
+		order.assign(stages.rbegin(), stages.rend());
+	}
+	if (!fused)
+	{
+		for (Cipher* stage : order)
+		{
+			steps.push_back(Step{ stage, {}, {} });
+		}
+		return steps;
+	}
+
+	// substitutions in a row compose into one table, which then rides along
+	// with the stage before it (as its output table) or after it (as input)
+	std::vector<unsigned char> pending;
+	auto placePending = [&steps, &pending](Cipher* next)
+	{
+		if (pending.empty())
+		{
+			return;
+		}
+		if (!steps.empty() && steps.back().stage && steps.back().stage->acceptsSubstitution() && steps.back().after.empty())
+		{
+			steps.back().after.swap(pending);
+		}
+		else if (next && next->acceptsSubstitution())
+		{
+			steps.push_back(Step{ next, std::vector<unsigned char>(), {} });
+			steps.back().before.swap(pending);
+			return;
+		}
+		else
+		{
+			steps.push_back(Step{ nullptr, std::vector<unsigned char>(), {} });
+			steps.back().before.swap(pending);
+		}
+		pending.clear();
+	};
+
+	unsigned char table[256];
+	for (Cipher* stage : order)
+	{
+		if (stage->getSubstitution(table, decrypting))
+		{
+			if (pending.empty())
+			{
+				pending.assign(table, table + 256);
+			}
+			else
+			{
+				for (unsigned char& mapped : pending)
+				{
+					mapped = table[mapped];
+				}
+			}
+			continue;
+		}
+
+		size_t before = steps.size();
+		placePending(stage);
+		if (steps.size() == before || steps.back().stage != stage)
+		{
+			steps.push_back(Step{ stage, {}, {} });
+		}
+		pending.clear();
+	}
+	placePending(nullptr);
+	return steps;
+}
+
+std::string ChainCipher::run(const std::vector<Step>& steps, bool decrypting, const std::string& input) const
+{
+	std::string text;
+	const std::string* current = &input; //no copy until a step produces something
+	for (const Step& step : steps)
+	{
+		if (!step.stage)
+		{
+			if (current == &input)
+			{
+				text = input;
+				current = &text;
+			}
+			for (char& c : text)
+			{
+				c = static_cast<char>(step.before[static_cast<unsigned char>(c)]);
+			}
+		}
+		else if (!step.before.empty() || !step.after.empty())
+		{
+			text = step.stage->transform(*current, decrypting, step.before.empty() ? nullptr : step.before.data(),
+				step.after.empty() ? nullptr : step.after.data());
+			current = &text;
+		}
+		else
+		{
+			text = decrypting ? step.stage->decrypt(*current) : step.stage->encrypt(*current);
+			current = &text;
+		}
+	}
+	return current == &input ? input : text;
+}
+
+std::string ChainCipher::encrypt(const std::string& input)
+{
+	return run(encryptPlan, false, input);
+}
+
+std::string ChainCipher::decrypt(const std::string& input)
+{
+	return run(decryptPlan, true, input);
+}
+
+std::string ChainCipher::serialize() const
+{
+	return "Chain " + getConfig();
+}
+
+Cipher* ChainCipher::clone() const
+{
+	return new ChainCipher(*this);
+}
+
+std::string ChainCipher::getType() const
+{
+	std::string type = "Chain";
+	for (size_t i = 0; i < stages.size(); ++i)
+	{
+		type += (i == 0 ? "(" : ",") + stages[i]->getType();
+	}
+	return type + ")";
+}
+
+std::string ChainCipher::getConfig() const
+{
+	std::string config;
+	for (const Cipher* stage : stages)
+	{
+		config += (config.empty() ? "" : ",") + CipherRegistry::store(*stage);
+	}
+	return config;
+}
+
+std::string ChainCipher::encodeConfig() const
+{
+	std::string config;
+	for (const Cipher* stage : stages)
+	{
+		std::string stageConfig = stage->encodeConfig();
+		config.push_back(static_cast<char>(stage->getTypeId()));
+		CipherRegistry::appendInt32(config, static_cast<int32_t>(stageConfig.size()));
+		config += stageConfig;
+	}
+	return config;
+}
+
+Cipher* ChainCipher::fromParams(const std::vector<std::string>& params)
+{
+	// every parameter holds one or more stages, so "caesar:3 hill:2:key" works too
+	Stages stages;
+	for (const std::string& param : params)
+	{
+		for (const std::string& spec : split(param, ','))
+		{
+			std::vector<std::string> fields = split(spec, ':');
+			if (fields[0].empty() || fields[0] == "chain")
+			{
+				throw std::invalid_argument("Invalid chain stage: '" + spec + "'");
+			}
+			std::vector<std::string> stageParams(fields.begin() + 1, fields.end());
+			stages.list.push_back(CipherRegistry::instance().create(fields[0], stageParams));
+		}
+	}
+	return stages.release();
+}
+
+Cipher* ChainCipher::decodeConfig(const std::string& config)
+{
+	Stages stages;
+	for (size_t offset = 0; offset < config.size();)
+	{
+		uint8_t id = static_cast<uint8_t>(config[offset]);
+		int32_t length = CipherRegistry::readInt32(config, offset + 1);
+		offset += 5;
+		if (length < 0 || offset + static_cast<size_t>(length) > config.size())
+		{
+			throw std::runtime_error("Invalid Chain cipher config");
+		}
+		stages.list.push_back(CipherRegistry::instance().get(id).decodeConfig(config.substr(offset, length)));
+		offset += length;
+	}
+	return stages.release();
+}
+
+Cipher* ChainCipher::fromText(const std::string& config)
+{
+	Stages stages;
+	for (const std::string& stored : split(config, ','))
+	{
+		size_t colon = stored.find(':');
+		if (colon == std::string::npos)
+		{
+			throw std::runtime_error("Invalid Chain cipher config");
+		}
+		stages.list.push_back(CipherRegistry::instance().restore(stored.substr(0, colon), stored.substr(colon + 1)));
+	}
+	return stages.release();
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "Cipher.h"
+
+// Runs several ciphers one after another: encrypt goes through the stages in
+// order, decrypt through their inverses backwards. Byte-by-byte stages
+// (Caesar) are folded into one table, and the table runs inside the pass of a
+// neighbouring stage that accepts it (Hill), so caesar,hill is a single pass
+// with no intermediate string per stage.
+class ChainCipher : public Cipher
+{
+private:
+	struct Step
+	{
+		Cipher* stage; //nullptr for a step that only applies a table
+		std::vector<unsigned char> before; //256 entries, or empty for none
+		std::vector<unsigned char> after;
+	};
+
+	std::vector<Cipher*> stages; //owned, in encryption order
+	bool fused; //false runs every stage on its own, for comparison
+	std::vector<Step> encryptPlan;
+	std::vector<Step> decryptPlan;
+
+	std::vector<Step> plan(bool decrypting) const;
+	std::string run(const std::vector<Step>& steps, bool decrypting, const std::string& input) const;
+
+public:
+	explicit ChainCipher(const std::vector<Cipher*>& stages, bool fused = true); //takes ownership
+	ChainCipher(const ChainCipher& other);
+	ChainCipher& operator=(const ChainCipher&) = delete;
+	~ChainCipher();
+
+	std::string encrypt(const std::string& input) override;
+	std::string decrypt(const std::string& input) override;
+
+	std::string serialize() const override;
+	Cipher* clone() const override;
+	std::string getType() const override;
+	std::string getConfig() const override; //stored stages separated by ','
+	uint8_t getTypeId() const override { return TYPE_ID; }
+	std::string encodeConfig() const override; //per stage: type ID, int32 length, config
+
+	const std::vector<Cipher*>& getStages() const { return stages; }
+	size_t getStepCount(bool decrypting) const { return (decrypting ? decryptPlan : encryptPlan).size(); }
+
+	static const uint8_t TYPE_ID = 5;
+	static Cipher* fromParams(const std::vector<std::string>& params); //"caesar:3,hill:2:3:3:2:5"
+	static Cipher* decodeConfig(const std::string& config);
+	static Cipher* fromText(const std::string& config);
+};
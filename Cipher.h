@@ -2,6 +2,8 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <cstdint>
+#include <stdexcept>
 
 
 class Cipher
@@ -19,5 +21,29 @@ public:
 	virtual Cipher* clone() const = 0; 
 	virtual std::string getType() const = 0;
 	virtual std::string getConfig() const = 0;
+
+	virtual uint8_t getTypeId() const = 0; //see CipherRegistry
+	virtual std::string encodeConfig() const = 0; //binary, read back by the registered decodeConfig
+
+	// characters a password may hold and come back unchanged, for generated passwords
+	virtual std::string getAlphabet() const
+	{
+		std::string printable;
+		for (char c = 32; c < 127; ++c)
+		{
+			printable.push_back(c);
+		}
+		return printable;
+	}
+
+	// Hooks for ChainCipher to fuse stages. A cipher that maps every byte on its
+	// own fills table[256] instead of making its own pass; a cipher that accepts
+	// such tables runs them on its input and output within its own pass.
+	virtual bool getSubstitution(unsigned char* /*table*/, bool /*decrypting*/) const { return false; }
+	virtual bool acceptsSubstitution() const { return false; }
+	virtual std::string transform(const std::string& /*input*/, bool /*decrypting*/, const unsigned char* /*before*/, const unsigned char* /*after*/)
+	{
+		throw std::logic_error(getType() + " cipher does not take substitution tables");
+	}
 };
 
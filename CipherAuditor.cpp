@@ -0,0 +1,777 @@
+#include "CipherAuditor.h"
+#include "CeasarCipher.h"
+#include "HillCipher.h"
+#include "TextCodeCipher.h"
+#include "ChaCha20Cipher.h"
+#include "ChainCipher.h"
+#include "VigenereCipher.h"
+#include "CipherRegistry.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const int ALPHABET = 95; //printable 32..126, the range Caesar and Vigenere shift over
+	const int STRIDE = 96; //bigram row length, a multiple of 4
+
+	// approximate character ranks in leaked password lists, most frequent first
+	const std::string PASSWORD_RANKS = "ae1ionrls02tm3c9dy54hu8b6g7kpjvfwzxqAEIONRLSTMCDYHUBGKPJVFWZXQ._!-@*#$";
+
+	int characterClass(int c)
+	{
+		return c >= 'a' && c <= 'z' ? 0 : c >= 'A' && c <= 'Z' ? 1 : c >= '0' && c <= '9' ? 2 : 3;
+	}
+
+	// what an attacker expects a password to look like
+	struct Model
+	{
+		float bigram[ALPHABET][2 * STRIDE]; //row a: log P(b | a), written twice so every rotation of a row is one slice
+		float letters[26]; //log P of each letter, either case, among letters
+		std::string ranked; //all printable characters, most likely first
+
+		Model()
+		{
+			double probability[ALPHABET];
+			for (int i = 0; i < ALPHABET; ++i)
+			{
+				size_t rank = PASSWORD_RANKS.find(static_cast<char>(i + 32));
+				probability[i] = rank == std::string::npos ? 1.0 / (PASSWORD_RANKS.size() + 40) : 1.0 / (rank + 3);
+			}
+
+			ranked = PASSWORD_RANKS;
+			for (int i = 0; i < ALPHABET; ++i)
+			{
+				if (ranked.find(static_cast<char>(i + 32)) == std::string::npos)
+				{
+					ranked.push_back(static_cast<char>(i + 32));
+				}
+			}
+
+			// passwords keep to one kind of character for a while: letters, then digits
+			for (int a = 0; a < ALPHABET; ++a)
+			{
+				double weights[ALPHABET];
+				double total = 0;
+				for (int b = 0; b < ALPHABET; ++b)
+				{
+					weights[b] = probability[b] * (characterClass(a + 32) == characterClass(b + 32) ? 0.7 : 0.1);
+					total += weights[b];
+				}
+				for (int j = 0; j < 2 * STRIDE; ++j)
+				{
+					bigram[a][j] = j < 2 * ALPHABET ? static_cast<float>(std::log(weights[j % ALPHABET] / total)) : 0.0f;
+				}
+			}
+
+			double letterTotal = 0;
+			for (int k = 0; k < 26; ++k)
+			{
+				letterTotal += probability['a' + k - 32] + probability['A' + k - 32];
+			}
+			for (int k = 0; k < 26; ++k)
+			{
+				letters[k] = static_cast<float>(std::log((probability['a' + k - 32] + probability['A' + k - 32]) / letterTotal));
+			}
+		}
+	};
+
+	const Model& model()
+	{
+		static const Model instance;
+		return instance;
+	}
+
+	float dot(const float* a, const float* b, size_t length) //length a multiple of 4
+	{
+#ifdef __SSE2__
+		__m128 sum = _mm_setzero_ps();
+		for (size_t i = 0; i < length; i += 4)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		}
+		float lanes[4];
+		_mm_storeu_ps(lanes, sum);
+		return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+		float sum = 0;
+		for (size_t i = 0; i < length; ++i)
+		{
+			sum += a[i] * b[i];
+		}
+		return sum;
+#endif
+	}
+
+	double secondsSince(std::chrono::steady_clock::time_point started)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	}
+
+	bool isPrintable(char c)
+	{
+		return c >= 32 && c <= 126;
+	}
+
+	int mod26(int value)
+	{
+		return ((value % 26) + 26) % 26;
+	}
+
+	// how many samples the candidate turns into exactly their ciphertext
+	size_t countReproduced(Cipher& candidate, const std::vector<std::pair<std::string, std::string>>& pairs)
+	{
+		size_t right = 0;
+		for (const auto& pair : pairs)
+		{
+			try
+			{
+				right += candidate.encrypt(pair.first) == pair.second ? 1 : 0;
+			}
+			catch (const std::exception&)
+			{
+			}
+		}
+		return right;
+	}
+
+	typedef std::vector<std::vector<int>> Matrix;
+
+	int determinant(const Matrix& m)
+	{
+		if (m.size() == 1)
+		{
+			return m[0][0];
+		}
+		int result = 0;
+		for (size_t column = 0; column < m.size(); ++column)
+		{
+			Matrix minor;
+			for (size_t row = 1; row < m.size(); ++row)
+			{
+				std::vector<int> line;
+				for (size_t j = 0; j < m.size(); ++j)
+				{
+					if (j != column)
+					{
+						line.push_back(m[row][j]);
+					}
+				}
+				minor.push_back(line);
+			}
+			result += (column % 2 == 0 ? 1 : -1) * m[0][column] * determinant(minor);
+		}
+		return result;
+	}
+
+	// false if m has no inverse mod 26
+	bool invert26(const Matrix& m, Matrix& inverse)
+	{
+		int det = mod26(determinant(m));
+		int detInverse = -1;
+		for (int x = 1; x < 26; ++x)
+		{
+			if (det * x % 26 == 1)
+			{
+				detInverse = x;
+			}
+		}
+		if (detInverse < 0)
+		{
+			return false;
+		}
+
+		size_t n = m.size();
+		inverse.assign(n, std::vector<int>(n, 0));
+		if (n == 1)
+		{
+			inverse[0][0] = detInverse;
+			return true;
+		}
+		for (size_t row = 0; row < n; ++row)
+		{
+			for (size_t column = 0; column < n; ++column)
+			{
+				Matrix minor;
+				for (size_t i = 0; i < n; ++i)
+				{
+					if (i == row)
+					{
+						continue;
+					}
+					std::vector<int> line;
+					for (size_t j = 0; j < n; ++j)
+					{
+						if (j != column)
+						{
+							line.push_back(m[i][j]);
+						}
+					}
+					minor.push_back(line);
+				}
+				int cofactor = ((row + column) % 2 == 0 ? 1 : -1) * determinant(minor);
+				inverse[column][row] = mod26(cofactor * detInverse); // adjugate is the transposed cofactor matrix
+			}
+		}
+		return true;
+	}
+
+	// the letters Hill actually encrypts: upper case, padded with X to whole blocks
+	std::vector<int> hillLetters(const std::string& text, size_t blockSize)
+	{
+		std::vector<int> letters;
+		for (char c : text)
+		{
+			if (c >= 'a' && c <= 'z')
+			{
+				letters.push_back(c - 'a');
+			}
+			else if (c >= 'A' && c <= 'Z')
+			{
+				letters.push_back(c - 'A');
+			}
+		}
+		while (letters.size() % blockSize != 0)
+		{
+			letters.push_back('X' - 'A');
+		}
+		return letters;
+	}
+}
+
+bool CipherAuditor::Finding::isBroken() const
+{
+	for (const Attack& attack : attacks)
+	{
+		if (attack.broken)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+CipherAuditor::CipherAuditor(const std::vector<PasswordEntry>& entries, const std::vector<const Cipher*>& ciphers, size_t sampleSize)
+	: entries(entries), ciphers(ciphers), sampleSize(sampleSize)
+{
+	if (sampleSize == 0)
+	{
+		throw std::invalid_argument("Sample size must be positive.");
+	}
+}
+
+std::vector<CipherAuditor::Sample> CipherAuditor::collect(unsigned generation, size_t& total, JobControl& control) const
+{
+	total = 0;
+	for (const PasswordEntry& entry : entries)
+	{
+		total += entry.getGeneration() == generation ? 1 : 0;
+	}
+
+	// spread over the whole vault, not just its first entries
+	std::unique_ptr<Cipher> cipher(ciphers[generation]->clone());
+	std::vector<Sample> samples;
+	size_t step = std::max<size_t>(1, total / sampleSize);
+	size_t seen = 0;
+	for (const PasswordEntry& entry : entries)
+	{
+		if (entry.getGeneration() != generation || seen++ % step != 0 || samples.size() >= sampleSize)
+		{
+			continue;
+		}
+		control.checkpoint();
+		try
+		{
+			samples.push_back(Sample{ cipher->decrypt(entry.getPassword()), entry.getPassword() });
+		}
+		catch (const std::exception&)
+		{
+			// not the auditor's business, fsck reports those
+		}
+	}
+	control.addEntries(samples.size());
+	return samples;
+}
+
+void CipherAuditor::attackCaesar(const std::vector<Sample>& samples, Finding& finding)
+{
+	std::vector<std::pair<std::string, std::string>> pairs;
+	for (const Sample& sample : samples)
+	{
+		pairs.push_back({ sample.plain, sample.cipher });
+	}
+
+	// known plaintext: one printable character gives the shift
+	auto started = std::chrono::steady_clock::now();
+	int knownShift = -1;
+	for (size_t i = 0; knownShift < 0 && i < samples.size(); ++i)
+	{
+		const Sample& sample = samples[i];
+		for (size_t j = 0; j < sample.plain.size() && j < sample.cipher.size(); ++j)
+		{
+			if (isPrintable(sample.plain[j]))
+			{
+				knownShift = (sample.cipher[j] - sample.plain[j] + ALPHABET) % ALPHABET;
+				break;
+			}
+		}
+	}
+	bool knownBroken = false;
+	if (knownShift >= 0)
+	{
+		CeasarCipher candidate(knownShift);
+		knownBroken = countReproduced(candidate, pairs) == pairs.size();
+	}
+	finding.attacks.push_back(Attack{ "known plaintext", secondsSince(started), knownBroken,
+		knownBroken ? "shift " + std::to_string(knownShift) + " read off one password" : "no consistent shift" });
+
+	// ciphertext only: score every shift against the bigram model
+	started = std::chrono::steady_clock::now();
+	std::vector<float> counts(ALPHABET * STRIDE, 0.0f);
+	for (const Sample& sample : samples)
+	{
+		for (size_t j = 1; j < sample.cipher.size(); ++j)
+		{
+			if (isPrintable(sample.cipher[j - 1]) && isPrintable(sample.cipher[j]))
+			{
+				counts[(sample.cipher[j - 1] - 32) * STRIDE + (sample.cipher[j] - 32)] += 1.0f;
+			}
+		}
+	}
+
+	const Model& expected = model();
+	std::vector<float> scores(ALPHABET);
+	ThreadPool::shared().parallelFor(ALPHABET, [&counts, &expected, &scores](size_t shift)
+	{
+		float score = 0;
+		for (int a = 0; a < ALPHABET; ++a)
+		{
+			int plainA = (a - static_cast<int>(shift) + ALPHABET) % ALPHABET;
+			score += dot(&counts[a * STRIDE], &expected.bigram[plainA][ALPHABET - shift], STRIDE);
+		}
+		scores[shift] = score;
+	});
+	int best = static_cast<int>(std::max_element(scores.begin(), scores.end()) - scores.begin());
+
+	CeasarCipher candidate(best);
+	size_t right = countReproduced(candidate, pairs);
+	std::string detail = "best of 95 shifts is " + std::to_string(best) + ", " + std::to_string(right) + "/" + std::to_string(pairs.size()) + " passwords right";
+	if (knownBroken)
+	{
+		size_t rank = 1;
+		for (float score : scores)
+		{
+			rank += score > scores[knownShift] ? 1 : 0;
+		}
+		detail += ", the real shift ranks " + std::to_string(rank) + " of 95";
+	}
+	finding.attacks.push_back(Attack{ "bigram scoring", secondsSince(started), right * 2 > pairs.size(), detail });
+}
+
+void CipherAuditor::attackHill(const Cipher& cipher, const std::vector<Sample>& samples, Finding& finding)
+{
+	size_t n = static_cast<size_t>(CipherRegistry::readInt32(cipher.encodeConfig(), 0));
+	std::vector<std::pair<std::string, std::string>> pairs;
+	for (const Sample& sample : samples)
+	{
+		pairs.push_back({ sample.plain, sample.cipher });
+	}
+
+	// aligned plaintext/ciphertext blocks
+	std::vector<std::vector<int>> plainBlocks, cipherBlocks;
+	for (const Sample& sample : samples)
+	{
+		std::vector<int> plain = hillLetters(sample.plain, n);
+		std::vector<int> encrypted = hillLetters(sample.cipher, n);
+		for (size_t i = 0; i + n <= plain.size() && i + n <= encrypted.size(); i += n)
+		{
+			plainBlocks.emplace_back(plain.begin() + i, plain.begin() + i + n);
+			cipherBlocks.emplace_back(encrypted.begin() + i, encrypted.begin() + i + n);
+		}
+	}
+
+	// known plaintext: n blocks with an invertible plaintext matrix give K = C * P^-1
+	if (n <= 3)
+	{
+		auto started = std::chrono::steady_clock::now();
+		bool broken = false;
+		size_t tries = 0;
+		uint64_t state = 0x2545F4914F6CDD1DULL;
+		for (; !broken && tries < 10000 && plainBlocks.size() >= n; ++tries)
+		{
+			std::vector<size_t> chosen;
+			for (size_t k = 0; k < n; ++k)
+			{
+				state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+				chosen.push_back(tries < plainBlocks.size() ? (tries + k) % plainBlocks.size() : (state >> 33) % plainBlocks.size());
+			}
+
+			Matrix p(n, std::vector<int>(n)), c(n, std::vector<int>(n)), pInverse;
+			for (size_t column = 0; column < n; ++column)
+			{
+				for (size_t row = 0; row < n; ++row)
+				{
+					p[row][column] = plainBlocks[chosen[column]][row];
+					c[row][column] = cipherBlocks[chosen[column]][row];
+				}
+			}
+			if (!invert26(p, pInverse))
+			{
+				continue;
+			}
+
+			Matrix key(n, std::vector<int>(n, 0));
+			for (size_t row = 0; row < n; ++row)
+			{
+				for (size_t column = 0; column < n; ++column)
+				{
+					for (size_t k = 0; k < n; ++k)
+					{
+						key[row][column] += c[row][k] * pInverse[k][column];
+					}
+					key[row][column] = mod26(key[row][column]);
+				}
+			}
+			try
+			{
+				HillCipher candidate(key);
+				broken = countReproduced(candidate, pairs) == pairs.size();
+			}
+			catch (const std::exception&)
+			{
+			}
+		}
+		finding.attacks.push_back(Attack{ "known plaintext", secondsSince(started), broken,
+			broken ? std::to_string(n) + "x" + std::to_string(n) + " key solved from " + std::to_string(n) + " blocks after "
+				+ std::to_string(tries) + " tries" : "no invertible set of blocks reproduced the key" });
+	}
+	else
+	{
+		finding.attacks.push_back(Attack{ "known plaintext", 0, false, "not attempted for n > 3" });
+	}
+
+	if (n != 2)
+	{
+		return;
+	}
+
+	// ciphertext only: try every invertible decryption matrix, score the letters it gives
+	auto started = std::chrono::steady_clock::now();
+	const size_t MAX_BLOCKS = 1024;
+	std::vector<int> xs, ys;
+	for (size_t i = 0; i < cipherBlocks.size() && i < MAX_BLOCKS; ++i)
+	{
+		xs.push_back(cipherBlocks[i][0]);
+		ys.push_back(cipherBlocks[i][1]);
+	}
+
+	const float* letters = model().letters;
+	struct Best
+	{
+		float score;
+		int a, b, c, d;
+		size_t keys;
+	};
+	std::vector<Best> bests(26, Best{ -1e30f, 0, 0, 0, 0, 0 });
+	ThreadPool::shared().parallelFor(26, [&xs, &ys, letters, &bests](size_t a)
+	{
+		Best& best = bests[a];
+		for (int b = 0; b < 26; ++b)
+		{
+			for (int c = 0; c < 26; ++c)
+			{
+				for (int d = 0; d < 26; ++d)
+				{
+					int det = mod26(static_cast<int>(a) * d - b * c);
+					if (det % 2 == 0 || det == 13)
+					{
+						continue;
+					}
+					++best.keys;
+					float score = 0;
+					for (size_t i = 0; i < xs.size(); ++i)
+					{
+						score += letters[(static_cast<int>(a) * xs[i] + b * ys[i]) % 26] + letters[(c * xs[i] + d * ys[i]) % 26];
+					}
+					if (score > best.score)
+					{
+						best = Best{ score, static_cast<int>(a), b, c, d, best.keys };
+					}
+				}
+			}
+		}
+	});
+
+	Best best = bests[0];
+	size_t keys = 0;
+	for (const Best& candidate : bests)
+	{
+		keys += candidate.keys;
+		if (candidate.score > best.score)
+		{
+			best = candidate;
+		}
+	}
+
+	size_t right = 0;
+	Matrix key;
+	if (invert26(Matrix{ { best.a, best.b }, { best.c, best.d } }, key))
+	{
+		HillCipher candidate(key);
+		right = countReproduced(candidate, pairs);
+	}
+	finding.attacks.push_back(Attack{ "2x2 brute force", secondsSince(started), right * 2 > pairs.size(),
+		std::to_string(keys) + " invertible keys scored on " + std::to_string(xs.size()) + " blocks, best key reproduces "
+			+ std::to_string(right) + "/" + std::to_string(pairs.size()) + " passwords" });
+}
+
+void CipherAuditor::attackTextCode(const std::vector<Sample>& samples, Finding& finding)
+{
+	auto started = std::chrono::steady_clock::now();
+
+	// every character always gets the same code, so the commonest code is the commonest character
+	std::vector<std::vector<long>> codes;
+	std::unordered_map<long, size_t> frequency;
+	for (const Sample& sample : samples)
+	{
+		std::vector<long> sequence;
+		const char* text = sample.cipher.c_str();
+		while (*text)
+		{
+			char* end;
+			long code = std::strtol(text, &end, 10);
+			if (end == text)
+			{
+				++text; // braces, commas and spaces
+				continue;
+			}
+			sequence.push_back(code);
+			++frequency[code];
+			text = end;
+		}
+		codes.push_back(sequence);
+	}
+
+	std::vector<std::pair<size_t, long>> order;
+	for (const auto& counted : frequency)
+	{
+		order.push_back({ counted.second, counted.first });
+	}
+	std::sort(order.begin(), order.end(), [](const std::pair<size_t, long>& x, const std::pair<size_t, long>& y)
+	{
+		return x.first != y.first ? x.first > y.first : x.second < y.second;
+	});
+
+	const std::string& ranked = model().ranked;
+	std::unordered_map<long, char> guess;
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		guess[order[i].second] = i < ranked.size() ? ranked[i] : '?';
+	}
+
+	size_t characters = 0, charactersRight = 0, passwordsRight = 0;
+	for (size_t i = 0; i < samples.size(); ++i)
+	{
+		std::string decoded;
+		for (long code : codes[i])
+		{
+			decoded.push_back(guess[code]);
+		}
+		for (size_t j = 0; j < decoded.size() && j < samples[i].plain.size(); ++j)
+		{
+			charactersRight += decoded[j] == samples[i].plain[j] ? 1 : 0;
+		}
+		characters += samples[i].plain.size();
+		passwordsRight += decoded == samples[i].plain ? 1 : 0;
+	}
+
+	std::ostringstream detail;
+	detail << order.size() << " distinct codes, " << (characters ? 100.0 * charactersRight / characters : 0.0) << "% of characters and "
+		<< passwordsRight << "/" << samples.size() << " passwords right; password lengths are visible";
+	finding.attacks.push_back(Attack{ "frequency analysis", secondsSince(started), passwordsRight * 2 > samples.size(), detail.str() });
+
+	// known plaintext: half of the samples give the code table, the other half is read with it
+	started = std::chrono::steady_clock::now();
+	std::unordered_map<long, char> table;
+	size_t half = samples.size() / 2;
+	for (size_t i = 0; i < half; ++i)
+	{
+		for (size_t j = 0; j < codes[i].size() && j < samples[i].plain.size(); ++j)
+		{
+			table[codes[i][j]] = samples[i].plain[j];
+		}
+	}
+	size_t readable = 0;
+	for (size_t i = half; i < samples.size(); ++i)
+	{
+		std::string decoded;
+		for (long code : codes[i])
+		{
+			auto known = table.find(code);
+			decoded.push_back(known == table.end() ? '\0' : known->second);
+		}
+		readable += decoded == samples[i].plain ? 1 : 0;
+	}
+	size_t unseen = samples.size() - half;
+	finding.attacks.push_back(Attack{ "known plaintext", secondsSince(started), unseen > 0 && readable * 2 > unseen,
+		std::to_string(table.size()) + " codes learned from " + std::to_string(half) + " passwords, " + std::to_string(readable) + "/"
+			+ std::to_string(unseen) + " others read in full" });
+}
+
+void CipherAuditor::attackVigenere(const std::vector<Sample>& samples, Finding& finding)
+{
+	auto started = std::chrono::steady_clock::now();
+	std::vector<std::pair<std::string, std::string>> pairs;
+	const Sample* longest = nullptr;
+	for (const Sample& sample : samples)
+	{
+		pairs.push_back({ sample.plain, sample.cipher });
+		if (!longest || sample.plain.size() > longest->plain.size())
+		{
+			longest = &sample;
+		}
+	}
+
+	// one known password gives the shifts, its shortest period gives the key
+	bool broken = false;
+	std::string key;
+	if (longest)
+	{
+		std::vector<int> shifts;
+		for (size_t j = 0; j < longest->plain.size() && j < longest->cipher.size(); ++j)
+		{
+			shifts.push_back(isPrintable(longest->plain[j]) ? (longest->cipher[j] - longest->plain[j] + ALPHABET) % ALPHABET : -1);
+		}
+		for (size_t period = 1; period <= shifts.size() && !broken; ++period)
+		{
+			key.assign(period, ' ');
+			bool consistent = true;
+			for (size_t j = 0; j < shifts.size() && consistent; ++j)
+			{
+				if (shifts[j] >= 0)
+				{
+					consistent = j < period ? true : shifts[j] == key[j % period] - 32;
+					if (j < period)
+					{
+						key[j] = static_cast<char>(32 + shifts[j]);
+					}
+				}
+			}
+			if (consistent)
+			{
+				VigenereCipher candidate(key);
+				broken = countReproduced(candidate, pairs) == pairs.size();
+			}
+		}
+	}
+	finding.attacks.push_back(Attack{ "known plaintext", secondsSince(started), broken,
+		broken ? "key of " + std::to_string(key.size()) + " characters read off one password"
+			: "key longer than the longest sampled password (" + std::to_string(longest ? longest->plain.size() : 0) + " characters)" });
+}
+
+std::vector<CipherAuditor::Finding> CipherAuditor::run(JobControl& control) const
+{
+	std::vector<Finding> findings;
+	for (unsigned generation = 0; generation < ciphers.size(); ++generation)
+	{
+		const Cipher* cipher = ciphers[generation];
+		if (!cipher)
+		{
+			continue;
+		}
+
+		Finding finding = Finding{ generation, cipher->getType(), 0, 0, 0, {} };
+		std::vector<Sample> samples = collect(generation, finding.entries, control);
+		finding.sampled = samples.size();
+		if (samples.empty())
+		{
+			continue;
+		}
+
+		std::unordered_map<std::string, size_t> seen;
+		for (const Sample& sample : samples)
+		{
+			++seen[sample.cipher];
+		}
+		for (const auto& repeated : seen)
+		{
+			finding.repeated += repeated.second > 1 ? repeated.second : 0;
+		}
+
+		control.checkpoint();
+		switch (cipher->getTypeId())
+		{
+		case CeasarCipher::TYPE_ID:
+			attackCaesar(samples, finding);
+			break;
+		case HillCipher::TYPE_ID:
+			attackHill(*cipher, samples, finding);
+			break;
+		case TextCodeCipher::TYPE_ID:
+			attackTextCode(samples, finding);
+			break;
+		case VigenereCipher::TYPE_ID:
+			attackVigenere(samples, finding);
+			break;
+		case ChaCha20Cipher::TYPE_ID:
+			finding.attacks.push_back(Attack{ "none", 0, false, "256-bit key and a fresh nonce per password, out of reach" });
+			break;
+		case ChainCipher::TYPE_ID:
+			finding.attacks.push_back(Attack{ "none", 0, false, "chains are not audited, their stages cannot be attacked one by one" });
+			break;
+		default:
+			finding.attacks.push_back(Attack{ "none", 0, false, "no attack implemented for this cipher" });
+			break;
+		}
+		findings.push_back(finding);
+	}
+	return findings;
+}
+
+std::string CipherAuditor::report(const std::vector<Finding>& findings)
+{
+	std::ostringstream out;
+	out << "Cipher audit on " << ThreadPool::shared().size() << " threads";
+	for (const Finding& finding : findings)
+	{
+		out << "\n  generation " << finding.generation << ": " << finding.cipher << ", " << finding.entries << " entries, "
+			<< finding.sampled << " sampled";
+		if (finding.repeated > 0)
+		{
+			out << ", " << finding.repeated << " share their ciphertext with another entry";
+		}
+
+		double fastest = -1;
+		for (const Attack& attack : finding.attacks)
+		{
+			std::string name = attack.name;
+			name.resize(20, ' ');
+			out << "\n    " << name << (attack.broken ? "BROKEN  " : "held    ") << attack.seconds << " s, " << attack.detail;
+			if (attack.broken && (fastest < 0 || attack.seconds < fastest))
+			{
+				fastest = attack.seconds;
+			}
+		}
+		if (fastest >= 0)
+		{
+			out << "\n    verdict: UNACCEPTABLE, broken in " << fastest << " s";
+		}
+		else
+		{
+			out << "\n    verdict: not broken by these attacks";
+		}
+	}
+	if (findings.empty())
+	{
+		out << "\n  no entries to audit";
+	}
+	return out.str();
+}
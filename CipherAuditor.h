@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Cipher.h"
+#include "PasswordEntry.h"
+#include "JobControl.h"
+
+// Attacks the vault's own ciphers the way an adversary holding the file body
+// would, behind the 'audit-cipher' command. Every cipher generation in use is
+// sampled, the samples are decrypted with the real cipher so each attack can
+// be checked, and then:
+//   Caesar:   all 95 shifts scored against bigram statistics (ciphertext only)
+//             and the shift read off one known password
+//   Hill:     key solved from known plaintext for n <= 3, and every invertible
+//             2x2 key tried on the ciphertext alone
+//   TextCode: frequency analysis of the position codes, and the code table
+//             learned from known passwords
+//   Vigenere: key read off one known password
+// The attacks run on the shared pool and are timed: the time is what it
+// takes to break the configuration on this machine.
+class CipherAuditor
+{
+public:
+	struct Attack
+	{
+		std::string name;
+		double seconds;
+		bool broken; //the key, or most passwords, came out right
+		std::string detail;
+	};
+
+	struct Finding
+	{
+		unsigned generation;
+		std::string cipher;
+		size_t entries; //using this generation
+		size_t sampled;
+		size_t repeated; //sampled entries whose ciphertext another sampled entry shares
+		std::vector<Attack> attacks;
+
+		bool isBroken() const;
+	};
+
+private:
+	struct Sample
+	{
+		std::string plain;
+		std::string cipher;
+	};
+
+	const std::vector<PasswordEntry>& entries;
+	std::vector<const Cipher*> ciphers; //indexed by generation
+	size_t sampleSize;
+
+	std::vector<Sample> collect(unsigned generation, size_t& total, JobControl& control) const;
+
+	static void attackCaesar(const std::vector<Sample>& samples, Finding& finding);
+	static void attackHill(const Cipher& cipher, const std::vector<Sample>& samples, Finding& finding);
+	static void attackTextCode(const std::vector<Sample>& samples, Finding& finding);
+	static void attackVigenere(const std::vector<Sample>& samples, Finding& finding);
+
+public:
+	CipherAuditor(const std::vector<PasswordEntry>& entries, const std::vector<const Cipher*>& ciphers, size_t sampleSize);
+
+	std::vector<Finding> run(JobControl& control) const;
+
+	static std::string report(const std::vector<Finding>& findings);
+};
@@ -7,10 +7,6 @@
 class CipherFactory
 {
 private:
-	static Cipher* createCaesarCipher(const std::vector<std::string>& params);
-	static Cipher* createTextCodeCipher(const std::vector<std::string>& params);
-	static Cipher* createHillCipher(const std::vector<std::string>& params);
-
 	static std::vector<std::string> splitString(const std::string& str);
 
 public:
@@ -0,0 +1,145 @@
+#include "CipherRegistry.h"
+#include <stdexcept>
+
+CipherRegistry& CipherRegistry::instance()
+{
+	// function-local so registrars in other translation units find it constructed
+	static CipherRegistry registry;
+	return registry;
+}
+
+void CipherRegistry::add(const CipherType& type)
+{
+	if (byId[type.id] || byName.count(type.name) > 0 || byTextName.count(type.textName) > 0)
+	{
+		throw std::logic_error("Cipher type registered twice: " + type.name);
+	}
+	byId[type.id].reset(new CipherType(type));
+	byName[type.name] = byId[type.id].get();
+	byTextName[type.textName] = byId[type.id].get();
+}
+
+const CipherType* CipherRegistry::find(const std::string& name) const
+{
+	auto found = byName.find(name);
+	return found == byName.end() ? nullptr : found->second;
+}
+
+const CipherType& CipherRegistry::get(uint8_t id) const
+{
+	if (!byId[id])
+	{
+		throw std::runtime_error("Unknown cipher type ID: " + std::to_string(id));
+	}
+	return *byId[id];
+}
+
+std::vector<const CipherType*> CipherRegistry::types() const
+{
+	std::vector<const CipherType*> result;
+	for (const auto& type : byId)
+	{
+		if (type)
+		{
+			result.push_back(type.get());
+		}
+	}
+	return result;
+}
+
+std::string CipherRegistry::names() const
+{
+	std::string result;
+	for (const CipherType* type : types())
+	{
+		result += (result.empty() ? "" : ", ") + type->name;
+	}
+	return result;
+}
+
+Cipher* CipherRegistry::create(const std::string& name, const std::vector<std::string>& params) const
+{
+	const CipherType* type = find(name);
+	if (!type)
+	{
+		throw std::invalid_argument("Unknown cipher type: " + name + " (supported: " + names() + ")");
+	}
+	if (params.size() < type->minParams || params.size() > type->maxParams)
+	{
+		throw std::invalid_argument("Usage: " + type->name + " " + type->usage);
+	}
+	return type->fromParams(params);
+}
+
+std::string CipherRegistry::store(const Cipher& cipher)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string config = cipher.encodeConfig();
+	std::string result = std::to_string(cipher.getTypeId()) + ":";
+	result.reserve(result.size() + config.size() * 2);
+	for (unsigned char c : config)
+	{
+		result.push_back(digits[c >> 4]);
+		result.push_back(digits[c & 0x0f]);
+	}
+	return result;
+}
+
+Cipher* CipherRegistry::restore(const std::string& type, const std::string& config) const
+{
+	if (type.empty() || type.find_first_not_of("0123456789") != std::string::npos)
+	{
+		auto found = byTextName.find(type);
+		if (found == byTextName.end())
+		{
+			throw std::runtime_error("Unknown cipher type: " + type);
+		}
+		return found->second->fromText(config);
+	}
+
+	unsigned long id = std::stoul(type);
+	if (id > 255 || config.size() % 2 != 0)
+	{
+		throw std::runtime_error("Invalid stored cipher: " + type);
+	}
+	std::string binary(config.size() / 2, '\0');
+	for (size_t i = 0; i < binary.size(); ++i)
+	{
+		int value = 0;
+		for (size_t j = 0; j < 2; ++j)
+		{
+			char c = config[i * 2 + j];
+			int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+			if (digit < 0)
+			{
+				throw std::runtime_error("Invalid stored cipher config");
+			}
+			value = value * 16 + digit;
+		}
+		binary[i] = static_cast<char>(value);
+	}
+	return get(static_cast<uint8_t>(id)).decodeConfig(binary);
+}
+
+void CipherRegistry::appendInt32(std::string& out, int32_t value)
+{
+	uint32_t bits = static_cast<uint32_t>(value);
+	for (int i = 0; i < 4; ++i)
+	{
+		out.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+	}
+}
+
+int32_t CipherRegistry::readInt32(const std::string& in, size_t offset)
+{
+	if (offset + 4 > in.size())
+	{
+		throw std::runtime_error("Cipher config is too short");
+	}
+	uint32_t bits = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		bits |= static_cast<uint32_t>(static_cast<unsigned char>(in[offset + i])) << (8 * i);
+	}
+	return static_cast<int32_t>(bits);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "Cipher.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+// What a cipher class tells the registry about itself. Vault files store the
+// type ID and the binary config (Cipher::encodeConfig), commands use the name.
+struct CipherType
+{
+	uint8_t id; //written to files, never reuse one
+	std::string name; //as typed in commands
+	std::string usage; //parameters after the name, for help and error texts
+	size_t minParams;
+	size_t maxParams;
+	Cipher* (*fromParams)(const std::vector<std::string>& params);
+	Cipher* (*decodeConfig)(const std::string& config); //inverse of Cipher::encodeConfig
+	std::string textName; //CIPHER_TYPE of files written before type IDs
+	Cipher* (*fromText)(const std::string& config); //their CIPHER_CONFIG
+};
+
+// Every cipher registers itself from its own .cpp through a static Registrar,
+// so a new cipher needs no change in PasswordManager or CommandProcessor.
+class CipherRegistry
+{
+private:
+	std::unique_ptr<CipherType> byId[256];
+	std::unordered_map<std::string, const CipherType*> byName;
+	std::unordered_map<std::string, const CipherType*> byTextName;
+
+	CipherRegistry() = default;
+
+public:
+	struct Registrar
+	{
+		explicit Registrar(const CipherType& type) { instance().add(type); }
+	};
+
+	static CipherRegistry& instance();
+
+	void add(const CipherType& type); //throws on a taken ID or name
+	const CipherType* find(const std::string& name) const; //nullptr for an unknown name
+	const CipherType& get(uint8_t id) const;
+	std::vector<const CipherType*> types() const; //in ID order
+	std::string names() const; //"caesar, textcode, ..." for error texts
+
+	Cipher* create(const std::string& name, const std::vector<std::string>& params) const;
+
+	// metadata lines hold "<id>:<hex config>"; files from before type IDs hold
+	// "<textName>:<text config>", restore() reads both
+	static std::string store(const Cipher& cipher);
+	Cipher* restore(const std::string& type, const std::string& config) const;
+
+	// for encodeConfig/decodeConfig implementations
+	static void appendInt32(std::string& out, int32_t value);
+	static int32_t readInt32(const std::string& in, size_t offset); //throws past the end
+};
@@ -3,103 +3,238 @@
 #include <stdexcept>
 #include <fstream>
 #include <cstdlib>
-#include "CeasarCipher.h"
-#include "TextCodeCipher.h" 
-#include "HillCipher.h"
 #include "CipherFactory.h"
+#include "CipherRegistry.h"
+#include "BulkImporter.h"
+#include "BulkExporter.h"
+#include "PasswordGenerator.h"
+#include "VaultChecker.h"
+#include "CipherAuditor.h"
+#include "CredentialAuditor.h"
+#include "Rekeyer.h"
+#include "KeyDerivation.h"
+#include "ThreadPool.h"
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <ctime>
 
-CommandProcessor::CommandProcessor() : passwordManager(nullptr) {} //not much more that we need to do here
+CommandProcessor::CommandProcessor(std::ostream& output)
+    : passwordManager(nullptr), output(output), backgroundJobs(false),
+      migrator([this](std::vector<PasswordManager::EntryKey>& keys) { migrateTouched(keys); }),
+      kdfIterations(VaultHeader::DEFAULT_ITERATIONS) {} //not much more that we need to do here
 CommandProcessor::~CommandProcessor() 
 {
+    jobs.shutdown(); // running jobs still reference the password manager
+    migrator.stop();
 	delete passwordManager;
 	passwordManager = nullptr;
 }
 
 void CommandProcessor::showHelp() const 
 {
-    std::cout << "\n=== Password Manager Help ===" << std::endl;
-    std::cout << "\nFile Operations:" << std::endl;
-    std::cout << "  create <filename> <cipher> <password> [cipher-params]" << std::endl;
-    std::cout << "    Create a new password file with specified cipher" << std::endl;
-    std::cout << "    Ciphers: caesar <shift>, textcode <textfile>, hill <matrix-size>" << std::endl;
-    std::cout << "    Example: create mypass.dat caesar mykey123 3" << std::endl;
-    std::cout << "\n  open <filename> <password>" << std::endl;
-    std::cout << "    Open an existing password file" << std::endl;
-    std::cout << "    Example: open mypass.dat mykey123" << std::endl;
-
-    std::cout << "\nPassword Operations: " << std::endl;
-    std::cout << "  save <website> <user> <password>" << std::endl;
-    std::cout << "    Save a password for a website and user" << std::endl;
-    std::cout << "    Example: save gmail.com john@email.com \"my secure pass\"" << std::endl;
-    std::cout << "\n  load <website> [<user>]" << std::endl;
-    std::cout << "    Load password(s) for a website" << std::endl;
-    std::cout << "    Example: load gmail.com john@email.com" << std::endl;
-    std::cout << "    Example: load gmail.com (shows all users)" << std::endl;
-    std::cout << "\n  update <website> <user> <new-password>" << std::endl;
-    std::cout << "    Update an existing password" << std::endl;
-    std::cout << "    Example: update gmail.com john@email.com \"new password\"" << std::endl;
-    std::cout << "\n  delete <website> [<user>]" << std::endl;
-    std::cout << "    Delete password(s) for a website" << std::endl;
-    std::cout << "    Example: delete gmail.com john@email.com" << std::endl;
-    std::cout << "    Example: delete gmail.com (deletes all users)" << std::endl;
-
-    std::cout << "\nGeneral:" << std::endl;
-    std::cout << "  help    - Show this help message" << std::endl;
-    std::cout << "  exit    - Exit the application" << std::endl;
-    std::cout << "\nNote: Use quotes around passwords/arguments containing spaces" << std::endl;
-    std::cout << "================================\n" << std::endl;
+    output << "\n=== Password Manager Help ===" << '\n';
+    output << "\nFile Operations:" << '\n';
+    output << "  create <filename> <cipher> <password> [cipher-params]" << '\n';
+    output << "    Create a new password file with specified cipher" << '\n';
+    output << "    Ciphers:" << '\n';
+    for (const CipherType* type : CipherRegistry::instance().types())
+    {
+        output << "      " << type->name << " " << type->usage << '\n';
+    }
+    output << "    Example: create mypass.dat caesar mykey123 3" << '\n';
+    output << "    Example: create mypass.dat chain mykey123 caesar:3,hill:2:3:3:2:5" << '\n';
+    output << "    --file-cipher xor|chacha20|chunked picks how the whole file is encrypted" << '\n';
+    output << "    (default chunked: authenticated 1 MiB records, only changed ones are rewritten)" << '\n';
+    output << "\n  open <filename> [<password>]" << '\n';
+    output << "    Open an existing password file" << '\n';
+    output << "    Example: open mypass.dat mykey123" << '\n';
+    output << "\n  passwd <current-password> <new-password>" << '\n';
+    output << "    Change the master password of the open file (rewrites only the file header)" << '\n';
+    output << "    Example: passwd mykey123 \"new master key\"" << '\n';
+    output << "\n  calibrate [target-ms]" << '\n';
+    output << "    Measure the key derivation speed and pick the cost for a target unlock time (default 250)" << '\n';
+    output << "    Applies to the open file and to files created afterwards" << '\n';
+
+    output << "\nPassword Operations: " << '\n';
+    output << "  save <website> <user> <password>" << '\n';
+    output << "    Save a password for a website and user" << '\n';
+    output << "    Example: save gmail.com john@email.com \"my secure pass\"" << '\n';
+    output << "\n  load <website> [<user>]" << '\n';
+    output << "    Load password(s) for a website; case, www. and a trailing dot are ignored" << '\n';
+    output << "    Example: load gmail.com john@email.com" << '\n';
+    output << "    Example: load gmail.com (shows all users)" << '\n';
+    output << "    Example: load *.google.com (google.com and every subdomain)" << '\n';
+    output << "\n  search <text> [--limit N]" << '\n';
+    output << "    List websites and users containing text, ignoring case (default limit 50)" << '\n';
+    output << "    Example: search mail" << '\n';
+    output << "\n  tag <website> <user> <tag|name=value>..." << '\n';
+    output << "  untag <website> <user> <tag|name>..." << '\n';
+    output << "    Add or remove tags and metadata fields; website may be a pattern, user * means every user" << '\n';
+    output << "    Example: tag *.corp.example * prod owner=infra" << '\n';
+    output << "\n  list [--site prefix] [--sort site|user] [--tag T]... [--field name=value]... [--limit N] [--after cursor]" << '\n';
+    output << "    List entries in order, a page at a time (default 50), carrying every given tag and field" << '\n';
+    output << "    Each page ends with the --after cursor of the next one" << '\n';
+    output << "    Example: list --tag prod --tag db" << '\n';
+    output << "    Example: list --site mail. --sort user --after \"bob|mail.example.com\"" << '\n';
+    output << "\n  update <website> <user> <new-password>" << '\n';
+    output << "    Update an existing password" << '\n';
+    output << "    Example: update gmail.com john@email.com \"new password\"" << '\n';
+    output << "\n  history <website> <user>" << '\n';
+    output << "    Show the earlier passwords of an entry, newest first (chunked files only)" << '\n';
+    output << "  revert <website> <user> [N]" << '\n';
+    output << "    Make the Nth earlier password current again (default 1, the one before the current)" << '\n';
+    output << "  history-keep <N>" << '\n';
+    output << "    Keep the last N passwords of every entry (default 10, 0 keeps none)" << '\n';
+    output << "    Example: revert gmail.com john@email.com 2" << '\n';
+    output << "\n  delete <website> [<user>]" << '\n';
+    output << "    Delete password(s) for a website; like load, case, www. and a trailing dot are ignored" << '\n';
+    output << "    Example: delete gmail.com john@email.com" << '\n';
+    output << "    Example: delete gmail.com (deletes all users)" << '\n';
+    output << "    Example: delete *.old-corp.example (the domain and every subdomain, one pass)" << '\n';
+
+    output << "\n  generate <website> <user> [--length N] [--charset SET] [--count K]" << '\n';
+    output << "    Store a random password (default 20 characters the cipher can hold) and show it" << '\n';
+    output << "    SET: printable, alnum, letters, digits, cipher, or the characters themselves" << '\n';
+    output << "    --count K stores K accounts with one save, numbered from 1 and zero-padded to the width of K" << '\n';
+    output << "    (svc0001..svc5000 for the example below)" << '\n';
+    output << "    Example: generate db.internal svc --count 5000 --charset alnum" << '\n';
+
+    output << "\n  import <file> [--format csv|tsv] [--on-conflict skip|overwrite]" << '\n';
+    output << "    Bulk import website,user,password rows, saving once at the end" << '\n';
+    output << "    Example: import dump.csv --on-conflict overwrite" << '\n';
+
+    output << "\n  export <file> [--decrypt] [--format csv|jsonl]" << '\n';
+    output << "    Write every entry to a file, passwords stay encrypted unless --decrypt is given" << '\n';
+    output << "    Example: export backup.jsonl --decrypt" << '\n';
+
+    output << "\n  fsck <filename> <password>" << '\n';
+    output << "    Check every record of a file in parallel and list the damaged entries" << '\n';
+    output << "    Example: fsck passwords.txt mypassword" << '\n';
+
+    output << "\n  audit [--min-bits N] [--limit N]" << '\n';
+    output << "    Find reused, weak (under N bits, default 60) and stale passwords, grouped per website" << '\n';
+    output << "    Example: audit --limit 50" << '\n';
+
+    output << "\n  audit-cipher [--samples N]" << '\n';
+    output << "    Attack the open file's ciphers with N sampled entries (default 2000) and time each break" << '\n';
+    output << "    Example: audit-cipher --samples 5000" << '\n';
+
+    output << "\n  rekey <cipher> [cipher-params]" << '\n';
+    output << "    Re-encrypt every password with a new cipher and save once" << '\n';
+    output << "    Example: rekey hill 2 3 3 2 5" << '\n';
+
+    output << "\n  migrate <cipher> [cipher-params]" << '\n';
+    output << "    Switch to a new cipher lazily: entries move over when they are read or updated" << '\n';
+    output << "    Example: migrate caesar 7 (rekey moves everything at once)" << '\n';
+    output << "\n  migration status" << '\n';
+    output << "    Show how many entries still use older ciphers" << '\n';
+
+    output << "\nJobs:" << '\n';
+    output << "  open, generate, import, export, fsck, audit, audit-cipher and rekey run in the background; lookups keep working meanwhile" << '\n';
+    output << "  jobs         - Show background jobs with progress" << '\n';
+    output << "  cancel <id>  - Cancel a running background job" << '\n';
+
+    output << "\nGeneral:" << '\n';
+    output << "  help    - Show this help message" << '\n';
+    output << "  exit    - Exit the application" << '\n';
+    output << "\nCommand-line modes:" << '\n';
+    output << "  --daemon <socket> <filename> [--workers N]" << '\n';
+    output << "    Keep the file open and serve load/save/update/delete over a UNIX socket;" << '\n';
+    output << "    the password comes from PM_MASTER_PASSWORD or the first line of stdin" << '\n';
+    output << "  --loadgen <socket> [--connections N] [--requests N] [--keys N]" << '\n';
+    output << "  --loadgen-spawn <filename> [--requests N] [--keys N]" << '\n';
+    output << "    Measure lookup latency against the daemon or one process per lookup;" << '\n';
+    output << "    --loadgen-spawn takes the password like --daemon" << '\n';
+    output << "  --batch <script|-> [--stop-on-error] [--status]" << '\n';
+    output << "    Run commands from a script (or stdin) without prompts, output fully buffered" << '\n';
+    output << "  --bench-rekey [--entries N]" << '\n';
+    output << "    Compare sequential and parallel rekey throughput on a generated vault" << '\n';
+    output << "  --bench-file-cipher [--mb N]" << '\n';
+    output << "    Compare the XOR and ChaCha20 file ciphers (scalar, SSE2, AVX2)" << '\n';
+    output << "  --bench-chain [--passwords N]" << '\n';
+    output << "    Compare fused chain ciphers against running their stages one by one" << '\n';
+    output << "\nNote: Use quotes around passwords/arguments containing spaces" << '\n';
+    output << "================================\n" << '\n';
 }
 bool CommandProcessor::hasOpenFile() const {
     return passwordManager && passwordManager->getIsFileOpen();
 }
 
-std::vector<std::string> CommandProcessor::parseCommand(const std::string& commandLine) const 
+const CommandTable<CommandProcessor::CommandHandler>& CommandProcessor::commandTable()
 {
-	if (commandLine.empty()) {
-		return {};
-	}
-
-    std::vector<std::string> tokens;
+    // name, handler, min and max argument count (the verb included), flags
+    static const CommandTable<CommandHandler> table = []
+    {
+        CommandTable<CommandHandler> commands;
+        commands.add("create", &CommandProcessor::handleCreateCommand, 4, SIZE_MAX);
+        commands.add("open", &CommandProcessor::handleOpenCommand, 2, 3, COMMAND_RUNS_AS_JOB);
+        commands.add("passwd", &CommandProcessor::handlePasswdCommand, 3, 3);
+        commands.add("calibrate", &CommandProcessor::handleCalibrateCommand, 1, 2);
+        commands.add("save", &CommandProcessor::handleSaveCommand, 4, 4);
+        commands.add("load", &CommandProcessor::handleLoadCommand, 2, 3, COMMAND_READ_ONLY);
+        commands.add("search", &CommandProcessor::handleSearchCommand, 2, 4, COMMAND_READ_ONLY);
+        commands.add("tag", &CommandProcessor::handleTagCommand, 4, SIZE_MAX);
+        commands.add("untag", &CommandProcessor::handleTagCommand, 4, SIZE_MAX);
+        commands.add("list", &CommandProcessor::handleListCommand, 1, SIZE_MAX, COMMAND_READ_ONLY);
+        commands.add("update", &CommandProcessor::handleUpdateCommand, 4, 4);
+        commands.add("history", &CommandProcessor::handleHistoryCommand, 3, 3, COMMAND_READ_ONLY);
+        commands.add("history-keep", &CommandProcessor::handleHistoryKeepCommand, 2, 2);
+        commands.add("revert", &CommandProcessor::handleRevertCommand, 3, 4);
+        commands.add("delete", &CommandProcessor::handleDeleteCommand, 2, 3);
+        commands.add("generate", &CommandProcessor::handleGenerateCommand, 3, 9, COMMAND_RUNS_AS_JOB);
+        commands.add("import", &CommandProcessor::handleImportCommand, 2, 6, COMMAND_RUNS_AS_JOB);
+        commands.add("export", &CommandProcessor::handleExportCommand, 2, 5, COMMAND_RUNS_AS_JOB);
+        commands.add("fsck", &CommandProcessor::handleFsckCommand, 3, 3, COMMAND_RUNS_AS_JOB);
+        commands.add("audit", &CommandProcessor::handleAuditCommand, 1, 5, COMMAND_RUNS_AS_JOB);
+        commands.add("audit-cipher", &CommandProcessor::handleAuditCipherCommand, 1, 3, COMMAND_RUNS_AS_JOB);
+        commands.add("rekey", &CommandProcessor::handleRekeyCommand, 3, SIZE_MAX, COMMAND_RUNS_AS_JOB);
+        commands.add("migrate", &CommandProcessor::handleMigrateCommand, 3, SIZE_MAX);
+        commands.add("migration", &CommandProcessor::handleMigrationCommand, 2, 2, COMMAND_READ_ONLY);
+        commands.add("jobs", &CommandProcessor::handleJobsCommand, 1, 1, COMMAND_READ_ONLY);
+        commands.add("cancel", &CommandProcessor::handleCancelCommand, 2, 2, COMMAND_READ_ONLY);
+        return commands;
+    }();
+    return table;
+}
 
-    bool inQuotes = false;
-    std::string currentToken;
+void CommandProcessor::parseCommand(std::string_view commandLine, Arguments& tokens) const 
+{
+    tokens.clear();
 
-    for (size_t i = 0; i < commandLine.length(); ++i)
+    size_t i = 0;
+    const size_t length = commandLine.length();
+    while (i < length)
     {
         char c = commandLine[i];
 
-        if (c == '"' && !inQuotes)
+        if (c == ' ' || c == '\t')
         {
-            inQuotes = true;
+            ++i;
         }
-        else if (c == '"' && inQuotes)
+        else if (c == '"')
         {
-            inQuotes = false;
-            if (!currentToken.empty())
+            // quoted argument: everything up to the closing quote (or the end of the line)
+            size_t start = i + 1;
+            size_t close = commandLine.find('"', start);
+            size_t stop = (close == std::string_view::npos) ? length : close;
+            if (stop > start)
             {
-                tokens.push_back(currentToken);
-                currentToken.clear();
+                tokens.push_back(commandLine.substr(start, stop - start));
             }
+            i = (close == std::string_view::npos) ? length : close + 1;
         }
-        else if (c == ' ' && !inQuotes)
+        else
         {
-            if (!currentToken.empty())
+            size_t start = i;
+            while (i < length && commandLine[i] != ' ' && commandLine[i] != '\t' && commandLine[i] != '"')
             {
-                tokens.push_back(currentToken);
-                currentToken.clear();
+                ++i;
             }
+            tokens.push_back(commandLine.substr(start, i - start));
         }
-        else {
-            currentToken += c;
-        }
-    }
-
-    if (!currentToken.empty())
-    {
-        tokens.push_back(currentToken);
     }
-
-    return tokens;
 }
 void CommandProcessor::processCommand(const std::string& commandLine)
 {
@@ -108,61 +243,105 @@ void CommandProcessor::processCommand(const std::string& commandLine)
         return;
     }
 
-    std::vector<std::string> args = parseCommand(commandLine);
+    Arguments args;
+    parseCommand(commandLine, args);
     if (args.empty())
     {
         return;
     }
 
-    std::string command = args[0];
+    // case-insensitive lookup, see CommandTable
+    const CommandTable<CommandHandler>::Entry* command = commandTable().find(args[0]);
+    if (command == nullptr)
+    {
+        throw std::invalid_argument("Unknown command: " + std::string(args[0]));
+    }
+
+    validateArguments(args, command->minArgs, command->maxArgs);
 
-    // case-insensitive 
-    for (size_t i = 0; i < command.length(); ++i)
+    if (command->flags & COMMAND_READ_ONLY)
     {
-        if (command[i] >= 'A' && command[i] <= 'Z')
-        {
-            command[i] = command[i] + ('a' - 'A');
-        }
+        // lookups may run next to a background job
+        std::shared_lock<std::shared_mutex> lock(managerMutex);
+        (this->*(command->handler))(args);
+        return;
     }
 
-    try {
-        if (command == "create")
-        {
-            handleCreateCommand(args);
-        }
-        else if (command == "open")
-        {
-            handleOpenCommand(args);
-        }
-        else if (command == "save")
-        {
-            handleSaveCommand(args);
-        }
-        else if (command == "load")
-        {
-            handleLoadCommand(args);
-        }
-        else if (command == "update")
-        {
-            handleUpdateCommand(args);
-        }
-        else if (command == "delete")
-        {
-            handleDeleteCommand(args);
-        }
-        else
-        {
-            throw std::invalid_argument("Unknown command: " + command);
-        }
+    if (jobs.hasActiveJob())
+    {
+        throw std::runtime_error("A background job is still running. Use 'jobs' to follow it or 'cancel <id>' to stop it.");
     }
-    catch (const std::exception& e)
+    if (command->flags & COMMAND_RUNS_AS_JOB)
+    {
+        (this->*(command->handler))(args); // takes the lock itself once the work is done
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(managerMutex);
+    (this->*(command->handler))(args);
+}
+
+void CommandProcessor::runJob(const std::string& description, JobManager::Work work)
+{
+    if (backgroundJobs)
+    {
+        size_t id = jobs.submit(description, std::move(work));
+        output << "Started job " << id << ": " << description << " (see 'jobs', 'cancel " << id << "')" << '\n';
+        return;
+    }
+
+    JobControl control;
+    output << work(control) << '\n';
+}
+std::string CommandProcessor::optionValue(const Arguments& args, size_t& index) const
+{
+    if (index + 1 >= args.size())
+    {
+        throw std::invalid_argument("Missing value for option " + std::string(args[index]));
+    }
+    return std::string(args[++index]);
+}
+
+void CommandProcessor::migrateTouched(std::vector<PasswordManager::EntryKey>& keys)
+{
+    std::unique_lock<std::shared_mutex> lock(managerMutex);
+    if (passwordManager && passwordManager->getIsFileOpen())
+    {
+        passwordManager->migrateEntries(keys); // keys of a file closed meanwhile simply match nothing
+    }
+}
+
+void CommandProcessor::reportFinishedJobs()
+{
+    jobs.reportFinished(output);
+}
+
+void CommandProcessor::handleJobsCommand(const Arguments&)
+{
+    jobs.printJobs(output);
+}
+void CommandProcessor::handleCancelCommand(const Arguments& args)
+{
+    char* end;
+    std::string idText(args[1]);
+    unsigned long id = std::strtoul(idText.c_str(), &end, 10);
+    if (*end != '\0' || idText.empty())
+    {
+        throw std::invalid_argument("Invalid job id: " + idText);
+    }
+
+    if (jobs.cancel(id))
     {
-        throw; // Re-throw for the main
+        output << "Cancellation requested for job " << id << "." << '\n';
+    }
+    else
+    {
+        output << "Job " << id << " has already finished." << '\n';
     }
 }
 
 
-void CommandProcessor::validateArguments(const std::vector<std::string>& args, size_t expectedMin, size_t expectedMax) const 
+void CommandProcessor::validateArguments(const Arguments& args, size_t expectedMin, size_t expectedMax) const 
 {
     if (args.size() < expectedMin) 
     {
@@ -173,9 +352,23 @@ void CommandProcessor::validateArguments(const std::vector<std::string>& args, s
         throw std::invalid_argument("Too many arguments for command");
     }
 }
+std::string CommandProcessor::didYouMean(const std::string& website) const
+{
+    std::string host = DomainIndex::normalize(DomainIndex::isPattern(website) ? website.substr(2) : website);
+    std::string text;
+    for (const std::string& suggestion : passwordManager->suggestWebsites(website, 5))
+    {
+        if (suggestion != host) // the host is there, only the user is not
+        {
+            text += (text.empty() ? " Did you mean: " : ", ") + suggestion;
+        }
+    }
+    return text.empty() ? text : text + "?";
+}
+
 bool CommandProcessor::isValidCipherType(const std::string& cipherType) const
 {
-    return (cipherType == "caesar" || cipherType == "textcode" || cipherType == "hill");
+    return CipherRegistry::instance().find(cipherType) != nullptr;
 }
 
 //int CommandProcessor::parsePositiveInteger(const std::string& str, const std::string& paramName, int minVal, int maxVal) const
@@ -253,23 +446,8 @@ Cipher* CommandProcessor::createCipher(const std::string& cipherType, const std:
         throw std::invalid_argument("Unknown cipher type: " + cipherType);
     }*/
 
-    Cipher* newCipher = CipherFactory::createCipher(cipherType, cipherParams);
-
-    if (passwordManager != nullptr && newCipher != nullptr)
-    {
-        Cipher* oldCipher = passwordManager->getFileCipher();
-
-        passwordManager->setFileCipher(newCipher);
-
-		// delete the old cipher to avoid memory leaks
-        if (oldCipher != nullptr)
-        {
-            delete oldCipher;
-            oldCipher = nullptr;
-        }
-    }
-
-    return newCipher;
+    // the open file keeps its cipher, switching one is what rekey is for
+    return CipherFactory::createCipher(cipherType, cipherParams);
 }
 
 void CommandProcessor::validateFileAccess(const std::string& filename) const
@@ -288,27 +466,48 @@ void CommandProcessor::validateFileAccess(const std::string& filename) const
     }
 }
 
-void CommandProcessor::handleCreateCommand(const std::vector<std::string>& args)
+void CommandProcessor::handleCreateCommand(const Arguments& args)
 {
-    // create <filename> <cipher> <password> [cipher-params...]
-    validateArguments(args, 4, SIZE_MAX);
+    // create <filename> <cipher> <password> [cipher-params...] [--file-cipher xor|chacha20|chunked]
 	//args[0] is the command, args[1] is the filename, args[2] is the cipher type, args[3] is the file password
-    std::string filename = args[1];
-    std::string cipherType = args[2];
-    std::string filePassword = args[3];
+    std::string filename(args[1]);
+    std::string cipherType(args[2]);
+    std::string filePassword(args[3]);
 
     validateFileAccess(filename);
 
     if (!isValidCipherType(cipherType))
     {
-        throw std::invalid_argument("Invalid cipher type. Supported: caesar, textcode, hill");
+        throw std::invalid_argument("Invalid cipher type. Supported: " + CipherRegistry::instance().names());
     }
 
 	// Additional parameters for the cipher
     std::vector<std::string> cipherParams;
+    VaultHeader::BodyMode fileMode = VaultHeader::BODY_CHUNKED;
     for (size_t i = 4; i < args.size(); ++i) 
     {
-        cipherParams.push_back(args[i]);
+        if (args[i] == "--file-cipher")
+        {
+            std::string mode(optionValue(args, i));
+            if (mode == "xor")
+            {
+                fileMode = VaultHeader::BODY_XOR;
+            }
+            else if (mode == "chacha20")
+            {
+                fileMode = VaultHeader::BODY_CHACHA20;
+            }
+            else if (mode == "chunked")
+            {
+                fileMode = VaultHeader::BODY_CHUNKED;
+            }
+            else
+            {
+                throw std::invalid_argument("Invalid file cipher: " + mode + " (expected xor, chacha20 or chunked)");
+            }
+            continue;
+        }
+        cipherParams.emplace_back(args[i]);
     }
 
 	// Creating the cipher based on the type and parameters
@@ -326,6 +525,9 @@ void CommandProcessor::handleCreateCommand(const std::vector<std::string>& args)
 	// Create a new PasswordManager instance
     delete passwordManager;
     passwordManager = new PasswordManager();
+    passwordManager->setOutput(&output);
+    passwordManager->setKdfIterations(kdfIterations);
+    passwordManager->setFileMode(fileMode);
 
     try 
     {
@@ -339,14 +541,27 @@ void CommandProcessor::handleCreateCommand(const std::vector<std::string>& args)
         throw;
     }
 
-    std::cout << "Password file '" << filename << "' created successfully with " << cipherType << " cipher." << std::endl;
+    output << "Password file '" << filename << "' created successfully with " << cipherType << " cipher." << '\n';
 }
-void CommandProcessor::handleOpenCommand(const std::vector<std::string>& args)
+void CommandProcessor::handleOpenCommand(const Arguments& args)
 {
-    // open <filename> <password>
-    validateArguments(args, 3, 3);
-    std::string filename = args[1];
-    std::string filePassword = args[2];
+    // open <filename> [<password>]
+    std::string filename(args[1]);
+    std::string filePassword;
+    if (args.size() == 3)
+    {
+        filePassword = std::string(args[2]);
+    }
+    else
+    {
+        // keeps the password out of scripts, e.g. for children of --loadgen-spawn
+        const char* fromEnvironment = std::getenv("PM_MASTER_PASSWORD");
+        if (fromEnvironment == nullptr || *fromEnvironment == '\0')
+        {
+            throw std::invalid_argument("open needs a password, or PM_MASTER_PASSWORD set");
+        }
+        filePassword = fromEnvironment;
+    }
     validateFileAccess(filename);
 
     std::ifstream testFile(filename);
@@ -359,25 +574,110 @@ void CommandProcessor::handleOpenCommand(const std::vector<std::string>& args)
     testFile.close();
  
 
-    delete passwordManager; 
-    passwordManager = new PasswordManager();
-    passwordManager->openFile(filename, filePassword);
+    // the current file stays usable for lookups until the new one is fully loaded
+    runJob("open " + filename, [this, filename, filePassword](JobControl& control)
+    {
+        PasswordManager* opened = new PasswordManager();
+        opened->setOutput(nullptr);
+        opened->setJobControl(&control);
+        try
+        {
+            opened->openFile(filename, filePassword);
+        }
+        catch (...)
+        {
+            delete opened;
+            throw;
+        }
+        opened->setJobControl(nullptr);
+        opened->setOutput(&output);
 
-    std::cout << "Password file '" << filename << "' opened successfully." << std::endl;
+        std::unique_lock<std::shared_mutex> lock(managerMutex);
+        delete passwordManager;
+        passwordManager = opened;
+        return "Password file '" + filename + "' opened successfully.";
+    });
 }
-void CommandProcessor::handleSaveCommand(const std::vector<std::string>& args)
+void CommandProcessor::handlePasswdCommand(const Arguments& args)
+{
+    // passwd <current-password> <new-password>
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    passwordManager->changeMasterPassword(std::string(args[1]), std::string(args[2]));
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+    output << "Master password changed for '" << passwordManager->getFilename() << "' in " << milliseconds << " ms." << '\n';
+}
+void CommandProcessor::handleCalibrateCommand(const Arguments& args)
+{
+    // calibrate [target-ms]
+    double targetMilliseconds = 250;
+    if (args.size() == 2)
+    {
+        char* end;
+        std::string targetText(args[1]);
+        targetMilliseconds = std::strtod(targetText.c_str(), &end);
+        if (*end != '\0' || targetText.empty() || targetMilliseconds <= 0 || targetMilliseconds > 60000)
+        {
+            throw std::invalid_argument("Invalid target time in ms: " + targetText);
+        }
+    }
+
+    output << "Calibrating PBKDF2-HMAC-SHA256 for a " << targetMilliseconds << " ms unlock..." << '\n';
+
+    // an unlock runs on one core, that rate sets the cost
+    double singleCore = KeyDerivation::iterationsPerSecond();
+
+    size_t cores = ThreadPool::defaultThreadCount();
+    std::vector<double> rates(cores, 0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < cores; ++i)
+    {
+        threads.emplace_back([&rates, i] { rates[i] = KeyDerivation::iterationsPerSecond(); });
+    }
+    double total = 0;
+    for (size_t i = 0; i < cores; ++i)
+    {
+        threads[i].join();
+        total += rates[i];
+    }
+
+    // every iteration is two HMAC halves, one SHA-256 block each
+    output << "  1 core:   " << static_cast<uint64_t>(singleCore) << " iterations/s ("
+        << static_cast<uint64_t>(singleCore * 2) << " SHA-256 blocks/s)" << '\n';
+    output << "  " << cores << " core(s): " << static_cast<uint64_t>(total) << " iterations/s, "
+        << static_cast<uint64_t>(total / cores) << " per core" << '\n';
+
+    kdfIterations = KeyDerivation::iterationsForTarget(singleCore, targetMilliseconds);
+    output << "  Cost: " << kdfIterations << " iterations (about " << static_cast<int>(kdfIterations * 1000.0 / singleCore)
+        << " ms per unlock here)" << '\n';
+
+    if (passwordManager && passwordManager->getIsFileOpen())
+    {
+        passwordManager->changeKdfCost(kdfIterations);
+        output << "Resealed the header of '" << passwordManager->getFilename() << "' with the new cost." << '\n';
+    }
+    else
+    {
+        output << "Files created in this session will use the new cost." << '\n';
+    }
+}
+void CommandProcessor::handleSaveCommand(const Arguments& args)
 {
     // save <website> <user> <password>
-    validateArguments(args, 4, 4);
 
     if (!passwordManager || !passwordManager->getIsFileOpen()) 
     {
         throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
     }
 
-    std::string website = args[1];
-    std::string user = args[2];
-    std::string password = args[3];
+    std::string website(args[1]);
+    std::string user(args[2]);
+    std::string password(args[3]);
 
     if (website.empty() || user.empty() || password.empty())
     {
@@ -385,19 +685,18 @@ void CommandProcessor::handleSaveCommand(const std::vector<std::string>& args)
     }
 
     passwordManager->addPassword(website, user, password);
-    std::cout << "Password saved successfully for " << user << "@" << website << std::endl;
+    output << "Password saved successfully for " << user << "@" << website << '\n';
 }
-void CommandProcessor::handleLoadCommand(const std::vector<std::string>& args)
+void CommandProcessor::handleLoadCommand(const Arguments& args)
 {
     // load <website> [<user>]
-    validateArguments(args, 2, 3);
 
     if (!passwordManager || !passwordManager->getIsFileOpen()) 
     {
         throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
     }
 
-    std::string website = args[1];
+    std::string website(args[1]);
     if (website.empty())
     {
         throw std::invalid_argument("Website cannot be empty");
@@ -406,72 +705,355 @@ void CommandProcessor::handleLoadCommand(const std::vector<std::string>& args)
     if (args.size() == 3)
     {
 		// Specific user 
-        std::string user = args[2];
+        std::string user(args[2]);
         if (user.empty()) 
         {
             throw std::invalid_argument("User cannot be empty");
         }
 
-		PasswordEntry* entry = passwordManager->findPassword(website, user);
-
-        std::string decryptedPassword = passwordManager->getFileCipher()->decrypt(entry->getPassword());
-		std::cout << "Password for " << user << "@" << website << ": " << decryptedPassword << std::endl; // this shows the decrypted password
+        // the website may be spelled differently or be a pattern, so the user can have several entries
+        std::vector<PasswordManager::EntryKey> legacy;
+        bool found = false;
+        for (const PasswordEntry& entry : passwordManager->loadAllUsers(website))
+        {
+            if (entry.getUsername() != user)
+            {
+                continue;
+            }
+            found = true;
+            std::string decryptedPassword = passwordManager->decryptPassword(entry);
+            if (entry.getGeneration() != passwordManager->getCipherGeneration())
+            {
+                legacy.emplace_back(entry.getWebsite(), user);
+            }
+            output << "Password for " << user << "@" << entry.getWebsite() << ": " << decryptedPassword << '\n'; // this shows the decrypted password
+        }
+        if (!found)
+        {
+            throw std::runtime_error("Password not found for " + user + "@" + website + "." + didYouMean(website));
+        }
+        migrator.enqueue(legacy);
 
-		//std::cout << "Password for " << user << "@" << website << ": " << entry->getPassword() << std::endl; //this shows the encrypted password
+		//output << "Password for " << user << "@" << website << ": " << entry->getPassword() << '\n'; //this shows the encrypted password
     }
     else
     {
 		// Everty user for the website
         auto users = passwordManager->loadAllUsers(website);
+        std::stable_sort(users.begin(), users.end(), [](const PasswordEntry& a, const PasswordEntry& b)
+        {
+            return a.getWebsite() < b.getWebsite(); // one heading per website a pattern matched
+        });
         if (users.empty()) 
         {
-            std::cout << "No passwords found for website: " << website << std::endl;
+            output << "No passwords found for website: " << website << "." << didYouMean(website) << '\n';
         }
         else 
         {
-            std::cout << "Passwords for " << website << ":" << std::endl;
+            std::vector<PasswordManager::EntryKey> legacy;
+            std::string shownWebsite;
             for (const auto& userPass : users) 
             {
-                std::string decryptedPassword = passwordManager->getFileCipher()->decrypt(userPass.getPassword());
-				std::cout << "  " << userPass.getUsername() << ": " << decryptedPassword << std::endl; // this shows the decrypted password
+                if (userPass.getWebsite() != shownWebsite || shownWebsite.empty())
+                {
+                    shownWebsite = userPass.getWebsite();
+                    output << "Passwords for " << shownWebsite << ":" << '\n';
+                }
+                std::string decryptedPassword = passwordManager->decryptPassword(userPass);
+                if (userPass.getGeneration() != passwordManager->getCipherGeneration())
+                {
+                    legacy.emplace_back(userPass.getWebsite(), userPass.getUsername());
+                }
+				output << "  " << userPass.getUsername() << ": " << decryptedPassword << '\n'; // this shows the decrypted password
 
-				//std::cout << "  " << userPass.getUsername() << ": " << userPass.getPassword() << std::endl; // this shows the encrypted password
+				//output << "  " << userPass.getUsername() << ": " << userPass.getPassword() << '\n'; // this shows the encrypted password
             }
+            migrator.enqueue(legacy);
+        }
+    }
+}
+void CommandProcessor::handleSearchCommand(const Arguments& args)
+{
+    // search <text> [--limit N]
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+
+    std::string text(args[1]);
+    unsigned long limit = 50;
+    for (size_t i = 2; i < args.size(); ++i)
+    {
+        if (args[i] != "--limit")
+        {
+            throw std::invalid_argument("Unknown option for search: " + std::string(args[i]));
+        }
+        std::string value = optionValue(args, i);
+        char* end;
+        limit = std::strtoul(value.c_str(), &end, 10);
+        if (*end != '\0' || value.empty())
+        {
+            throw std::invalid_argument("Invalid value for --limit: " + value);
+        }
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    size_t total = 0;
+    std::vector<SearchIndex::Match> matches = passwordManager->search(text, limit, total);
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+    for (const SearchIndex::Match& match : matches)
+    {
+        output << "  " << match.website << "  " << match.username << '\n';
+    }
+    if (total > matches.size())
+    {
+        output << "  ... and " << (total - matches.size()) << " more" << '\n';
+    }
+    output << total << " match(es) for '" << text << "' in " << milliseconds << " ms" << '\n';
+}
+void CommandProcessor::handleTagCommand(const Arguments& args)
+{
+    // tag <website> <user> <tag|name=value>...
+    // untag <website> <user> <tag|name[=value]>...
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+
+    bool removing = args[0] == "untag";
+    std::string website(args[1]);
+    std::string user(args[2]);
+    std::vector<std::string> tags;
+    std::vector<std::pair<std::string, std::string>> fields;
+    for (size_t i = 3; i < args.size(); ++i)
+    {
+        std::string item(args[i]);
+        size_t equals = item.find('=');
+        if (equals == std::string::npos)
+        {
+            tags.push_back(item);
+        }
+        else if (equals == 0 || (!removing && equals + 1 == item.size()))
+        {
+            throw std::invalid_argument("Invalid field, expected name=value: " + item);
         }
+        else
+        {
+            fields.emplace_back(item.substr(0, equals), item.substr(equals + 1));
+        }
+    }
+
+    size_t matched = 0;
+    size_t changed = passwordManager->tagEntries(website, user, tags, fields, removing, matched);
+    if (matched == 0)
+    {
+        throw std::runtime_error("Password not found for " + user + "@" + website + "." + didYouMean(website));
     }
+    output << (removing ? "Untagged " : "Tagged ") << changed << " of " << matched << " matching entries" << '\n';
 }
-void CommandProcessor::handleUpdateCommand(const std::vector<std::string>& args)
+void CommandProcessor::handleListCommand(const Arguments& args)
+{
+    // list [--site prefix] [--sort site|user] [--tag T]... [--field name=value]... [--limit N] [--after cursor]
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+
+    PasswordManager::ListQuery query;
+    query.order = SortedIndex::BY_WEBSITE;
+    query.limit = 50;
+    std::string sort = "site";
+    for (size_t i = 1; i < args.size(); ++i)
+    {
+        if (args[i] == "--tag")
+        {
+            query.tags.push_back(optionValue(args, i));
+        }
+        else if (args[i] == "--field")
+        {
+            std::string field = optionValue(args, i);
+            size_t equals = field.find('=');
+            if (equals == std::string::npos || equals == 0 || equals + 1 == field.size())
+            {
+                throw std::invalid_argument("Invalid value for --field, expected name=value: " + field);
+            }
+            query.fields.emplace_back(field.substr(0, equals), field.substr(equals + 1));
+        }
+        else if (args[i] == "--site")
+        {
+            query.sitePrefix = optionValue(args, i);
+        }
+        else if (args[i] == "--sort")
+        {
+            sort = optionValue(args, i);
+            if (sort != "site" && sort != "user")
+            {
+                throw std::invalid_argument("Unknown sort order: " + sort + " (expected site or user)");
+            }
+            query.order = sort == "site" ? SortedIndex::BY_WEBSITE : SortedIndex::BY_USERNAME;
+        }
+        else if (args[i] == "--after")
+        {
+            query.after = optionValue(args, i);
+        }
+        else if (args[i] == "--limit")
+        {
+            std::string value = optionValue(args, i);
+            char* end;
+            query.limit = std::strtoul(value.c_str(), &end, 10);
+            if (*end != '\0' || value.empty() || query.limit == 0)
+            {
+                throw std::invalid_argument("Invalid value for --limit: " + value);
+            }
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown option for list: " + std::string(args[i]));
+        }
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::string next;
+    std::vector<const PasswordEntry*> entries = passwordManager->listEntries(query, next);
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+    for (const PasswordEntry* entry : entries)
+    {
+        output << "  " << entry->getWebsite() << "  " << entry->getUsername();
+        for (const std::string& tag : entry->getTags())
+        {
+            output << "  #" << tag;
+        }
+        for (const auto& field : entry->getFields())
+        {
+            output << "  " << field.first << "=" << field.second;
+        }
+        output << '\n';
+    }
+    output << entries.size() << " entries in " << milliseconds << " ms" << '\n';
+    if (!next.empty())
+    {
+        output << "Next page: --after \"" << next << "\"" << '\n';
+    }
+}
+void CommandProcessor::handleUpdateCommand(const Arguments& args)
 {
 	// update <website> <user> <new-password>
-	validateArguments(args, 4, 4);
 	if (!passwordManager || !passwordManager->getIsFileOpen())
 	{
 		throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
 	}
-	std::string website = args[1];
-	std::string user = args[2];
-	std::string newPassword = args[3];
+	std::string website(args[1]);
+	std::string user(args[2]);
+	std::string newPassword(args[3]);
 	if (website.empty() || user.empty() || newPassword.empty())
 	{
 		throw std::invalid_argument("Website, user, and new password cannot be empty");
 	}
 	if (!passwordManager->updatePassword(website, user, newPassword))
 	{
-		throw std::runtime_error("Password not found for " + user + "@" + website);
+		throw std::runtime_error("Password not found for " + user + "@" + website + "." + didYouMean(website));
 	}
-	std::cout << "Password updated successfully for " << user << "@" << website << std::endl;
+	output << "Password updated successfully for " << user << "@" << website << '\n';
+}
+void CommandProcessor::handleHistoryCommand(const Arguments& args)
+{
+    // history <website> <user>
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+    std::string website(args[1]);
+    std::string user(args[2]);
+    if (passwordManager->findPassword(website, user) == nullptr)
+    {
+        throw std::runtime_error("Password not found for " + user + "@" + website + "." + didYouMean(website));
+    }
+
+    std::vector<PasswordHistory::Version> versions = passwordManager->getHistory(website, user);
+    if (versions.empty())
+    {
+        output << "No earlier passwords for " << user << "@" << website
+            << (passwordManager->getFileMode() == VaultHeader::BODY_CHUNKED ? "" : " (history needs a chunked file)") << '\n';
+        return;
+    }
+
+    output << "Earlier passwords for " << user << "@" << website << ", newest first:" << '\n';
+    for (size_t i = 0; i < versions.size(); ++i)
+    {
+        std::time_t replaced = static_cast<std::time_t>(versions[i].replaced);
+        std::tm local;
+        char when[32];
+        localtime_r(&replaced, &local);
+        std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &local);
+
+        output << "  " << (i + 1) << "  replaced " << when << "  ";
+        try
+        {
+            Cipher* cipher = passwordManager->getCipherFor(versions[i].generation);
+            output << cipher->decrypt(versions[i].password) << '\n';
+        }
+        catch (const std::exception& e)
+        {
+            output << "(" << e.what() << ")" << '\n';
+        }
+    }
+}
+void CommandProcessor::handleHistoryKeepCommand(const Arguments& args)
+{
+    // history-keep <N>
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+    std::string value(args[1]);
+    char* end;
+    unsigned long keep = std::strtoul(value.c_str(), &end, 10);
+    if (*end != '\0' || value.empty() || keep > 1000)
+    {
+        throw std::invalid_argument("Invalid number of versions to keep: " + value + " (0 to 1000)");
+    }
+    passwordManager->setHistoryKeep(keep);
+    output << "Keeping the last " << keep << " password(s) of every entry" << '\n';
 }
-void CommandProcessor::handleDeleteCommand(const std::vector<std::string>& args)
+void CommandProcessor::handleRevertCommand(const Arguments& args)
+{
+    // revert <website> <user> [N]
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+    std::string website(args[1]);
+    std::string user(args[2]);
+    unsigned long version = 1;
+    if (args.size() == 4)
+    {
+        std::string value(args[3]);
+        char* end;
+        version = std::strtoul(value.c_str(), &end, 10);
+        if (*end != '\0' || value.empty() || version == 0)
+        {
+            throw std::invalid_argument("Invalid version: " + value);
+        }
+    }
+    if (passwordManager->findPassword(website, user) == nullptr)
+    {
+        throw std::runtime_error("Password not found for " + user + "@" + website + "." + didYouMean(website));
+    }
+    passwordManager->revertPassword(website, user, version);
+    output << "Reverted " << user << "@" << website << " to earlier password " << version << '\n';
+}
+void CommandProcessor::handleDeleteCommand(const Arguments& args)
 {
     // delete <website> [<user>]
-    validateArguments(args, 2, 3);
 
     if (!passwordManager || !passwordManager->getIsFileOpen())
     {
         throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
     }
 
-    std::string website = args[1];
+    std::string website(args[1]);
     if (website.empty())
     {
         throw std::invalid_argument("Website cannot be empty");
@@ -480,17 +1062,424 @@ void CommandProcessor::handleDeleteCommand(const std::vector<std::string>& args)
     if (args.size() == 3) 
     {
      
-        std::string user = args[2];
+        std::string user(args[2]);
         if (user.empty()) {
             throw std::invalid_argument("User cannot be empty");
         }
 
-        passwordManager->deletePassword(website, user);
-        std::cout << "Password deleted successfully for " << user << "@" << website << std::endl;
+        // without a pattern, the one entry load and update resolve; a pattern deletes the user under every matching host
+        int deletedCount = DomainIndex::isPattern(website) ? passwordManager->deletePasswordsByWebsite(website, user)
+            : (passwordManager->deletePassword(website, user) ? 1 : 0);
+        output << "Deleted " << deletedCount << " password(s) for " << user << "@" << website << "." << (deletedCount == 0 ? didYouMean(website) : "") << '\n';
     }
     else 
     {
         int deletedCount = passwordManager->deletePasswordsByWebsite(website);
-        std::cout << "Deleted " << deletedCount << " password(s) for website: " << website << std::endl;
+        output << "Deleted " << deletedCount << " password(s) for website: " << website << "." << (deletedCount == 0 ? didYouMean(website) : "") << '\n';
+    }
+}
+void CommandProcessor::handleGenerateCommand(const Arguments& args)
+{
+    // generate <website> <user> [--length N] [--charset SET] [--count K]
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+
+    std::string website(args[1]);
+    std::string user(args[2]);
+    if (website.find_first_of("|\n") != std::string::npos || user.find_first_of("|\n") != std::string::npos)
+    {
+        throw std::invalid_argument("Website and user cannot contain '|' or line breaks.");
+    }
+
+    unsigned long length = 20;
+    unsigned long count = 1;
+    std::string charset = "cipher";
+    for (size_t i = 3; i < args.size(); ++i)
+    {
+        std::string option(args[i]);
+        if (option == "--charset")
+        {
+            charset = optionValue(args, i);
+            continue;
+        }
+        if (option != "--length" && option != "--count")
+        {
+            throw std::invalid_argument("Unknown option for generate: " + option);
+        }
+
+        std::string value = optionValue(args, i);
+        char* end;
+        unsigned long number = std::strtoul(value.c_str(), &end, 10);
+        if (*end != '\0' || value.empty() || number == 0 || number > 10000000)
+        {
+            throw std::invalid_argument("Invalid value for " + option + ": " + value);
+        }
+        (option == "--length" ? length : count) = number;
+    }
+
+    std::shared_ptr<Cipher> cipher(passwordManager->getFileCipher()->clone());
+    std::shared_ptr<PasswordGenerator> generator = std::make_shared<PasswordGenerator>(PasswordGenerator::parseCharset(charset, *cipher), length);
+
+    if (count == 1)
+    {
+        // one password is shown to the user, so it is generated here rather than in a job
+        std::string password = generator->next();
+        std::string encrypted;
+        if (!Rekeyer::encryptLossless(*cipher, password, encrypted))
+        {
+            throw std::runtime_error("The " + cipher->getType() + " cipher cannot store this password without loss. "
+                "Pick a --charset and --length it can hold.");
+        }
+
+        std::unique_lock<std::shared_mutex> lock(managerMutex);
+        if (passwordManager->findPassword(website, user))
+        {
+            throw std::runtime_error("A password for " + user + "@" + website + " already exists. Use 'update' to change it.");
+        }
+        std::vector<PasswordEntry> entries{ PasswordEntry(website, user, encrypted) };
+        passwordManager->mergeEntries(entries, false);
+        output << "Generated password for " << user << "@" << website << ": " << password << '\n';
+        return;
+    }
+
+    runJob("generate " + std::to_string(count) + " for " + website, [this, website, user, count, cipher, generator](JobControl& control)
+    {
+        auto started = std::chrono::steady_clock::now();
+
+        // <user>0001 ... <user>5000 sort in creation order
+        size_t width = std::to_string(count).size();
+        std::vector<std::string> users;
+        users.reserve(count);
+        for (unsigned long i = 1; i <= count; ++i)
+        {
+            std::string number = std::to_string(i);
+            users.push_back(user + std::string(width - number.size(), '0') + number);
+        }
+
+        std::vector<PasswordEntry> entries = generator->generateEntries(website, users, *cipher, control);
+        control.checkpoint(); // last chance, the merge and its save are not interrupted
+
+        PasswordManager::MergeResult merged;
+        {
+            std::unique_lock<std::shared_mutex> lock(managerMutex);
+            merged = passwordManager->mergeEntries(entries, false);
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return "Generated " + std::to_string(merged.added) + " accounts " + users.front() + ".." + users.back() + " for " + website
+            + " (" + std::to_string(merged.skipped) + " already existed and were left alone) in " + std::to_string(seconds)
+            + " s. Use 'load " + website + "' or 'export --decrypt' to read them.";
+    });
+}
+
+void CommandProcessor::handleImportCommand(const Arguments& args)
+{
+    // import <file> [--format csv|tsv] [--on-conflict skip|overwrite]
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+
+    std::string importFile(args[1]);
+    bool tsvName = importFile.size() > 4 && importFile.compare(importFile.size() - 4, 4, ".tsv") == 0;
+    BulkImporter::Format format = tsvName ? BulkImporter::TSV : BulkImporter::CSV;
+    bool overwrite = false;
+
+    for (size_t i = 2; i < args.size(); ++i)
+    {
+        if (args[i] == "--format")
+        {
+            format = BulkImporter::parseFormat(optionValue(args, i));
+        }
+        else if (args[i] == "--on-conflict")
+        {
+            std::string policy = optionValue(args, i);
+            if (policy != "skip" && policy != "overwrite")
+            {
+                throw std::invalid_argument("Invalid conflict policy: " + policy + " (expected skip or overwrite)");
+            }
+            overwrite = policy == "overwrite";
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown option for import: " + std::string(args[i]));
+        }
+    }
+
+    runJob("import " + importFile, [this, importFile, format, overwrite](JobControl& control)
+    {
+        auto started = std::chrono::steady_clock::now();
+
+        std::unique_ptr<Cipher> cipher;
+        {
+            std::shared_lock<std::shared_mutex> lock(managerMutex);
+            cipher.reset(passwordManager->getFileCipher()->clone());
+        }
+
+        // parsing and encryption run without the lock, only the merge is exclusive
+        BulkImporter importer(importFile, format, *cipher);
+        BulkImporter::Stats stats;
+        std::vector<PasswordEntry> entries = importer.run(control, stats);
+        control.checkpoint(); // last chance, the merge and its save are not interrupted
+
+        PasswordManager::MergeResult merged;
+        {
+            std::unique_lock<std::shared_mutex> lock(managerMutex);
+            merged = passwordManager->mergeEntries(entries, overwrite);
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return "Imported " + std::to_string(merged.added) + " new, " + std::to_string(merged.overwritten) + " overwritten, "
+            + std::to_string(merged.skipped) + " skipped, " + std::to_string(stats.rejected) + " rejected of "
+            + std::to_string(stats.rows) + " rows from '" + importFile + "' in " + std::to_string(seconds) + " s.";
+    });
+}
+
+void CommandProcessor::handleExportCommand(const Arguments& args)
+{
+    // export <file> [--decrypt] [--format csv|jsonl]
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
     }
-}
\ No newline at end of file
+
+    std::string exportFile(args[1]);
+    validateFileAccess(exportFile);
+    if (exportFile == passwordManager->getFilename())
+    {
+        throw std::invalid_argument("Refusing to export over the open password file.");
+    }
+
+    bool jsonlName = exportFile.size() > 6 && exportFile.compare(exportFile.size() - 6, 6, ".jsonl") == 0;
+    BulkExporter::Format format = jsonlName ? BulkExporter::JSONL : BulkExporter::CSV;
+    bool decrypt = false;
+
+    for (size_t i = 2; i < args.size(); ++i)
+    {
+        if (args[i] == "--decrypt")
+        {
+            decrypt = true;
+        }
+        else if (args[i] == "--format")
+        {
+            format = BulkExporter::parseFormat(optionValue(args, i));
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown option for export: " + std::string(args[i]));
+        }
+    }
+
+    runJob("export " + exportFile, [this, exportFile, format, decrypt](JobControl& control)
+    {
+        auto started = std::chrono::steady_clock::now();
+
+        // readers may keep going, writers wait until the snapshot is on disk
+        std::shared_lock<std::shared_mutex> lock(managerMutex);
+        const std::vector<PasswordEntry>& entries = passwordManager->getEntries();
+        BulkExporter exporter(entries, passwordManager->getCipherGenerations(), format, decrypt);
+        uint64_t bytes = exporter.run(exportFile, control);
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return "Exported " + std::to_string(entries.size()) + (decrypt ? " decrypted" : " encrypted") + " entries ("
+            + std::to_string(bytes / 1000000.0) + " MB) to '" + exportFile + "' in " + std::to_string(seconds) + " s.";
+    });
+}
+void CommandProcessor::handleFsckCommand(const Arguments& args)
+{
+    // fsck <filename> <password>
+    std::string checkFile(args[1]);
+    std::string password(args[2]);
+    validateFileAccess(checkFile);
+
+    runJob("fsck " + checkFile, [this, checkFile, password](JobControl& control)
+    {
+        // the open file may be the one checked, keep its saves out until the read is done
+        std::shared_lock<std::shared_mutex> lock(managerMutex);
+        VaultChecker checker(checkFile, password);
+        return checker.run(control).summary(checkFile);
+    });
+}
+
+void CommandProcessor::handleAuditCommand(const Arguments& args)
+{
+    // audit [--min-bits N] [--limit N]
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+
+    unsigned long minBits = 60;
+    unsigned long limit = 20;
+    for (size_t i = 1; i < args.size(); ++i)
+    {
+        std::string option(args[i]);
+        if (option != "--min-bits" && option != "--limit")
+        {
+            throw std::invalid_argument("Unknown option for audit: " + option);
+        }
+
+        std::string value = optionValue(args, i);
+        char* end;
+        unsigned long number = std::strtoul(value.c_str(), &end, 10);
+        if (*end != '\0' || value.empty() || number > 1000000)
+        {
+            throw std::invalid_argument("Invalid value for " + option + ": " + value);
+        }
+        (option == "--min-bits" ? minBits : limit) = number;
+    }
+
+    runJob("audit", [this, minBits, limit](JobControl& control)
+    {
+        std::shared_lock<std::shared_mutex> lock(managerMutex);
+        CredentialAuditor auditor(passwordManager->getEntries(), passwordManager->getCipherGenerations(),
+            passwordManager->getCipherGeneration(), static_cast<unsigned>(minBits));
+        return auditor.run(control).summary(limit);
+    });
+}
+
+void CommandProcessor::handleAuditCipherCommand(const Arguments& args)
+{
+    // audit-cipher [--samples N]
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+
+    size_t samples = 2000;
+    for (size_t i = 1; i < args.size(); ++i)
+    {
+        if (args[i] == "--samples")
+        {
+            std::string value = optionValue(args, i);
+            char* end;
+            samples = std::strtoul(value.c_str(), &end, 10);
+            if (*end != '\0' || value.empty() || samples == 0)
+            {
+                throw std::invalid_argument("Invalid sample count: " + value);
+            }
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown option for audit-cipher: " + std::string(args[i]));
+        }
+    }
+
+    runJob("audit-cipher", [this, samples](JobControl& control)
+    {
+        std::shared_lock<std::shared_mutex> lock(managerMutex);
+        CipherAuditor auditor(passwordManager->getEntries(), passwordManager->getCipherGenerations(), samples);
+        return CipherAuditor::report(auditor.run(control));
+    });
+}
+
+void CommandProcessor::handleRekeyCommand(const Arguments& args)
+{
+    // rekey <cipher> [cipher-params...]
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+
+    std::string cipherType(args[1]);
+    if (!isValidCipherType(cipherType))
+    {
+        throw std::invalid_argument("Invalid cipher type. Supported: " + CipherRegistry::instance().names());
+    }
+
+    std::vector<std::string> cipherParams;
+    for (size_t i = 2; i < args.size(); ++i)
+    {
+        cipherParams.emplace_back(args[i]);
+    }
+    std::shared_ptr<Cipher> newCipher(createCipher(cipherType, cipherParams));
+
+    runJob("rekey to " + cipherType, [this, newCipher, cipherType](JobControl& control)
+    {
+        auto started = std::chrono::steady_clock::now();
+
+        // writers are refused while the job runs, so the entries cannot change under us
+        std::vector<std::string> reencrypted;
+        size_t count;
+        {
+            std::shared_lock<std::shared_mutex> lock(managerMutex);
+            const std::vector<PasswordEntry>& entries = passwordManager->getEntries();
+            count = entries.size();
+            reencrypted = Rekeyer(passwordManager->getCipherGenerations(), *newCipher).run(entries, control);
+        }
+        control.checkpoint(); // last chance, the swap and its save are not interrupted
+
+        {
+            std::unique_lock<std::shared_mutex> lock(managerMutex);
+            passwordManager->replaceCipher(*newCipher, reencrypted);
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return "Re-encrypted " + std::to_string(count) + " password(s) with the " + cipherType + " cipher in "
+            + std::to_string(seconds) + " s.";
+    });
+}
+void CommandProcessor::handleMigrateCommand(const Arguments& args)
+{
+    // migrate <cipher> [cipher-params...]
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+
+    std::string cipherType(args[1]);
+    if (!isValidCipherType(cipherType))
+    {
+        throw std::invalid_argument("Invalid cipher type. Supported: " + CipherRegistry::instance().names());
+    }
+
+    std::vector<std::string> cipherParams;
+    for (size_t i = 2; i < args.size(); ++i)
+    {
+        cipherParams.emplace_back(args[i]);
+    }
+    std::unique_ptr<Cipher> newCipher(createCipher(cipherType, cipherParams));
+
+    passwordManager->startMigration(*newCipher);
+
+    std::vector<size_t> counts = passwordManager->countEntriesByGeneration();
+    size_t waiting = passwordManager->getEntries().size() - counts[passwordManager->getCipherGeneration()];
+    output << "Now encrypting with the " << cipherType << " cipher; " << waiting
+        << " entries move over as they are read or updated (see 'migration status')." << '\n';
+}
+void CommandProcessor::handleMigrationCommand(const Arguments& args)
+{
+    // migration status
+    if (args[1] != "status")
+    {
+        throw std::invalid_argument("Unknown migration command: " + std::string(args[1]) + " (expected status)");
+    }
+    if (!passwordManager || !passwordManager->getIsFileOpen())
+    {
+        throw std::runtime_error("No password file is currently open. Use 'create' or 'open' command first.");
+    }
+
+    std::vector<size_t> counts = passwordManager->countEntriesByGeneration();
+    unsigned current = passwordManager->getCipherGeneration();
+    size_t waiting = passwordManager->getEntries().size() - counts[current];
+
+    output << "Current cipher: generation " << current << " (" << passwordManager->getFileCipher()->getType() << "), "
+        << counts[current] << " entries" << '\n';
+    if (waiting == 0)
+    {
+        output << "No entries left on older ciphers." << '\n';
+        return;
+    }
+
+    output << waiting << " entries still on older ciphers:" << '\n';
+    for (unsigned generation = 0; generation < counts.size(); ++generation)
+    {
+        if (generation != current && counts[generation] > 0)
+        {
+            output << "  generation " << generation << " (" << passwordManager->getCipherFor(generation)->getType() << "): "
+                << counts[generation] << '\n';
+        }
+    }
+}
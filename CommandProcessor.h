@@ -1,24 +1,72 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <string_view>
+#include <iostream>
+#include <shared_mutex>
 #include "PasswordManager.h"
 #include "Cipher.h"
+#include "CommandTable.h"
+#include "JobManager.h"
+#include "MigrationWorker.h"
 
 class CommandProcessor
 {
 private:
+    typedef std::vector<std::string_view> Arguments; //tokens point into the command line being processed
+    typedef void (CommandProcessor::*CommandHandler)(const Arguments&);
+
     PasswordManager* passwordManager;
+    std::ostream& output; //every command result goes here, so callers choose the buffering
+
+    JobManager jobs;
+    bool backgroundJobs; //run long commands on a worker thread (interactive) or inline (scripts)
+    std::shared_mutex managerMutex; //lookups share the password manager, everything else is exclusive
+    MigrationWorker migrator; //moves entries that lookups found on a legacy cipher
+    uint32_t kdfIterations; //KDF cost for files created in this session, see 'calibrate'
+
+    enum CommandFlags
+    {
+        COMMAND_READ_ONLY = 1,   //only reads the vault, allowed while a job runs
+        COMMAND_RUNS_AS_JOB = 2  //long-running, does its own locking through runJob
+    };
 
-    std::vector<std::string> parseCommand(const std::string& commandLine) const;
-    void validateArguments(const std::vector<std::string>& args, size_t expectedMin, size_t expectedMax = SIZE_MAX) const;
+    static const CommandTable<CommandHandler>& commandTable(); //every command is registered here
 
-    void handleCreateCommand(const std::vector<std::string>& args);
-    void handleOpenCommand(const std::vector<std::string>& args);
-    void handleSaveCommand(const std::vector<std::string>& args);
-    void handleLoadCommand(const std::vector<std::string>& args);
-    void handleUpdateCommand(const std::vector<std::string>& args);
-    void handleDeleteCommand(const std::vector<std::string>& args);
+    void parseCommand(std::string_view commandLine, Arguments& tokens) const;
+    void validateArguments(const Arguments& args, size_t expectedMin, size_t expectedMax = SIZE_MAX) const;
 
+    void handleCreateCommand(const Arguments& args);
+    void handleOpenCommand(const Arguments& args);
+    void handlePasswdCommand(const Arguments& args);
+    void handleCalibrateCommand(const Arguments& args);
+    void handleSaveCommand(const Arguments& args);
+    void handleLoadCommand(const Arguments& args);
+    void handleSearchCommand(const Arguments& args);
+    void handleTagCommand(const Arguments& args); //tag and untag
+    void handleListCommand(const Arguments& args);
+    void handleUpdateCommand(const Arguments& args);
+    void handleHistoryCommand(const Arguments& args);
+    void handleHistoryKeepCommand(const Arguments& args);
+    void handleRevertCommand(const Arguments& args);
+    void handleDeleteCommand(const Arguments& args);
+    void handleGenerateCommand(const Arguments& args);
+    void handleImportCommand(const Arguments& args);
+    void handleExportCommand(const Arguments& args);
+    void handleFsckCommand(const Arguments& args);
+    void handleAuditCommand(const Arguments& args);
+    void handleAuditCipherCommand(const Arguments& args);
+    void handleRekeyCommand(const Arguments& args);
+    void handleMigrateCommand(const Arguments& args);
+    void handleMigrationCommand(const Arguments& args);
+    void handleJobsCommand(const Arguments& args);
+    void handleCancelCommand(const Arguments& args);
+
+    void runJob(const std::string& description, JobManager::Work work);
+    std::string optionValue(const Arguments& args, size_t& index) const; //value after "--option", advances index
+    void migrateTouched(std::vector<PasswordManager::EntryKey>& keys); //runs on the migration worker
+
+    std::string didYouMean(const std::string& website) const; //" Did you mean: ...?" for a missed website, or empty
     bool isValidCipherType(const std::string& cipherType) const;
     void validateFileAccess(const std::string& filename) const;
 
@@ -30,11 +78,14 @@ private:
   
 
 public:
-    CommandProcessor();
+    explicit CommandProcessor(std::ostream& output = std::cout);
     ~CommandProcessor();
 
     void processCommand(const std::string& commandLine);
     void showHelp() const;
     bool hasOpenFile() const;
+
+    void setBackgroundJobs(bool enabled) { backgroundJobs = enabled; }
+    void reportFinishedJobs(); //prints completions of background jobs, called before each prompt
 };
 
@@ -0,0 +1,98 @@
+#pragma once
+#include <string_view>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+// Fixed-size open-addressing table from a command verb to its handler.
+// Verbs are hashed and compared case-insensitively straight from the
+// tokenized input, so a lookup never allocates or copies the verb.
+template <typename Handler>
+class CommandTable
+{
+public:
+	struct Entry
+	{
+		std::string_view name; //lowercase, points at a string literal
+		Handler handler;
+		size_t minArgs; //including the verb itself
+		size_t maxArgs;
+		unsigned flags; //meaning is up to the owner of the table
+	};
+
+private:
+	static const size_t CAPACITY = 64; //power of two, keep it well above the command count
+
+	Entry slots[CAPACITY];
+	bool used[CAPACITY];
+	size_t count;
+
+	static char lower(char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+	}
+	static uint32_t hash(std::string_view verb) //FNV-1a over the lowercased bytes
+	{
+		uint32_t value = 2166136261u;
+		for (char c : verb)
+		{
+			value ^= static_cast<unsigned char>(lower(c));
+			value *= 16777619u;
+		}
+		return value;
+	}
+	static bool sameVerb(std::string_view name, std::string_view verb)
+	{
+		if (name.size() != verb.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < name.size(); ++i)
+		{
+			if (name[i] != lower(verb[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+public:
+	CommandTable() : slots(), used(), count(0) {}
+
+	void add(std::string_view name, Handler handler, size_t minArgs, size_t maxArgs, unsigned flags = 0)
+	{
+		if (count + 1 > CAPACITY / 2)
+		{
+			throw std::logic_error("Command table is full");
+		}
+
+		size_t slot = hash(name) & (CAPACITY - 1);
+		while (used[slot])
+		{
+			if (sameVerb(slots[slot].name, name))
+			{
+				throw std::logic_error("Command registered twice");
+			}
+			slot = (slot + 1) & (CAPACITY - 1);
+		}
+
+		slots[slot] = Entry{ name, handler, minArgs, maxArgs, flags };
+		used[slot] = true;
+		++count;
+	}
+
+	const Entry* find(std::string_view verb) const
+	{
+		size_t slot = hash(verb) & (CAPACITY - 1);
+		while (used[slot])
+		{
+			if (sameVerb(slots[slot].name, verb))
+			{
+				return &slots[slot];
+			}
+			slot = (slot + 1) & (CAPACITY - 1);
+		}
+		return nullptr;
+	}
+};
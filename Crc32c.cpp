@@ -0,0 +1,102 @@
+#include "Crc32c.h"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#endif
+
+namespace
+{
+	const uint32_t POLYNOMIAL = 0x82f63b78; // reflected 0x1EDC6F41
+
+	struct Tables
+	{
+		uint32_t slice[8][256];
+
+		Tables()
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t crc = i;
+				for (int bit = 0; bit < 8; ++bit)
+				{
+					crc = (crc >> 1) ^ (POLYNOMIAL & (0u - (crc & 1)));
+				}
+				slice[0][i] = crc;
+			}
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				for (int k = 1; k < 8; ++k)
+				{
+					slice[k][i] = (slice[k - 1][i] >> 8) ^ slice[0][slice[k - 1][i] & 0xff];
+				}
+			}
+		}
+	};
+
+	uint32_t updateTable(uint32_t crc, const unsigned char* data, size_t length)
+	{
+		static const Tables tables;
+		const uint32_t (*t)[256] = tables.slice;
+
+		while (length >= 8)
+		{
+			uint32_t low = crc ^ (uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24));
+			uint32_t high = uint32_t(data[4]) | (uint32_t(data[5]) << 8) | (uint32_t(data[6]) << 16) | (uint32_t(data[7]) << 24);
+			crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24]
+				^ t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^ t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+			data += 8;
+			length -= 8;
+		}
+		while (length-- > 0)
+		{
+			crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+		}
+		return crc;
+	}
+
+#ifdef CRC32C_X86
+	__attribute__((target("sse4.2")))
+	uint32_t updateHardware(uint32_t crc, const unsigned char* data, size_t length)
+	{
+		uint64_t value = crc;
+		while (length >= 8)
+		{
+			uint64_t word;
+			__builtin_memcpy(&word, data, 8);
+			value = _mm_crc32_u64(value, word);
+			data += 8;
+			length -= 8;
+		}
+		uint32_t small = static_cast<uint32_t>(value);
+		while (length-- > 0)
+		{
+			small = _mm_crc32_u8(small, *data++);
+		}
+		return small;
+	}
+#endif
+}
+
+bool Crc32c::isHardwareAccelerated()
+{
+#ifdef CRC32C_X86
+	static const bool supported = __builtin_cpu_supports("sse4.2");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+uint32_t Crc32c::update(uint32_t crc, const void* data, size_t length)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	crc = ~crc;
+#ifdef CRC32C_X86
+	if (isHardwareAccelerated())
+	{
+		return ~updateHardware(crc, bytes, length);
+	}
+#endif
+	return ~updateTable(crc, bytes, length);
+}
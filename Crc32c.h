@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// CRC-32C (Castagnoli), as used by iSCSI and ext4. Uses the SSE4.2 crc32
+// instruction when the CPU has it and slicing-by-8 tables otherwise.
+class Crc32c
+{
+public:
+	// continue a checksum: crc = update(crc, ...) over consecutive pieces, starting from 0
+	static uint32_t update(uint32_t crc, const void* data, size_t length);
+	static uint32_t compute(const void* data, size_t length) { return update(0, data, length); }
+
+	static bool isHardwareAccelerated();
+};
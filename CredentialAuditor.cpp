@@ -0,0 +1,278 @@
+#include "CredentialAuditor.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <unordered_map>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// FNV-1a; with a million passwords a false match is about 1 in 30 million
+	uint64_t hashPassword(const std::string& password)
+	{
+		uint64_t hash = 14695981039346656037ULL;
+		for (unsigned char c : password)
+		{
+			hash = (hash ^ c) * 1099511628211ULL;
+		}
+		return hash == 0 ? 1 : hash; // 0 marks an unreadable entry
+	}
+
+	// lower, upper and digit counts; the rest is "other"
+	void countClasses(const std::string& text, size_t& lower, size_t& upper, size_t& digit)
+	{
+		lower = upper = digit = 0;
+		size_t i = 0;
+#ifdef __SSE2__
+		const __m128i belowLower = _mm_set1_epi8('a' - 1), aboveLower = _mm_set1_epi8('z' + 1);
+		const __m128i belowUpper = _mm_set1_epi8('A' - 1), aboveUpper = _mm_set1_epi8('Z' + 1);
+		const __m128i belowDigit = _mm_set1_epi8('0' - 1), aboveDigit = _mm_set1_epi8('9' + 1);
+		for (; i < text.size(); i += 16)
+		{
+			// the last block is zero padded, and zero is in none of the three classes
+			alignas(16) char block[16] = {};
+			std::memcpy(block, text.data() + i, std::min<size_t>(16, text.size() - i));
+			__m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+			int lowerMask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(v, belowLower), _mm_cmplt_epi8(v, aboveLower)));
+			int upperMask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(v, belowUpper), _mm_cmplt_epi8(v, aboveUpper)));
+			int digitMask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(v, belowDigit), _mm_cmplt_epi8(v, aboveDigit)));
+			lower += __builtin_popcount(lowerMask);
+			upper += __builtin_popcount(upperMask);
+			digit += __builtin_popcount(digitMask);
+		}
+#endif
+		for (; i < text.size(); ++i)
+		{
+			char c = text[i];
+			lower += c >= 'a' && c <= 'z' ? 1 : 0;
+			upper += c >= 'A' && c <= 'Z' ? 1 : 0;
+			digit += c >= '0' && c <= '9' ? 1 : 0;
+		}
+	}
+
+	// the concurrent set: every shard maps a plaintext hash to the entries using it
+	struct Shard
+	{
+		std::mutex mutex;
+		std::unordered_map<uint64_t, std::vector<size_t>> users;
+	};
+}
+
+CredentialAuditor::CredentialAuditor(const std::vector<PasswordEntry>& entries, const std::vector<const Cipher*>& ciphers, unsigned currentGeneration, unsigned minBits)
+	: entries(entries), ciphers(ciphers), currentGeneration(currentGeneration), minBits(minBits) {}
+
+float CredentialAuditor::estimateBits(const std::string& password)
+{
+	size_t lower, upper, digit;
+	countClasses(password, lower, upper, digit);
+	size_t other = password.size() - lower - upper - digit;
+	int pool = (lower ? 26 : 0) + (upper ? 26 : 0) + (digit ? 10 : 0) + (other ? 33 : 0);
+	return pool == 0 ? 0.0f : static_cast<float>(password.size() * std::log2(pool));
+}
+
+void CredentialAuditor::checkChunk(size_t begin, size_t end, std::vector<Checked>& checked) const
+{
+	// ciphers are not required to be thread-safe, every chunk gets its own copies
+	std::vector<std::unique_ptr<Cipher>> local(ciphers.size());
+	for (size_t i = begin; i < end; ++i)
+	{
+		const PasswordEntry& entry = entries[i];
+		unsigned generation = entry.getGeneration();
+		checked[i] = Checked{ 0, 0.0f };
+		if (generation >= ciphers.size() || !ciphers[generation])
+		{
+			continue;
+		}
+		if (!local[generation])
+		{
+			local[generation].reset(ciphers[generation]->clone());
+		}
+
+		try
+		{
+			std::string plain = local[generation]->decrypt(entry.getPassword());
+			checked[i] = Checked{ hashPassword(plain), estimateBits(plain) };
+		}
+		catch (const std::exception&)
+		{
+		}
+	}
+}
+
+CredentialAuditor::Report CredentialAuditor::run(JobControl& control) const
+{
+	auto started = std::chrono::steady_clock::now();
+	ThreadPool& pool = ThreadPool::shared();
+
+	// 1. decrypt, hash and score in parallel, filling the sharded set chunk by chunk
+	std::vector<Checked> checked(entries.size());
+	std::vector<Shard> shards(SHARDS);
+	const size_t chunkCount = (entries.size() + ENTRIES_PER_CHUNK - 1) / ENTRIES_PER_CHUNK;
+	pool.parallelFor(chunkCount, [this, &checked, &shards, &control](size_t chunk)
+	{
+		control.checkpoint();
+		size_t begin = chunk * ENTRIES_PER_CHUNK;
+		size_t end = std::min(begin + ENTRIES_PER_CHUNK, entries.size());
+		checkChunk(begin, end, checked);
+
+		// sort by shard first so every shard is locked once per chunk
+		std::vector<std::pair<uint64_t, size_t>> hashes;
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (checked[i].hash != 0)
+			{
+				hashes.push_back({ checked[i].hash, i });
+			}
+		}
+		std::sort(hashes.begin(), hashes.end(), [](const std::pair<uint64_t, size_t>& a, const std::pair<uint64_t, size_t>& b)
+		{
+			return a.first % SHARDS < b.first % SHARDS;
+		});
+		for (size_t i = 0; i < hashes.size();)
+		{
+			Shard& shard = shards[hashes[i].first % SHARDS];
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			for (; i < hashes.size() && &shards[hashes[i].first % SHARDS] == &shard; ++i)
+			{
+				shard.users[hashes[i].first].push_back(hashes[i].second);
+			}
+		}
+		control.addEntries(end - begin);
+	});
+
+	Report report = Report{ entries.size(), 0, 0, 0, 0, 0, minBits, {}, {}, 0, pool.size() };
+
+	// 2. passwords with more than one user
+	std::vector<char> reused(entries.size(), 0);
+	std::vector<const std::vector<size_t>*> groups;
+	for (const Shard& shard : shards)
+	{
+		for (const auto& users : shard.users)
+		{
+			if (users.second.size() > 1)
+			{
+				groups.push_back(&users.second);
+				for (size_t index : users.second)
+				{
+					reused[index] = 1;
+				}
+			}
+		}
+	}
+	std::sort(groups.begin(), groups.end(), [](const std::vector<size_t>* a, const std::vector<size_t>* b)
+	{
+		return a->size() != b->size() ? a->size() > b->size() : a->front() < b->front();
+	});
+	report.reuseGroups = groups.size();
+	for (const std::vector<size_t>* group : groups)
+	{
+		std::vector<std::string> names;
+		for (size_t index : *group)
+		{
+			names.push_back(entries[index].getWebsite() + "/" + entries[index].getUsername());
+		}
+		report.groups.push_back(names);
+	}
+
+	// 3. per website, in vault order
+	std::unordered_map<std::string, size_t> siteIndex;
+	std::vector<Site> sites;
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const PasswordEntry& entry = entries[i];
+		auto found = siteIndex.emplace(entry.getWebsite(), sites.size());
+		if (found.second)
+		{
+			sites.push_back(Site{ entry.getWebsite(), 0, 0, 0, 0 });
+		}
+		Site& site = sites[found.first->second];
+		++site.entries;
+
+		bool readable = checked[i].hash != 0;
+		bool weak = readable && checked[i].bits < minBits;
+		bool stale = entry.getGeneration() != currentGeneration;
+		site.reused += reused[i];
+		site.weak += weak ? 1 : 0;
+		site.stale += stale ? 1 : 0;
+
+		report.unreadable += readable ? 0 : 1;
+		report.reused += reused[i];
+		report.weak += weak ? 1 : 0;
+		report.stale += stale ? 1 : 0;
+	}
+
+	for (Site& site : sites)
+	{
+		if (site.findings() > 0)
+		{
+			report.sites.push_back(std::move(site));
+		}
+	}
+	std::stable_sort(report.sites.begin(), report.sites.end(), [](const Site& a, const Site& b)
+	{
+		return a.findings() > b.findings();
+	});
+
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	return report;
+}
+
+std::string CredentialAuditor::Report::summary(size_t limit) const
+{
+	std::ostringstream out;
+	out << "Audited " << entries << " entries in " << seconds << " s on " << threads << " threads" << '\n';
+	out << "  reused: " << reused << " entries share their password with another entry (" << reuseGroups << " passwords)" << '\n';
+	out << "  weak:   " << weak << " entries under " << minBits << " bits (length times log2 of the character pool)" << '\n';
+	out << "  stale:  " << stale << " entries still on an older cipher, untouched since the last rotation" << '\n';
+	if (unreadable > 0)
+	{
+		out << "  unreadable: " << unreadable << " entries their cipher would not decrypt" << '\n';
+	}
+
+	if (sites.empty())
+	{
+		out << "No reused, weak or stale passwords.";
+		return out.str();
+	}
+
+	out << "Websites with findings, worst first (" << std::min(limit, sites.size()) << " of " << sites.size() << "):" << '\n';
+	out << "  " << std::left << std::setw(32) << "website" << std::right << std::setw(8) << "entries" << std::setw(8) << "reused"
+		<< std::setw(8) << "weak" << std::setw(8) << "stale" << '\n';
+	for (size_t i = 0; i < sites.size() && i < limit; ++i)
+	{
+		const Site& site = sites[i];
+		out << "  " << std::left << std::setw(32) << site.website << std::right << std::setw(8) << site.entries << std::setw(8) << site.reused
+			<< std::setw(8) << site.weak << std::setw(8) << site.stale << '\n';
+	}
+
+	if (!groups.empty())
+	{
+		out << "Reused passwords, largest groups first (" << std::min(limit, groups.size()) << " of " << groups.size() << "):" << '\n';
+		for (size_t i = 0; i < groups.size() && i < limit; ++i)
+		{
+			const std::vector<std::string>& names = groups[i];
+			out << "  " << names.size() << " entries: ";
+			for (size_t j = 0; j < names.size() && j < 5; ++j)
+			{
+				out << (j > 0 ? ", " : "") << names[j];
+			}
+			if (names.size() > 5)
+			{
+				out << " and " << (names.size() - 5) << " more";
+			}
+			out << '\n';
+		}
+	}
+
+	out << (reused + weak + stale) << " finding(s).";
+	return out.str();
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Cipher.h"
+#include "PasswordEntry.h"
+#include "JobControl.h"
+
+// Password hygiene of the open vault, behind the 'audit' command. Every entry
+// is decrypted in parallel on the shared pool; the plaintexts go into a
+// sharded hash set to find passwords used by more than one entry, and their
+// strength is estimated from length and character classes. Entries still on
+// an older cipher generation have not been touched since the last rotation
+// and count as stale (entries carry no dates). Results are grouped per website.
+class CredentialAuditor
+{
+public:
+	struct Site
+	{
+		std::string website;
+		size_t entries;
+		size_t reused;
+		size_t weak;
+		size_t stale;
+
+		size_t findings() const { return reused + weak + stale; }
+	};
+
+	struct Report
+	{
+		size_t entries;
+		size_t unreadable; //their cipher would not decrypt them
+		size_t reused; //entries sharing their password with another entry
+		size_t reuseGroups;
+		size_t weak;
+		size_t stale;
+		unsigned minBits;
+		std::vector<Site> sites; //only those with findings, worst first
+		std::vector<std::vector<std::string>> groups; //"website/user" per reused password, largest first
+		double seconds;
+		size_t threads;
+
+		std::string summary(size_t limit) const; //at most limit sites and groups
+	};
+
+private:
+	struct Checked
+	{
+		uint64_t hash; //of the plaintext, 0 when unreadable
+		float bits; //estimated strength
+	};
+
+	const std::vector<PasswordEntry>& entries;
+	std::vector<const Cipher*> ciphers; //indexed by entry generation, see PasswordManager::getCipherGenerations
+	unsigned currentGeneration;
+	unsigned minBits; //weaker passwords are reported
+
+	static const size_t ENTRIES_PER_CHUNK = 16384;
+	static const size_t SHARDS = 64;
+
+	void checkChunk(size_t begin, size_t end, std::vector<Checked>& checked) const;
+
+public:
+	CredentialAuditor(const std::vector<PasswordEntry>& entries, const std::vector<const Cipher*>& ciphers, unsigned currentGeneration, unsigned minBits);
+
+	Report run(JobControl& control) const;
+
+	static float estimateBits(const std::string& password); //length times log2 of the character pool it draws from
+};
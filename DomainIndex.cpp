@@ -0,0 +1,175 @@
+#include "DomainIndex.h"
+
+std::string DomainIndex::normalize(const std::string& website)
+{
+	// only spellings of the same host; a scheme, port or path names a different login
+	std::string host = website;
+	for (char& c : host)
+	{
+		if (c >= 'A' && c <= 'Z')
+		{
+			c = static_cast<char>(c + ('a' - 'A'));
+		}
+	}
+	while (!host.empty() && host.back() == '.')
+	{
+		host.pop_back();
+	}
+	if (host.compare(0, 4, "www.") == 0 && host.size() > 4)
+	{
+		host.erase(0, 4);
+	}
+	return host;
+}
+
+std::vector<std::string> DomainIndex::reversedLabels(const std::string& host)
+{
+	std::vector<std::string> labels;
+	size_t end = host.size();
+	while (true)
+	{
+		size_t dot = host.rfind('.', end == 0 ? 0 : end - 1);
+		if (dot == std::string::npos || end == 0)
+		{
+			labels.push_back(host.substr(0, end));
+			break;
+		}
+		labels.push_back(host.substr(dot + 1, end - dot - 1));
+		end = dot;
+	}
+	return labels;
+}
+
+const DomainIndex::Node* DomainIndex::find(const std::string& host) const
+{
+	const Node* node = &root;
+	for (const std::string& label : reversedLabels(host))
+	{
+		auto child = node->children.find(label);
+		if (child == node->children.end())
+		{
+			return nullptr;
+		}
+		node = child->second.get();
+	}
+	return node;
+}
+
+void DomainIndex::collect(const Node& node, std::vector<std::string>& out)
+{
+	for (const auto& website : node.websites)
+	{
+		out.push_back(website.first);
+	}
+	for (const auto& child : node.children)
+	{
+		collect(*child.second, out);
+	}
+}
+
+void DomainIndex::build(const std::vector<PasswordEntry>& entries)
+{
+	clear();
+	for (const PasswordEntry& entry : entries)
+	{
+		add(entry.getWebsite());
+	}
+}
+
+void DomainIndex::clear()
+{
+	root.children.clear();
+	root.websites.clear();
+	hosts.clear();
+}
+
+void DomainIndex::add(const std::string& website)
+{
+	std::string host = normalize(website);
+	Node* node = &root;
+	for (const std::string& label : reversedLabels(host))
+	{
+		std::unique_ptr<Node>& child = node->children[label];
+		if (!child)
+		{
+			child.reset(new Node());
+		}
+		node = child.get();
+	}
+	if (node->websites.empty())
+	{
+		hosts.insert(host);
+	}
+	++node->websites[website];
+}
+
+void DomainIndex::remove(const std::string& website)
+{
+	// walk down remembering the path, then prune nodes left empty on the way back
+	std::string host = normalize(website);
+	std::vector<std::pair<Node*, std::string>> path;
+	Node* node = &root;
+	for (const std::string& label : reversedLabels(host))
+	{
+		auto child = node->children.find(label);
+		if (child == node->children.end())
+		{
+			return;
+		}
+		path.push_back({ node, label });
+		node = child->second.get();
+	}
+
+	auto stored = node->websites.find(website);
+	if (stored == node->websites.end())
+	{
+		return;
+	}
+	if (--stored->second == 0)
+	{
+		node->websites.erase(stored);
+		if (node->websites.empty())
+		{
+			hosts.erase(host);
+		}
+	}
+
+	for (size_t i = path.size(); i-- > 0;)
+	{
+		Node* child = path[i].first->children[path[i].second].get();
+		if (!child->websites.empty() || !child->children.empty())
+		{
+			break;
+		}
+		path[i].first->children.erase(path[i].second);
+	}
+}
+
+std::vector<std::string> DomainIndex::match(const std::string& website) const
+{
+	std::vector<std::string> websites;
+	bool pattern = isPattern(website);
+	const Node* node = find(normalize(pattern ? website.substr(2) : website));
+	if (!node)
+	{
+		return websites;
+	}
+
+	if (pattern)
+	{
+		collect(*node, websites);
+	}
+	else
+	{
+		for (const auto& stored : node->websites)
+		{
+			websites.push_back(stored.first);
+		}
+	}
+	return websites;
+}
+
+std::vector<BkTree::Match> DomainIndex::suggest(const std::string& website, size_t limit) const
+{
+	return hosts.find(normalize(isPattern(website) ? website.substr(2) : website), 2, limit);
+}
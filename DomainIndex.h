@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "PasswordEntry.h"
+#include "BkTree.h"
+
+// Websites by host, for 'load' and 'delete' with patterns. Hosts are
+// normalized (case, trailing dot, "www.") and kept in a
+// trie keyed on their labels in reverse, so "*.google.com" is the subtree
+// under com -> google and one walk lists every website stored below it.
+// Each node remembers which website strings normalize to its host and how
+// many entries use each. The hosts in use are also kept in a BkTree for
+// suggestions when a lookup misses.
+class DomainIndex
+{
+private:
+	struct Node
+	{
+		std::unordered_map<std::string, std::unique_ptr<Node>> children; //next label towards the subdomains
+		std::unordered_map<std::string, size_t> websites; //stored spelling -> entries using it
+	};
+
+	Node root;
+	BkTree hosts; //every host with at least one website
+
+	static std::vector<std::string> reversedLabels(const std::string& host);
+	const Node* find(const std::string& host) const;
+	static void collect(const Node& node, std::vector<std::string>& out);
+
+public:
+	static std::string normalize(const std::string& website);
+	static bool isPattern(const std::string& website) { return website.compare(0, 2, "*.") == 0; }
+
+	void build(const std::vector<PasswordEntry>& entries);
+	void clear();
+	void add(const std::string& website);
+	void remove(const std::string& website);
+
+	// stored websites for a host, or for a pattern "*.domain": the domain and every subdomain
+	std::vector<std::string> match(const std::string& website) const;
+	std::vector<BkTree::Match> suggest(const std::string& website, size_t limit) const; //hosts within edit distance 2
+};
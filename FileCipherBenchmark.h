@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Measures how fast the file-level ciphers get through a vault body: the
+// original repeating-key XOR against ChaCha20 with every block function the
+// CPU supports. Save and open should be limited by the disk, not by these.
+class FileCipherBenchmark
+{
+private:
+	size_t size; //bytes per pass
+
+	static const int PASSES = 3; //best of
+
+	double measure(void (*pass)(std::string& buffer, const void* context), const void* context) const; //GB/s
+
+public:
+	explicit FileCipherBenchmark(size_t size);
+
+	void run() const;
+
+	// --bench-file-cipher [--mb N]
+	static int runFromArguments(const std::vector<std::string>& args);
+};
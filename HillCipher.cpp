@@ -1,7 +1,16 @@
 #include "HillCipher.h"
+#include "CipherRegistry.h"
 #include <cmath>
 #include <string>
 #include <vector>
+#include <sstream>
+#include <cstdlib>
+
+namespace
+{
+    const CipherRegistry::Registrar registrar(CipherType{ HillCipher::TYPE_ID, "hill", "<matrix-size> <key-string> | <matrix-size> <elements...>", 2, SIZE_MAX,
+        &HillCipher::fromParams, &HillCipher::decodeConfig, "Hill", &HillCipher::fromText });
+}
 
 int HillCipher::mod(int a, int m) const
 {
@@ -354,17 +363,17 @@ char HillCipher::toUpper(char c)
     return c;
 }
 
-std::string HillCipher::encrypt(const std::string& plainText) 
+std::string HillCipher::apply(const std::string& text, const Matrix& matrix, const unsigned char* before, const unsigned char* after) const
 {
-	if (plainText.empty())
-	{
-		throw std::invalid_argument("Plain text cannot be empty");
-	}
-
     std::string processedText;
-    for (char c : plainText) 
+    processedText.reserve(text.size() + matrixSize);
+    for (char c : text)
     {
-        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) 
+        if (before)
+        {
+            c = static_cast<char>(before[static_cast<unsigned char>(c)]);
+        }
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))
         {
             processedText.push_back(toUpper(c));
         }
@@ -372,81 +381,57 @@ std::string HillCipher::encrypt(const std::string& plainText)
 
     processedText = padText(processedText);
     std::string result;
+    result.reserve(processedText.length());
 
+    std::vector<int> textVector(matrixSize);
+    std::vector<int> resultVector(matrixSize);
     for (size_t i = 0; i < processedText.length(); i += matrixSize)
     {
-        std::vector<int> textVector(matrixSize);
         for (int j = 0; j < matrixSize; j++)
         {
             textVector[j] = charToInt(processedText[i + j]);
         }
 
-        std::vector<int> resultVector(matrixSize, 0);
         for (int row = 0; row < matrixSize; row++)
         {
+            resultVector[row] = 0;
             for (int col = 0; col < matrixSize; col++)
             {
-                resultVector[row] += keyMatrix[row][col] * textVector[col];
+                resultVector[row] += matrix[row][col] * textVector[col];
             }
             resultVector[row] = mod(resultVector[row], 26);
         }
 
         for (int j = 0; j < matrixSize; j++)
         {
-            result.push_back(intToChar(resultVector[j]));
+            char c = intToChar(resultVector[j]);
+            result.push_back(after ? static_cast<char>(after[static_cast<unsigned char>(c)]) : c);
         }
     }
 
     return result;
 }
+
+std::string HillCipher::encrypt(const std::string& plainText) 
+{
+	return transform(plainText, false, nullptr, nullptr);
+}
 std::string HillCipher::decrypt(const std::string& cipherText) 
 {
-	if (cipherText.empty())
+	return transform(cipherText, true, nullptr, nullptr);
+}
+std::string HillCipher::transform(const std::string& input, bool decrypting, const unsigned char* before, const unsigned char* after)
+{
+	if (input.empty())
 	{
-		throw std::invalid_argument("Cipher text cannot be empty");
+		throw std::invalid_argument(decrypting ? "Cipher text cannot be empty" : "Plain text cannot be empty");
 	}
-	if (inverseMatrix.empty())
+	if (decrypting && inverseMatrix.empty())
 	{
 		throw std::invalid_argument("Key matrix is not invertible, decryption not possible");
 	}
 
-    std::string processedText;
-    for (char c : cipherText)
-    {
-        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))
-        {
-            processedText.push_back(toUpper(c));
-        }
-    }
-
-    processedText = padText(processedText);
-    std::string result;
-
-    for (size_t i = 0; i < processedText.length(); i += matrixSize)
-    {
-        std::vector<int> textVector(matrixSize);
-        for (int j = 0; j < matrixSize; j++)
-        {
-            textVector[j] = charToInt(processedText[i + j]);
-        }
-
-        std::vector<int> resultVector(matrixSize, 0);
-        for (int row = 0; row < matrixSize; row++)
-        {
-            for (int col = 0; col < matrixSize; col++)
-            {
-                resultVector[row] += inverseMatrix[row][col] * textVector[col];
-            }
-            resultVector[row] = mod(resultVector[row], 26);
-        }
-
-        for (int j = 0; j < matrixSize; j++)
-        {
-            result.push_back(intToChar(resultVector[j]));
-        }
-    }
-
-    return result;
+    return apply(input, decrypting ? inverseMatrix : keyMatrix, before, after);
 }
 
 std::string HillCipher::serialize() const
@@ -483,4 +468,115 @@ std::string HillCipher::getType() const
 std::string HillCipher::getConfig() const
 {
 	return "Matrix size: " + std::to_string(matrixSize) + ", Key matrix: " + matrixToString(keyMatrix);
+}
+std::string HillCipher::encodeConfig() const
+{
+    std::string config;
+    CipherRegistry::appendInt32(config, matrixSize);
+    for (const auto& row : keyMatrix)
+    {
+        for (int value : row)
+        {
+            CipherRegistry::appendInt32(config, value);
+        }
+    }
+    return config;
+}
+
+Cipher* HillCipher::fromParams(const std::vector<std::string>& params)
+{
+    char* end;
+    long matrixSize = std::strtol(params[0].c_str(), &end, 10);
+    if (*end != '\0' || end == params[0].c_str() || matrixSize <= 0) {
+        throw std::invalid_argument("Invalid matrix size for Hill cipher: " + params[0]);
+    }
+
+    if (params.size() == 2) {
+        // Case 1: Matrix size + key string (auto-generate matrix)
+        return new HillCipher(params[1], static_cast<int>(matrixSize));
+    }
+
+    // Case 2: Matrix size + all matrix elements
+    size_t expectedElements = static_cast<size_t>(matrixSize * matrixSize);
+    if (params.size() != expectedElements + 1) {
+        throw std::invalid_argument("Hill cipher requires exactly " +
+            std::to_string(expectedElements) + " matrix elements for " +
+            std::to_string(matrixSize) + "x" + std::to_string(matrixSize) + " matrix, got " +
+            std::to_string(params.size() - 1));
+    }
+
+    Matrix keyMatrix(matrixSize, std::vector<int>(matrixSize));
+    for (int i = 0; i < matrixSize; i++) {
+        for (int j = 0; j < matrixSize; j++) {
+            const std::string& param = params[1 + i * matrixSize + j];
+            char* elemEnd;
+            long value = std::strtol(param.c_str(), &elemEnd, 10);
+            if (*elemEnd != '\0' || elemEnd == param.c_str()) {
+                throw std::invalid_argument("Invalid matrix element for Hill cipher: " + param);
+            }
+            keyMatrix[i][j] = static_cast<int>(value);
+        }
+    }
+    return new HillCipher(keyMatrix);
+}
+Cipher* HillCipher::decodeConfig(const std::string& config)
+{
+    int32_t size = CipherRegistry::readInt32(config, 0);
+    if (size <= 0 || config.size() != 4 + static_cast<size_t>(size) * size * 4)
+    {
+        throw std::runtime_error("Invalid Hill cipher config");
+    }
+
+    Matrix keyMatrix(size, std::vector<int>(size));
+    size_t offset = 4;
+    for (auto& row : keyMatrix)
+    {
+        for (int& value : row)
+        {
+            value = CipherRegistry::readInt32(config, offset);
+            offset += 4;
+        }
+    }
+    return new HillCipher(keyMatrix);
+}
+Cipher* HillCipher::fromText(const std::string& config)
+{
+    size_t sizePos = config.find("Matrix size: ");
+    size_t matrixPos = config.find(", Key matrix: ");
+    if (sizePos != 0 || matrixPos == std::string::npos)
+    {
+        throw std::runtime_error("Invalid Hill cipher config format");
+    }
+
+    char* end;
+    long size = std::strtol(config.c_str() + 13, &end, 10);
+    if (end != config.c_str() + matrixPos || size <= 0)
+    {
+        throw std::runtime_error("Invalid Hill cipher config format");
+    }
+
+    // rows are separated by ';', elements by spaces
+    Matrix keyMatrix;
+    std::istringstream rows(config.substr(matrixPos + 14));
+    std::string rowText;
+    while (std::getline(rows, rowText, ';'))
+    {
+        std::istringstream elements(rowText);
+        std::vector<int> row;
+        int value;
+        while (elements >> value)
+        {
+            row.push_back(value);
+        }
+        if (!elements.eof() || row.size() != static_cast<size_t>(size))
+        {
+            throw std::runtime_error("Invalid matrix format: incorrect number of columns in row " + std::to_string(keyMatrix.size()));
+        }
+        keyMatrix.push_back(row);
+    }
+    if (keyMatrix.size() != static_cast<size_t>(size))
+    {
+        throw std::runtime_error("Invalid matrix format: incorrect number of rows");
+    }
+    return new HillCipher(keyMatrix);
 }
\ No newline at end of file
@@ -22,6 +22,7 @@ private:
 
 	bool isValidMatrix() const;
 	std::string padText(const std::string& text) const; //fill the matrix // padding
+	std::string apply(const std::string& text, const Matrix& matrix, const unsigned char* before, const unsigned char* after) const; //tables may be nullptr
 
 	int mod(int a, int m) const;
 	static char toUpper(char c);
@@ -40,8 +41,19 @@ public:
     std::string getType() const override;
 	virtual std::string getConfig() const override;
 
+    uint8_t getTypeId() const override { return TYPE_ID; }
+    bool acceptsSubstitution() const override { return true; }
+    std::string transform(const std::string& input, bool decrypting, const unsigned char* before, const unsigned char* after) override;
+    std::string encodeConfig() const override; //size, then the elements row by row, all int32
+    std::string getAlphabet() const override { return "ABCDEFGHIJKLMNOPQRSTUVWXYZ"; } //lower case comes back upper case
+
     static Matrix stringToMatrix(const std::string& keyString, int n);
     static std::string matrixToString(const Matrix& matrix);
 
+    static const uint8_t TYPE_ID = 3;
+    static Cipher* fromParams(const std::vector<std::string>& params); //size and key string, or size and every element
+    static Cipher* decodeConfig(const std::string& config);
+    static Cipher* fromText(const std::string& config); //"Matrix size: 2, Key matrix: 1 2; 3 4"
+
 };
 
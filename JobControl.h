@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+class OperationCancelled : public std::runtime_error
+{
+public:
+	OperationCancelled() : std::runtime_error("Operation cancelled") {}
+};
+
+// Shared between a long-running operation and whoever watches it.
+// The operation reports progress and calls checkpoint() inside its loops;
+// the watcher reads the counters and may request cancellation at any time.
+class JobControl
+{
+private:
+	std::atomic<bool> cancelRequested;
+	std::atomic<uint64_t> entriesDone;
+	std::atomic<uint64_t> bytesDone;
+	std::atomic<uint64_t> bytesTotal; //0 while the size of the work is unknown
+
+public:
+	JobControl() : cancelRequested(false), entriesDone(0), bytesDone(0), bytesTotal(0) {}
+
+	JobControl(const JobControl&) = delete;
+	JobControl& operator=(const JobControl&) = delete;
+
+	void requestCancel() { cancelRequested.store(true); }
+	bool isCancelRequested() const { return cancelRequested.load(std::memory_order_relaxed); }
+
+	void checkpoint() const
+	{
+		if (isCancelRequested())
+		{
+			throw OperationCancelled();
+		}
+	}
+
+	void addEntries(uint64_t count) { entriesDone.fetch_add(count, std::memory_order_relaxed); }
+	void addBytes(uint64_t count) { bytesDone.fetch_add(count, std::memory_order_relaxed); }
+	void setBytesTotal(uint64_t total) { bytesTotal.store(total, std::memory_order_relaxed); }
+	void resetProgress()
+	{
+		entriesDone.store(0);
+		bytesDone.store(0);
+		bytesTotal.store(0);
+	}
+
+	uint64_t getEntriesDone() const { return entriesDone.load(std::memory_order_relaxed); }
+	uint64_t getBytesDone() const { return bytesDone.load(std::memory_order_relaxed); }
+	uint64_t getBytesTotal() const { return bytesTotal.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,192 @@
+#include "JobManager.h"
+#include <stdexcept>
+
+JobManager::JobManager() : nextId(1) {}
+JobManager::~JobManager()
+{
+	shutdown();
+	for (Job* job : jobs)
+	{
+		delete job;
+	}
+	jobs.clear();
+}
+
+size_t JobManager::submit(const std::string& description, Work work)
+{
+	if (!work)
+	{
+		throw std::invalid_argument("Job needs something to do.");
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Job* job = new Job(nextId++, description);
+	jobs.push_back(job);
+	job->worker = std::thread(&JobManager::execute, this, job, std::move(work));
+	return job->id;
+}
+
+void JobManager::execute(Job* job, Work work)
+{
+	int finalState = DONE;
+	std::string message;
+
+	try
+	{
+		message = work(job->control);
+	}
+	catch (const OperationCancelled&)
+	{
+		finalState = CANCELLED;
+		message = "stopped on request";
+	}
+	catch (const std::exception& e)
+	{
+		finalState = FAILED;
+		message = e.what();
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	job->message = message;
+	job->finished = std::chrono::steady_clock::now();
+	job->state.store(finalState);
+}
+
+bool JobManager::cancel(size_t id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (Job* job : jobs)
+	{
+		if (job->id == id)
+		{
+			if (job->state.load() != RUNNING)
+			{
+				return false;
+			}
+			job->control.requestCancel();
+			return true;
+		}
+	}
+	throw std::invalid_argument("No such job: " + std::to_string(id));
+}
+
+bool JobManager::hasActiveJob() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const Job* job : jobs)
+	{
+		if (job->state.load() == RUNNING)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* JobManager::stateName(int state)
+{
+	switch (state)
+	{
+	case RUNNING: return "running";
+	case DONE: return "done";
+	case FAILED: return "failed";
+	case CANCELLED: return "cancelled";
+	default: return "unknown";
+	}
+}
+
+void JobManager::printProgress(std::ostream& out, const Job& job)
+{
+	int state = job.state.load();
+	auto end = state == RUNNING ? std::chrono::steady_clock::now() : job.finished;
+	double seconds = std::chrono::duration<double>(end - job.started).count();
+
+	uint64_t entries = job.control.getEntriesDone();
+	uint64_t bytes = job.control.getBytesDone();
+	uint64_t total = job.control.getBytesTotal();
+	double megabytes = bytes / 1e6;
+
+	out << "  " << entries << " entries";
+	if (total > 0)
+	{
+		out << ", " << megabytes << " / " << (total / 1e6) << " MB";
+	}
+	else if (bytes > 0)
+	{
+		out << ", " << megabytes << " MB";
+	}
+	if (seconds > 0 && bytes > 0)
+	{
+		double rate = megabytes / seconds;
+		out << ", " << rate << " MB/s";
+		if (state == RUNNING && total > bytes && rate > 0)
+		{
+			out << ", ETA " << ((total - bytes) / 1e6) / rate << " s";
+		}
+	}
+	out << ", " << seconds << " s elapsed";
+}
+
+void JobManager::printJobs(std::ostream& out) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (jobs.empty())
+	{
+		out << "No jobs." << '\n';
+		return;
+	}
+
+	for (const Job* job : jobs)
+	{
+		int state = job->state.load();
+		out << "[" << job->id << "] " << stateName(state) << "  " << job->description << '\n';
+		printProgress(out, *job);
+		out << '\n';
+		if (state != RUNNING && !job->message.empty())
+		{
+			out << "  " << job->message << '\n';
+		}
+	}
+}
+
+void JobManager::reportFinished(std::ostream& out)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (Job* job : jobs)
+	{
+		int state = job->state.load();
+		if (state == RUNNING || job->reported)
+		{
+			continue;
+		}
+
+		if (job->worker.joinable())
+		{
+			job->worker.join(); // already past its last statement, this does not block
+		}
+		out << "[job " << job->id << "] " << stateName(state) << ": " << job->message << '\n';
+		job->reported = true;
+	}
+}
+
+void JobManager::shutdown()
+{
+	std::vector<Job*> snapshot;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		snapshot = jobs;
+	}
+
+	for (Job* job : snapshot)
+	{
+		job->control.requestCancel();
+	}
+	// joined without holding the mutex, execute() takes it on the way out
+	for (Job* job : snapshot)
+	{
+		if (job->worker.joinable())
+		{
+			job->worker.join();
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include "JobControl.h"
+
+// Runs long operations on their own threads so the prompt stays usable.
+// A job's work function returns the message shown when it completes;
+// throwing reports the job as failed, OperationCancelled as cancelled.
+class JobManager
+{
+public:
+	typedef std::function<std::string(JobControl&)> Work;
+
+private:
+	enum State { RUNNING, DONE, FAILED, CANCELLED };
+
+	struct Job
+	{
+		size_t id;
+		std::string description;
+		JobControl control;
+		std::thread worker;
+		std::atomic<int> state;
+		std::string message; //guarded by JobManager::mutex
+		bool reported;       //completion already shown to the user
+		std::chrono::steady_clock::time_point started;
+		std::chrono::steady_clock::time_point finished;
+
+		Job(size_t id, const std::string& description)
+			: id(id), description(description), state(RUNNING), reported(false), started(std::chrono::steady_clock::now()) {}
+	};
+
+	std::vector<Job*> jobs;
+	mutable std::mutex mutex;
+	size_t nextId;
+
+	void execute(Job* job, Work work);
+	static const char* stateName(int state);
+	static void printProgress(std::ostream& out, const Job& job);
+
+public:
+	JobManager();
+	~JobManager();
+
+	JobManager(const JobManager&) = delete;
+	JobManager& operator=(const JobManager&) = delete;
+
+	size_t submit(const std::string& description, Work work);
+	bool cancel(size_t id);
+	bool hasActiveJob() const;
+
+	void printJobs(std::ostream& out) const;
+	void reportFinished(std::ostream& out); //prints each completion once
+	void shutdown(); //cancels everything still running and waits for it
+};
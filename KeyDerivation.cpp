@@ -0,0 +1,93 @@
+#include "KeyDerivation.h"
+#include "Sha256.h"
+#include <stdexcept>
+#include <chrono>
+#include <cmath>
+
+std::string KeyDerivation::pbkdf2(const std::string& password, const std::string& salt, uint32_t iterations, size_t length)
+{
+	if (iterations == 0)
+	{
+		throw std::invalid_argument("KDF iterations must be positive.");
+	}
+
+	// HMAC key: hashed when longer than a block, then zero-padded
+	std::string key = password.size() > Sha256::BLOCK_SIZE ? Sha256::hash(password) : password;
+	key.resize(Sha256::BLOCK_SIZE, '\0');
+
+	std::string innerPad(key), outerPad(key);
+	for (size_t i = 0; i < Sha256::BLOCK_SIZE; ++i)
+	{
+		innerPad[i] ^= 0x36;
+		outerPad[i] ^= 0x5c;
+	}
+
+	// the padded keys are the same for every HMAC, hash them once and copy the state
+	Sha256 inner, outer;
+	inner.update(innerPad);
+	outer.update(outerPad);
+	auto hmac = [&inner, &outer](const std::string& message)
+	{
+		Sha256 innerHash(inner);
+		innerHash.update(message);
+		Sha256 outerHash(outer);
+		outerHash.update(innerHash.digest());
+		return outerHash.digest();
+	};
+
+	std::string derived;
+	for (uint32_t blockIndex = 1; derived.size() < length; ++blockIndex)
+	{
+		std::string first = salt;
+		first.push_back(static_cast<char>(blockIndex >> 24));
+		first.push_back(static_cast<char>(blockIndex >> 16));
+		first.push_back(static_cast<char>(blockIndex >> 8));
+		first.push_back(static_cast<char>(blockIndex));
+
+		std::string u = hmac(first);
+		std::string block = u;
+		for (uint32_t i = 1; i < iterations; ++i)
+		{
+			u = hmac(u);
+			for (size_t j = 0; j < block.size(); ++j)
+			{
+				block[j] ^= u[j];
+			}
+		}
+		derived += block;
+	}
+
+	derived.resize(length);
+	return derived;
+}
+
+double KeyDerivation::iterationsPerSecond()
+{
+	const uint32_t batch = 4096;
+	uint64_t done = 0;
+	auto started = std::chrono::steady_clock::now();
+	double seconds = 0;
+
+	do
+	{
+		pbkdf2("calibration password", "calibration salt", batch, Sha256::DIGEST_SIZE);
+		done += batch;
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	} while (seconds < 0.1);
+
+	return done / seconds;
+}
+
+uint32_t KeyDerivation::iterationsForTarget(double perSecond, double targetMilliseconds)
+{
+	double wanted = perSecond * targetMilliseconds / 1000.0;
+	if (wanted < MIN_ITERATIONS)
+	{
+		return MIN_ITERATIONS;
+	}
+	if (wanted > 4e9)
+	{
+		return 4000000000u;
+	}
+	return static_cast<uint32_t>(std::round(wanted / 1000.0) * 1000.0); // round numbers read better in the header dump
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// PBKDF2-HMAC-SHA256 (RFC 8018) for turning a master password into a key,
+// plus the measurements behind the 'calibrate' command.
+class KeyDerivation
+{
+public:
+	static std::string pbkdf2(const std::string& password, const std::string& salt, uint32_t iterations, size_t length);
+
+	static double iterationsPerSecond(); //measured on the calling thread, takes about a tenth of a second
+	static uint32_t iterationsForTarget(double perSecond, double targetMilliseconds);
+
+	static const uint32_t MIN_ITERATIONS = 10000;
+};
@@ -0,0 +1,332 @@
+#include "LoadGenerator.h"
+#include "VaultClient.h"
+#include "VaultServer.h"
+#include <iostream>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+LoadGenerator::LoadGenerator(size_t connections, size_t requests, size_t keyCount)
+	: connections(connections), requests(requests), keyCount(keyCount)
+{
+	if (connections == 0 || requests == 0 || keyCount == 0)
+	{
+		throw std::invalid_argument("Connections, requests and keys must be positive.");
+	}
+}
+
+std::string LoadGenerator::keyWebsite(size_t index) const
+{
+	return "loadgen-" + std::to_string(index % keyCount) + ".example";
+}
+
+std::vector<size_t> LoadGenerator::seed(const std::string& socketPath) const
+{
+	VaultClient client(socketPath);
+	std::vector<size_t> added;
+	for (size_t i = 0; i < keyCount; ++i)
+	{
+		// an existing key comes back as an error and is left alone afterwards
+		VaultProtocol::Frame response = client.call(VaultProtocol::OP_SAVE, { keyWebsite(i), "loadgen", "secret" + std::to_string(i) });
+		if (response.code == VaultProtocol::STATUS_OK)
+		{
+			added.push_back(i);
+		}
+	}
+	return added;
+}
+
+void LoadGenerator::unseed(const std::string& socketPath, const std::vector<size_t>& added) const
+{
+	VaultClient client(socketPath);
+	for (size_t i : added)
+	{
+		client.call(VaultProtocol::OP_DELETE, { keyWebsite(i), "loadgen" });
+	}
+}
+
+void LoadGenerator::printReport(const std::string& label, std::vector<uint64_t>& latencies, double seconds, size_t failures)
+{
+	if (latencies.empty())
+	{
+		std::cout << label << ": no requests completed" << std::endl;
+		return;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&latencies](double p)
+	{
+		size_t index = static_cast<size_t>(p * (latencies.size() - 1));
+		return latencies[index] / 1000.0;
+	};
+
+	std::cout << label << ": " << latencies.size() << " requests in " << seconds << " s" << std::endl;
+	std::cout << "  QPS:  " << (latencies.size() / seconds) << std::endl;
+	std::cout << "  p50:  " << percentile(0.50) << " us" << std::endl;
+	std::cout << "  p99:  " << percentile(0.99) << " us" << std::endl;
+	std::cout << "  max:  " << latencies.back() / 1000.0 << " us" << std::endl;
+	if (failures > 0)
+	{
+		std::cout << "  failed: " << failures << std::endl;
+	}
+}
+
+void LoadGenerator::runAgainstDaemon(const std::string& socketPath) const
+{
+	std::vector<size_t> added = seed(socketPath);
+
+	std::vector<std::vector<uint64_t>> perConnection(connections);
+	std::vector<size_t> failures(connections, 0);
+	std::vector<std::thread> threads;
+
+	auto started = std::chrono::steady_clock::now();
+	for (size_t c = 0; c < connections; ++c)
+	{
+		size_t share = requests / connections + (c < requests % connections ? 1 : 0);
+		threads.emplace_back([this, c, share, &socketPath, &perConnection, &failures]
+		{
+			try
+			{
+				VaultClient client(socketPath);
+				std::vector<uint64_t>& latencies = perConnection[c];
+				latencies.reserve(share);
+
+				for (size_t r = 0; r < share; ++r)
+				{
+					auto before = std::chrono::steady_clock::now();
+					VaultProtocol::Frame response = client.call(VaultProtocol::OP_LOAD, { keyWebsite(c * share + r), "loadgen" });
+					auto after = std::chrono::steady_clock::now();
+
+					latencies.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count()));
+					if (response.code != VaultProtocol::STATUS_OK)
+					{
+						++failures[c];
+					}
+				}
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "Connection " << c << " failed: " << e.what() << std::endl;
+				++failures[c];
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	std::vector<uint64_t> all;
+	size_t failed = 0;
+	for (size_t c = 0; c < connections; ++c)
+	{
+		all.insert(all.end(), perConnection[c].begin(), perConnection[c].end());
+		failed += failures[c];
+	}
+	printReport("daemon (" + std::to_string(connections) + " connections)", all, seconds, failed);
+
+	unseed(socketPath, added);
+}
+
+std::string LoadGenerator::selfExecutable()
+{
+	char path[4096];
+	ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+	if (length <= 0)
+	{
+		throw std::runtime_error("Cannot locate the password manager executable.");
+	}
+	return std::string(path, static_cast<size_t>(length));
+}
+
+int LoadGenerator::runBatch(const std::string& executable, const std::string& script, char* const* environment)
+{
+	int stdinPipe[2];
+	if (pipe(stdinPipe) < 0)
+	{
+		throw std::runtime_error("Cannot create pipe: " + std::string(std::strerror(errno)));
+	}
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, stdinPipe[0], 0);
+	posix_spawn_file_actions_addclose(&actions, stdinPipe[1]);
+	posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+	posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+
+	// batch mode runs every command to completion and exits non-zero at the first failure,
+	// the interactive shell would open in the background and always exit 0
+	char* argv[] = { const_cast<char*>(executable.c_str()), const_cast<char*>("--batch"), const_cast<char*>("-"),
+		const_cast<char*>("--stop-on-error"), nullptr };
+	pid_t child;
+	int spawnError = posix_spawn(&child, executable.c_str(), &actions, nullptr, argv, environment);
+	posix_spawn_file_actions_destroy(&actions);
+	close(stdinPipe[0]);
+
+	if (spawnError != 0)
+	{
+		close(stdinPipe[1]);
+		throw std::runtime_error("Cannot spawn " + executable + ": " + std::strerror(spawnError));
+	}
+
+	ssize_t ignored = write(stdinPipe[1], script.data(), script.size());
+	(void)ignored;
+	close(stdinPipe[1]);
+
+	int status = 0;
+	waitpid(child, &status, 0);
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+std::string LoadGenerator::seedCopy(const std::string& executable, const std::string& vaultFile, char* const* environment) const
+{
+	std::string scratch = vaultFile + ".loadgen-scratch";
+	std::string rows = scratch + ".csv";
+	if (scratch.find_first_of("\"\n") != std::string::npos)
+	{
+		throw std::invalid_argument("The vault path cannot be quoted in a batch script: " + vaultFile);
+	}
+	{
+		std::ifstream source(vaultFile.c_str(), std::ios::binary);
+		std::ofstream copy(scratch.c_str(), std::ios::binary | std::ios::trunc);
+		if (!source.is_open() || !copy.is_open() || !(copy << source.rdbuf()))
+		{
+			std::remove(scratch.c_str());
+			throw std::runtime_error("Cannot copy " + vaultFile + " to " + scratch);
+		}
+
+		std::ofstream csv(rows.c_str(), std::ios::trunc);
+		for (size_t i = 0; i < keyCount; ++i)
+		{
+			csv << keyWebsite(i) << ",loadgen,secret" << i << '\n';
+		}
+	}
+
+	// one import saves the copy once, where a save per key would rewrite it keyCount times
+	int status = runBatch(executable, "open \"" + scratch + "\"\n"
+		+ "import \"" + rows + "\" --on-conflict overwrite\n", environment);
+	std::remove(rows.c_str());
+	if (status != 0)
+	{
+		std::remove(scratch.c_str());
+		throw std::runtime_error("Cannot seed the scratch copy of " + vaultFile + " (wrong password?)");
+	}
+	return scratch;
+}
+
+void LoadGenerator::runProcessPerRequest(const std::string& vaultFile, const std::string& password) const
+{
+	std::string executable = selfExecutable();
+
+	// children get the password in PM_MASTER_PASSWORD: the tokenizer cannot quote every password, and argv is public
+	std::vector<std::string> variables;
+	for (char** variable = environ; *variable != nullptr; ++variable)
+	{
+		if (std::strncmp(*variable, "PM_MASTER_PASSWORD=", 19) != 0)
+		{
+			variables.push_back(*variable);
+		}
+	}
+	variables.push_back("PM_MASTER_PASSWORD=" + password);
+	std::vector<char*> environment;
+	for (std::string& variable : variables)
+	{
+		environment.push_back(&variable[0]);
+	}
+	environment.push_back(nullptr);
+
+	std::string scratch = seedCopy(executable, vaultFile, environment.data()); //the vault itself is never written
+	std::vector<uint64_t> latencies;
+	latencies.reserve(requests);
+	size_t failed = 0;
+
+	auto started = std::chrono::steady_clock::now();
+	for (size_t r = 0; r < requests; ++r)
+	{
+		std::string script = "open \"" + scratch + "\"\n"
+			+ "load " + keyWebsite(r) + " loadgen\n";
+
+		auto before = std::chrono::steady_clock::now();
+		int status = runBatch(executable, script, environment.data());
+		auto after = std::chrono::steady_clock::now();
+
+		latencies.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count()));
+		if (status != 0)
+		{
+			++failed;
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	std::remove(scratch.c_str());
+
+	printReport("process per request", latencies, seconds, failed);
+}
+
+int LoadGenerator::runFromArguments(const std::vector<std::string>& args)
+{
+	bool spawnMode = args[0] == "--loadgen-spawn";
+	size_t positional = 2; // mode flag + socket, or mode flag + vault
+
+	if (args.size() < positional || (args.size() - positional) % 2 != 0)
+	{
+		std::cerr << "Usage: --loadgen <socket> [--connections N] [--requests N] [--keys N]" << std::endl;
+		std::cerr << "       --loadgen-spawn <vault-file> [--requests N] [--keys N]" << std::endl;
+		std::cerr << "       (the master password is read from PM_MASTER_PASSWORD, or else from the first line of stdin)" << std::endl;
+		return 1;
+	}
+
+	size_t connections = 4;
+	size_t requests = spawnMode ? 200 : 100000;
+	size_t keys = 1000;
+
+	for (size_t i = positional; i < args.size(); i += 2)
+	{
+		char* end;
+		long value = std::strtol(args[i + 1].c_str(), &end, 10);
+		if (*end != '\0' || value <= 0)
+		{
+			throw std::invalid_argument("Invalid value for " + args[i] + ": " + args[i + 1]);
+		}
+
+		if (args[i] == "--connections" && !spawnMode)
+		{
+			connections = static_cast<size_t>(value);
+		}
+		else if (args[i] == "--requests")
+		{
+			requests = static_cast<size_t>(value);
+		}
+		else if (args[i] == "--keys")
+		{
+			keys = static_cast<size_t>(value);
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown load generator option: " + args[i]);
+		}
+	}
+
+	LoadGenerator generator(connections, requests, keys);
+	if (spawnMode)
+	{
+		generator.runProcessPerRequest(args[1], VaultServer::readMasterPassword());
+	}
+	else
+	{
+		generator.runAgainstDaemon(args[1]);
+	}
+	return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Local load generator used to compare the vault daemon against spawning
+// one CLI process per lookup. Both modes query the same "loadgen-<i>.example" keys,
+// and neither leaves them behind in the vault under test.
+class LoadGenerator
+{
+private:
+	size_t connections;
+	size_t requests; //total lookups across all connections
+	size_t keyCount;
+
+	std::string keyWebsite(size_t index) const;
+
+	std::vector<size_t> seed(const std::string& socketPath) const; //returns the keys it added
+	void unseed(const std::string& socketPath, const std::vector<size_t>& added) const;
+	static void printReport(const std::string& label, std::vector<uint64_t>& latencies, double seconds, size_t failures);
+	static std::string selfExecutable();
+	// child's exit status, -1 if it did not exit; environment carries the master password, never the script
+	static int runBatch(const std::string& executable, const std::string& script, char* const* environment);
+	std::string seedCopy(const std::string& executable, const std::string& vaultFile, char* const* environment) const; //scratch vault path
+
+public:
+	LoadGenerator(size_t connections, size_t requests, size_t keyCount);
+
+	void runAgainstDaemon(const std::string& socketPath) const;
+	void runProcessPerRequest(const std::string& vaultFile, const std::string& password) const;
+
+	// --loadgen <socket> [--connections N] [--requests N] [--keys N]
+	// --loadgen-spawn <vault-file> [--requests N] [--keys N], the password as for --daemon
+	static int runFromArguments(const std::vector<std::string>& args);
+};
@@ -4,6 +4,12 @@
 #include <stdexcept>
 #include "PasswordManager.h"
 #include "CommandProcessor.h"
+#include "VaultServer.h"
+#include "LoadGenerator.h"
+#include "BatchRunner.h"
+#include "RekeyBenchmark.h"
+#include "FileCipherBenchmark.h"
+#include "ChainBenchmark.h"
 
 //fileCipher constructor - add validations for null/invalid data
 //encapsulation - validation for set, add const
@@ -16,19 +22,50 @@
 //simple encriptor for the whole file, like the simpleEncryptDecrypt
 
 
-int main()
+int main(int argc, char* argv[])
 {
     try 
     {
+        std::vector<std::string> args(argv + 1, argv + argc);
+        if (!args.empty() && args[0] == "--daemon")
+        {
+            return VaultServer::runFromArguments(args);
+        }
+        if (!args.empty() && (args[0] == "--loadgen" || args[0] == "--loadgen-spawn"))
+        {
+            return LoadGenerator::runFromArguments(args);
+        }
+        if (!args.empty() && args[0] == "--batch")
+        {
+            return BatchRunner::runFromArguments(args);
+        }
+        if (!args.empty() && args[0] == "--bench-rekey")
+        {
+            return RekeyBenchmark::runFromArguments(args);
+        }
+        if (!args.empty() && args[0] == "--bench-file-cipher")
+        {
+            return FileCipherBenchmark::runFromArguments(args);
+        }
+        if (!args.empty() && args[0] == "--bench-chain")
+        {
+            return ChainBenchmark::runFromArguments(args);
+        }
+
         CommandProcessor commandProcessor;
+        commandProcessor.setBackgroundJobs(true);
 
         std::cout << "Password Manager - Enter 'help' for available commands or 'exit' to quit" << std::endl;
 
         std::string commandLine;
         while (true) 
         {
+            commandProcessor.reportFinishedJobs();
             std::cout << "\n" << ">> ";
-            std::getline(std::cin, commandLine);
+            if (!std::getline(std::cin, commandLine))
+            {
+                break; // end of input
+            }
 
             if (commandLine == "exit") 
             {
@@ -0,0 +1,72 @@
+#include "MigrationWorker.h"
+#include <iostream>
+#include <exception>
+
+MigrationWorker::MigrationWorker(Flush flush) : flush(std::move(flush)), stopping(false) {}
+MigrationWorker::~MigrationWorker()
+{
+	stop();
+}
+
+void MigrationWorker::enqueue(const std::vector<PasswordManager::EntryKey>& keys)
+{
+	if (keys.empty())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (stopping)
+	{
+		return; // the entries simply stay on their old cipher
+	}
+	pending.insert(pending.end(), keys.begin(), keys.end());
+	if (!worker.joinable())
+	{
+		worker = std::thread(&MigrationWorker::run, this);
+	}
+	changed.notify_one();
+}
+
+void MigrationWorker::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		changed.wait(lock, [this] { return stopping || !pending.empty(); });
+		if (pending.empty())
+		{
+			return; // stopping with nothing left
+		}
+
+		// let more reads pile up, a stop cuts the wait short
+		changed.wait_for(lock, COLLECT_DELAY, [this] { return stopping; });
+
+		std::vector<PasswordManager::EntryKey> batch;
+		batch.swap(pending);
+		lock.unlock();
+		try
+		{
+			flush(batch);
+		}
+		catch (const std::exception& e)
+		{
+			// the entries stay on their old cipher and are picked up by the next read
+			std::cerr << "Cipher migration failed: " << e.what() << std::endl;
+		}
+		lock.lock();
+	}
+}
+
+void MigrationWorker::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		changed.notify_all();
+	}
+	if (worker.joinable())
+	{
+		worker.join();
+	}
+}
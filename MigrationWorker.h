@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "PasswordManager.h"
+
+// Re-encrypts entries that reads found on a legacy cipher, off the reading
+// thread. Keys are collected for a short while before each flush because
+// every flush saves the whole vault once.
+class MigrationWorker
+{
+public:
+	typedef std::function<void(std::vector<PasswordManager::EntryKey>&)> Flush;
+
+private:
+	Flush flush;
+	std::vector<PasswordManager::EntryKey> pending;
+	bool stopping;
+
+	std::thread worker; //started with the first enqueue
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	static constexpr std::chrono::milliseconds COLLECT_DELAY{ 500 };
+
+	void run();
+
+public:
+	explicit MigrationWorker(Flush flush);
+	~MigrationWorker();
+
+	MigrationWorker(const MigrationWorker&) = delete;
+	MigrationWorker& operator=(const MigrationWorker&) = delete;
+
+	void enqueue(const std::vector<PasswordManager::EntryKey>& keys);
+	void stop(); //flushes what is still queued and waits
+};
@@ -1,2 +1,189 @@
 #include "PasswordEntry.h"
-//not needed for now
\ No newline at end of file
+#include <algorithm>
+
+namespace
+{
+	void checkName(const std::string& name, const char* what)
+	{
+		if (name.empty())
+		{
+			throw std::invalid_argument(std::string(what) + " cannot be empty.");
+		}
+		if (name.find('\n') != std::string::npos)
+		{
+			throw std::invalid_argument(std::string(what) + " cannot contain a line break.");
+		}
+	}
+
+	void appendEscaped(std::string& out, const std::string& text)
+	{
+		static const char hex[] = "0123456789ABCDEF";
+		for (char c : text)
+		{
+			unsigned char u = static_cast<unsigned char>(c);
+			if (u < 32 || u == 127 || c == '%' || c == ',' || c == '=' || c == '#' || c == '&' || c == '|')
+			{
+				out += '%';
+				out += hex[u >> 4];
+				out += hex[u & 15];
+			}
+			else
+			{
+				out += c;
+			}
+		}
+	}
+
+	int hexValue(char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		return -1;
+	}
+
+	std::string unescaped(const std::string& text, size_t begin, size_t end)
+	{
+		std::string out;
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (text[i] != '%')
+			{
+				out += text[i];
+				continue;
+			}
+			int high = i + 2 < end ? hexValue(text[i + 1]) : -1;
+			int low = i + 2 < end ? hexValue(text[i + 2]) : -1;
+			if (high < 0 || low < 0)
+			{
+				throw std::invalid_argument("Malformed escape in entry attributes");
+			}
+			out += static_cast<char>(high * 16 + low);
+			i += 2;
+		}
+		return out;
+	}
+
+	bool fieldBefore(const std::pair<std::string, std::string>& field, const std::string& name)
+	{
+		return field.first < name;
+	}
+}
+
+bool PasswordEntry::addTag(const std::string& tag)
+{
+	checkName(tag, "Tag");
+	auto position = std::lower_bound(tags.begin(), tags.end(), tag);
+	if (position != tags.end() && *position == tag)
+	{
+		return false;
+	}
+	tags.insert(position, tag);
+	return true;
+}
+
+bool PasswordEntry::removeTag(const std::string& tag)
+{
+	auto position = std::lower_bound(tags.begin(), tags.end(), tag);
+	if (position == tags.end() || *position != tag)
+	{
+		return false;
+	}
+	tags.erase(position);
+	return true;
+}
+
+bool PasswordEntry::setField(const std::string& name, const std::string& value)
+{
+	checkName(name, "Field name");
+	checkName(value, "Field value");
+	auto position = std::lower_bound(fields.begin(), fields.end(), name, fieldBefore);
+	if (position != fields.end() && position->first == name)
+	{
+		if (position->second == value)
+		{
+			return false;
+		}
+		position->second = value;
+		return true;
+	}
+	fields.insert(position, std::make_pair(name, value));
+	return true;
+}
+
+bool PasswordEntry::removeField(const std::string& name)
+{
+	auto position = std::lower_bound(fields.begin(), fields.end(), name, fieldBefore);
+	if (position == fields.end() || position->first != name)
+	{
+		return false;
+	}
+	fields.erase(position);
+	return true;
+}
+
+std::string PasswordEntry::encodeAttributes() const
+{
+	std::string out = "&";
+	for (const std::string& tag : tags)
+	{
+		if (out.size() > 1) out += ',';
+		out += '#';
+		appendEscaped(out, tag);
+	}
+	for (const auto& field : fields)
+	{
+		if (out.size() > 1) out += ',';
+		appendEscaped(out, field.first);
+		out += '=';
+		appendEscaped(out, field.second);
+	}
+	return out;
+}
+
+void PasswordEntry::decodeAttributes(const std::string& text)
+{
+	if (text.empty() || text[0] != '&')
+	{
+		throw std::invalid_argument("Entry attributes must start with '&'");
+	}
+
+	std::vector<std::string> newTags;
+	std::vector<std::pair<std::string, std::string>> newFields;
+	size_t begin = 1;
+	while (begin < text.size())
+	{
+		size_t end = text.find(',', begin);
+		if (end == std::string::npos)
+		{
+			end = text.size();
+		}
+
+		if (text[begin] == '#')
+		{
+			newTags.push_back(unescaped(text, begin + 1, end));
+			checkName(newTags.back(), "Tag");
+		}
+		else
+		{
+			size_t equals = text.find('=', begin);
+			if (equals == std::string::npos || equals >= end)
+			{
+				throw std::invalid_argument("Entry attribute without '=' or '#'");
+			}
+			newFields.emplace_back(unescaped(text, begin, equals), unescaped(text, equals + 1, end));
+			checkName(newFields.back().first, "Field name");
+			checkName(newFields.back().second, "Field value");
+		}
+		begin = end + 1;
+	}
+
+	// written sorted, but a hand-edited file may not be
+	std::sort(newTags.begin(), newTags.end());
+	newTags.erase(std::unique(newTags.begin(), newTags.end()), newTags.end());
+	std::stable_sort(newFields.begin(), newFields.end(), [](const std::pair<std::string, std::string>& a, const std::pair<std::string, std::string>& b) { return a.first < b.first; });
+	newFields.erase(std::unique(newFields.begin(), newFields.end(), [](const std::pair<std::string, std::string>& a, const std::pair<std::string, std::string>& b) { return a.first == b.first; }), newFields.end());
+
+	tags.swap(newTags);
+	fields.swap(newFields);
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <string>
 #include <stdexcept>
+#include <vector>
+#include <utility>
 
 class PasswordEntry
 {
@@ -8,10 +10,13 @@ private:
 	std::string website;
 	std::string username;
 	std::string password;
+	unsigned generation; //which of the vault's ciphers encrypted the password
+	std::vector<std::string> tags; //sorted, no duplicates
+	std::vector<std::pair<std::string, std::string>> fields; //custom metadata, sorted by name
 
 public:
-	PasswordEntry(const std::string& site, const std::string& user, const std::string& pass)
-		: website(site), username(user), password(pass) {}
+	PasswordEntry(const std::string& site, const std::string& user, const std::string& pass, unsigned gen = 0)
+		: website(site), username(user), password(pass), generation(gen) {}
 
 	const std::string& getWebsite() const {
 		return website;
@@ -22,6 +27,32 @@ public:
 	const std::string& getPassword() const {
 		return password;
 	}
+	unsigned getGeneration() const {
+		return generation;
+	}
+	void setGeneration(unsigned gen) {
+		generation = gen;
+	}
+
+	const std::vector<std::string>& getTags() const {
+		return tags;
+	}
+	const std::vector<std::pair<std::string, std::string>>& getFields() const {
+		return fields;
+	}
+	bool hasAttributes() const {
+		return !tags.empty() || !fields.empty();
+	}
+	bool addTag(const std::string& tag); //false if already there
+	bool removeTag(const std::string& tag); //false if not there
+	bool setField(const std::string& name, const std::string& value); //false if unchanged
+	bool removeField(const std::string& name); //false if not there
+
+	// Tags and fields as one vault field, "&#prod,#db,owner=infra": '&' marks it,
+	// '#' a tag, and '%', ',', '=', '#', '&', '|' and control characters inside
+	// names and values are %XX escaped so the field never holds a '|'.
+	std::string encodeAttributes() const;
+	void decodeAttributes(const std::string& text); //throws std::invalid_argument if malformed
 
 
 	void setPassword(const std::string& newPassword) 
@@ -0,0 +1,126 @@
+#include "PasswordGenerator.h"
+#include "Rekeyer.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <atomic>
+#include <stdexcept>
+#include <algorithm>
+
+PasswordGenerator::PasswordGenerator(const std::string& alphabet, size_t length) : length(length)
+{
+	bool seen[256] = {};
+	for (unsigned char c : alphabet)
+	{
+		if (c == '\n' || c == '\r' || c == '\0')
+		{
+			throw std::invalid_argument("Password characters cannot include line breaks or NUL.");
+		}
+		if (!seen[c])
+		{
+			seen[c] = true;
+			this->alphabet.push_back(static_cast<char>(c));
+		}
+	}
+
+	if (this->alphabet.size() < 2)
+	{
+		throw std::invalid_argument("Password alphabet needs at least two distinct characters.");
+	}
+	if (length == 0 || length > MAX_LENGTH)
+	{
+		throw std::invalid_argument("Password length must be between 1 and " + std::to_string(MAX_LENGTH) + ".");
+	}
+}
+
+std::string PasswordGenerator::next()
+{
+	std::string password(length, '\0');
+	for (char& c : password)
+	{
+		c = alphabet[random.uniform(static_cast<uint32_t>(alphabet.size()))];
+	}
+	return password;
+}
+
+std::vector<PasswordEntry> PasswordGenerator::generateEntries(const std::string& website, const std::vector<std::string>& users,
+	const Cipher& cipher, JobControl& control) const
+{
+	std::vector<std::string> encrypted(users.size());
+	std::atomic<bool> lossy(false);
+
+	const size_t taskCount = (users.size() + ENTRIES_PER_TASK - 1) / ENTRIES_PER_TASK;
+	ThreadPool::shared().parallelFor(taskCount, [this, &users, &cipher, &control, &encrypted, &lossy](size_t task)
+	{
+		control.checkpoint();
+
+		// neither generators nor ciphers are shared between threads
+		PasswordGenerator generator(alphabet, length);
+		std::unique_ptr<Cipher> localCipher(cipher.clone());
+
+		size_t begin = task * ENTRIES_PER_TASK;
+		size_t end = std::min(begin + ENTRIES_PER_TASK, users.size());
+		for (size_t i = begin; i < end && !lossy.load(); ++i)
+		{
+			std::string password = generator.next();
+			if (!Rekeyer::encryptLossless(*localCipher, password, encrypted[i]))
+			{
+				lossy.store(true);
+			}
+			std::fill(password.begin(), password.end(), '\0');
+		}
+		control.addEntries(end - begin);
+	});
+
+	if (lossy.load())
+	{
+		throw std::runtime_error("The " + cipher.getType() + " cipher cannot store these passwords without loss. "
+			"Pick a --charset and --length it can hold.");
+	}
+
+	std::vector<PasswordEntry> entries;
+	entries.reserve(users.size());
+	for (size_t i = 0; i < users.size(); ++i)
+	{
+		entries.emplace_back(website, users[i], encrypted[i]);
+	}
+	return entries;
+}
+
+std::string PasswordGenerator::parseCharset(const std::string& name, const Cipher& cipher)
+{
+	std::string characters;
+	auto addRange = [&characters](char first, char last)
+	{
+		for (char c = first; c <= last; ++c)
+		{
+			characters.push_back(c);
+		}
+	};
+
+	if (name == "cipher")
+	{
+		return cipher.getAlphabet();
+	}
+	if (name == "printable")
+	{
+		addRange(32, 126);
+	}
+	else if (name == "alnum" || name == "letters")
+	{
+		addRange('a', 'z');
+		addRange('A', 'Z');
+		if (name == "alnum")
+		{
+			addRange('0', '9');
+		}
+	}
+	else if (name == "digits")
+	{
+		addRange('0', '9');
+	}
+	else
+	{
+		characters = name;
+	}
+	return characters;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Cipher.h"
+#include "PasswordEntry.h"
+#include "JobControl.h"
+#include "RandomGenerator.h"
+
+// Random passwords for the 'generate' command. Every character is drawn
+// uniformly from the alphabet with RandomGenerator; bulk runs generate and
+// encrypt on the shared pool, one generator and cipher copy per task, and the
+// caller stores the result with a single PasswordManager::mergeEntries.
+class PasswordGenerator
+{
+private:
+	std::string alphabet; //distinct characters
+	size_t length;
+	RandomGenerator random;
+
+	static const size_t ENTRIES_PER_TASK = 4096;
+
+public:
+	static const size_t MAX_LENGTH = 1024;
+
+	PasswordGenerator(const std::string& alphabet, size_t length);
+
+	std::string next();
+
+	// one encrypted entry per user; throws if the cipher cannot store the passwords without loss
+	std::vector<PasswordEntry> generateEntries(const std::string& website, const std::vector<std::string>& users,
+		const Cipher& cipher, JobControl& control) const;
+
+	// printable, alnum, letters, digits, cipher (what the cipher can store), or the characters themselves
+	static std::string parseCharset(const std::string& name, const Cipher& cipher);
+};
@@ -0,0 +1,178 @@
+#include "PasswordHistory.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	std::string keyOf(const PasswordHistory::Version& version)
+	{
+		return version.website + '|' + version.username;
+	}
+
+	// digits up to the next '|', pos moves past it
+	uint64_t readNumber(const std::string& text, size_t& pos, size_t end)
+	{
+		size_t bar = text.find('|', pos);
+		if (bar == std::string::npos || bar >= end || bar == pos || bar - pos > 19)
+		{
+			throw std::runtime_error("Malformed history record");
+		}
+		uint64_t value = 0;
+		for (size_t i = pos; i < bar; ++i)
+		{
+			if (text[i] < '0' || text[i] > '9')
+			{
+				throw std::runtime_error("Malformed history record");
+			}
+			value = value * 10 + static_cast<uint64_t>(text[i] - '0');
+		}
+		pos = bar + 1;
+		return value;
+	}
+}
+
+void PasswordHistory::sort(std::vector<Version>& versions)
+{
+	std::stable_sort(versions.begin(), versions.end(), [](const Version& a, const Version& b)
+	{
+		if (a.website != b.website)
+		{
+			return a.website < b.website;
+		}
+		if (a.username != b.username)
+		{
+			return a.username < b.username;
+		}
+		return a.replaced < b.replaced;
+	});
+}
+
+std::string PasswordHistory::encode(std::vector<Version>& versions)
+{
+	sort(versions);
+
+	std::string text;
+	std::string previous;
+	for (const Version& version : versions)
+	{
+		std::string key = keyOf(version);
+		size_t shared = 0;
+		while (shared < key.size() && shared < previous.size() && key[shared] == previous[shared])
+		{
+			++shared;
+		}
+		text += std::to_string(shared);
+		text += '|';
+		text += std::to_string(key.size() - shared);
+		text += '|';
+		text.append(key, shared, std::string::npos);
+		text += '|';
+		text += std::to_string(version.replaced);
+		text += '|';
+		text += std::to_string(version.generation);
+		text += '|';
+		text += version.password;
+		text += '\n';
+		previous.swap(key);
+	}
+	return text;
+}
+
+void PasswordHistory::decode(const std::string& text, std::vector<Version>& out)
+{
+	std::string previous;
+	size_t lineStart = 0;
+	while (lineStart < text.size())
+	{
+		size_t end = text.find('\n', lineStart);
+		if (end == std::string::npos)
+		{
+			end = text.size();
+		}
+
+		size_t pos = lineStart;
+		uint64_t shared = readNumber(text, pos, end);
+		uint64_t rest = readNumber(text, pos, end);
+		if (shared > previous.size() || rest > end - pos)
+		{
+			throw std::runtime_error("Malformed history record");
+		}
+		std::string key = previous.substr(0, static_cast<size_t>(shared)) + text.substr(pos, static_cast<size_t>(rest));
+		pos += static_cast<size_t>(rest);
+		if (pos >= end || text[pos] != '|')
+		{
+			throw std::runtime_error("Malformed history record");
+		}
+		++pos;
+
+		Version version;
+		version.replaced = static_cast<int64_t>(readNumber(text, pos, end));
+		version.generation = static_cast<unsigned>(readNumber(text, pos, end));
+		version.password = text.substr(pos, end - pos);
+		size_t bar = key.find('|');
+		if (bar == std::string::npos || bar == 0 || bar + 1 == key.size())
+		{
+			throw std::runtime_error("Malformed history record");
+		}
+		version.website = key.substr(0, bar);
+		version.username = key.substr(bar + 1);
+		out.push_back(std::move(version));
+
+		previous.swap(key);
+		lineStart = end + 1;
+	}
+}
+
+void PasswordHistory::prune(std::vector<Version>& versions, size_t keep)
+{
+	size_t kept = 0;
+	for (size_t begin = 0; begin < versions.size();)
+	{
+		size_t end = begin + 1;
+		while (end < versions.size() && versions[end].website == versions[begin].website && versions[end].username == versions[begin].username)
+		{
+			++end;
+		}
+		for (size_t i = end - std::min(keep, end - begin); i < end; ++i)
+		{
+			if (kept != i)
+			{
+				versions[kept] = std::move(versions[i]);
+			}
+			++kept;
+		}
+		begin = end;
+	}
+	versions.resize(kept);
+}
+
+void PasswordHistory::applyDeletions(std::vector<Version>& versions)
+{
+	size_t kept = 0;
+	for (size_t begin = 0; begin < versions.size();)
+	{
+		size_t end = begin + 1;
+		while (end < versions.size() && versions[end].website == versions[begin].website && versions[end].username == versions[begin].username)
+		{
+			++end;
+		}
+		size_t first = begin; //after the last marker of this entry
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (versions[i].password.empty())
+			{
+				first = i + 1;
+			}
+		}
+		for (size_t i = first; i < end; ++i)
+		{
+			if (kept != i)
+			{
+				versions[kept] = std::move(versions[i]);
+			}
+			++kept;
+		}
+		begin = end;
+	}
+	versions.resize(kept);
+}
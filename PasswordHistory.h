@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Earlier passwords of entries, kept in the history segment of a chunked
+// vault: sealed HISTORY records after the entry records. Every save that
+// replaced passwords appends one record holding just those versions, so the
+// entry records never grow and opening a file does not even decrypt the
+// history. Past MAX_RECORDS the records are merged into one, keeping the
+// last few versions of every entry still in the vault.
+//
+// Record text: one line per version, sorted by entry and then by time, the
+// "website|username" key front-coded against the line before:
+//   <shared key bytes>|<length of the rest>|<rest of the key>|<replaced (unix time)>|<generation>|<password>
+// An empty password marks a deletion: the entry was deleted at that time and
+// its earlier versions are gone, even if a new entry takes the same key.
+class PasswordHistory
+{
+public:
+	struct Version
+	{
+		std::string website;
+		std::string username;
+		int64_t replaced; //when this password stopped being the current one
+		unsigned generation; //cipher generation of password
+		std::string password; //encrypted, empty for a deletion marker
+	};
+
+	static const size_t DEFAULT_KEEP = 10; //versions per entry
+	static const size_t MAX_RECORDS = 32;
+
+	static void sort(std::vector<Version>& versions); //by entry, oldest first; stable
+	static std::string encode(std::vector<Version>& versions); //sorts them first
+	static void decode(const std::string& text, std::vector<Version>& out); //throws std::runtime_error if malformed
+	static void prune(std::vector<Version>& versions, size_t keep); //sorted input, the newest keep of every entry stay
+	static void applyDeletions(std::vector<Version>& versions); //sorted input, drops the markers and every version before one
+};
@@ -1,21 +1,39 @@
 #include "PasswordManager.h"
-#include "CeasarCipher.h"
-#include "TextCodeCipher.h"
-#include "HillCipher.h"
+#include "CipherRegistry.h"
+#include "Rekeyer.h"
+#include "ChaCha20.h"
+#include "SecureRandom.h"
+#include "ThreadPool.h"
+#include "Crc32c.h"
+#include <ctime>
+#include <memory>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 
-PasswordManager::PasswordManager() : fileCipher(nullptr), isFileOpen(false) {}
+PasswordManager::PasswordManager() : fileMode(VaultHeader::BODY_CHUNKED), historyRewrite(false), historyKeep(PasswordHistory::DEFAULT_KEEP), kdfIterations(VaultHeader::DEFAULT_ITERATIONS), fileCipher(nullptr), cipherGeneration(0), isFileOpen(false), output(&std::cout), jobControl(nullptr) {}
 PasswordManager::~PasswordManager()
 {
 	if (isFileOpen)
 	{
-		saveToFile();
+		// a destructor must not throw, the last save is best effort
+		try
+		{
+			saveToFile();
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Could not save " << filename << ": " << e.what() << std::endl;
+		}
 	}
 	delete fileCipher;
 	fileCipher = nullptr;
+	clearLegacyCiphers();
 }
 
 
@@ -49,15 +67,28 @@ void PasswordManager::createFile(const std::string& filename, Cipher* cipher, co
 
 	this->filename = filename;
 	this->masterPassword = masterPassword;
+	dataKey = VaultHeader::newDataKey();
+	header = VaultHeader::seal(dataKey, masterPassword, kdfIterations);
 
 	delete fileCipher; // Ensure any previous cipher is deleted
 	this->fileCipher = cipher;
+	cipherGeneration = 0;
+	clearLegacyCiphers();
 	passwords.clear(); // Start with an empty password list
+	chunks.reset(0);
+	clearHistory();
+	searchIndex.clear();
+	domainIndex.clear();
+	tagIndex.clear();
+	sortedIndex.clear();
 	this->isFileOpen = true;
 	
 	saveToFile();
 
-	std::cout << "File created successfully: " << filename << std::endl;
+	if (output)
+	{
+		*output << "File created successfully: " << filename << '\n';
+	}
 }
 void PasswordManager::openFile(const std::string& filename, const std::string& masterPassword)
 {
@@ -82,16 +113,35 @@ void PasswordManager::openFile(const std::string& filename, const std::string& m
 	try
 	{
 		loadFromFile();
-		std::cout << "File opened successfully: " << filename << std::endl;
+		searchIndex.build(passwords);
+		domainIndex.build(passwords);
+		tagIndex.build(passwords);
+		sortedIndex.build(passwords);
+		if (output)
+		{
+			*output << "File opened successfully: " << filename << '\n';
+		}
 	}
 	catch (const std::exception& e)
 	{
 		isFileOpen = false;
 		this->filename.clear();
 		this->masterPassword.clear();
+		dataKey.clear();
 		delete fileCipher;
 		fileCipher = nullptr;
+		cipherGeneration = 0;
+		clearLegacyCiphers();
 		passwords.clear();
+		clearHistory();
+		searchIndex.clear();
+		domainIndex.clear();
+		tagIndex.clear();
+		sortedIndex.clear();
+		if (jobControl && jobControl->isCancelRequested())
+		{
+			throw OperationCancelled();
+		}
 		throw std::runtime_error("Failed to open file: " + std::string(e.what()));
 	}
 }
@@ -106,6 +156,10 @@ void PasswordManager::addPassword(const std::string& website, const std::string&
 	{
 		throw std::invalid_argument("Website, username, and password cannot be empty.");
 	}
+	if (website.find_first_of("|\n") != std::string::npos || username.find_first_of("|\n") != std::string::npos)
+	{
+		throw std::invalid_argument("Website and username cannot contain '|' or line breaks.");
+	}
 	if (findPassword(website, username) != nullptr)
 	{
 		throw std::runtime_error("Password for this website and username already exists.");
@@ -120,11 +174,23 @@ void PasswordManager::addPassword(const std::string& website, const std::string&
 	{
 		throw;
 	}
+	if (encryptedPassword.find('\n') != std::string::npos)
+	{
+		throw std::invalid_argument("Passwords cannot contain line breaks.");
+	}
 
-	PasswordEntry newEntry(website, username, encryptedPassword);
+	PasswordEntry newEntry(website, username, encryptedPassword, cipherGeneration);
 	passwords.push_back(newEntry);
+	chunks.append();
+	searchIndex.append(newEntry);
+	domainIndex.add(website);
+	tagIndex.append(newEntry);
+	sortedIndex.append(newEntry);
 	saveToFile();
-	std::cout << "Password added for website: " << website << "(user: " << username << ")" << std::endl;
+	if (output)
+	{
+		*output << "Password added for website: " << website << "(user: " << username << ")" << '\n';
+	}
 }
 PasswordEntry* PasswordManager::findPassword(const std::string& website, const std::string& username)
 {
@@ -136,13 +202,32 @@ PasswordEntry* PasswordManager::findPassword(const std::string& website, const s
 	{
 		throw std::invalid_argument("Website and username cannot be empty.");
 	}
-	for (auto& entry : passwords)
+	return const_cast<PasswordEntry*>(locatePassword(website, username));
+}
+const PasswordEntry* PasswordManager::locatePassword(const std::string& website, const std::string& username) const
+{
+	for (const auto& entry : passwords)
 	{
 		if (entry.getWebsite() == website && entry.getUsername() == username)
 		{
 			return &entry;
 		}
 	}
+	if (DomainIndex::isPattern(website))
+	{
+		return nullptr; // a pattern names many hosts, never one entry
+	}
+
+	std::vector<std::string> matched = domainIndex.match(website);
+	std::unordered_set<std::string> websites(matched.begin(), matched.end());
+	websites.erase(website);
+	for (size_t i = 0; i < passwords.size() && !websites.empty(); ++i)
+	{
+		if (passwords[i].getUsername() == username && websites.count(passwords[i].getWebsite()))
+		{
+			return &passwords[i];
+		}
+	}
 	return nullptr;
 }
 std::vector<PasswordEntry*> PasswordManager::findPasswordsByWebsite(const std::string& website)
@@ -155,10 +240,12 @@ std::vector<PasswordEntry*> PasswordManager::findPasswordsByWebsite(const std::s
 	{
 		throw std::invalid_argument("Website cannot be empty.");
 	}
+	std::vector<std::string> matched = domainIndex.match(website);
+	std::unordered_set<std::string> websites(matched.begin(), matched.end());
 	std::vector<PasswordEntry*> results;
 	for (auto& entry : passwords)
 	{
-		if (entry.getWebsite() == website)
+		if (!websites.empty() && websites.count(entry.getWebsite()))
 		{
 			results.push_back(&entry);
 		}
@@ -181,8 +268,7 @@ bool PasswordManager::updatePassword(const std::string& website, const std::stri
 		return false;
 	}
 
-	std::string encryptedOldPassword = entry->getPassword();
-	std::string decryptedOldPassword = fileCipher->decrypt(encryptedOldPassword);
+	std::string decryptedOldPassword = decryptPassword(*entry);
 
 	if (decryptedOldPassword == newPassword)
 	{
@@ -191,323 +277,1593 @@ bool PasswordManager::updatePassword(const std::string& website, const std::stri
 
 	//Encrypt the new password before setting it
 	std::string encryptedNewPassword = fileCipher->encrypt(newPassword);
+	if (encryptedNewPassword.find('\n') != std::string::npos)
+	{
+		throw std::invalid_argument("Passwords cannot contain line breaks.");
+	}
+	recordHistory(*entry);
 	entry->setPassword(encryptedNewPassword);
+	entry->setGeneration(cipherGeneration); // an update also finishes a pending migration
+	chunks.touch(static_cast<size_t>(entry - passwords.data()));
 
 	saveToFile();
-	std::cout << "Password updated for website: " << website << " (user: " << username << ")" << std::endl;
+	if (output)
+	{
+		*output << "Password updated for website: " << website << " (user: " << username << ")" << '\n';
+	}
 	return true;
 }
-bool PasswordManager::deletePassword(const std::string& website, const std::string& username)
+void PasswordManager::recordHistory(const PasswordEntry& entry)
 {
-	if (!isFileOpen)
+	if (fileMode != VaultHeader::BODY_CHUNKED || historyKeep == 0)
 	{
-		throw std::runtime_error("No file is open.");
+		return; // only chunked files have a history segment
 	}
-	if (website.empty() || username.empty())
+	pendingHistory.push_back(PasswordHistory::Version{ entry.getWebsite(), entry.getUsername(), static_cast<int64_t>(std::time(nullptr)),
+		entry.getGeneration(), entry.getPassword() });
+	auto position = std::lower_bound(historyGenerations.begin(), historyGenerations.end(), entry.getGeneration());
+	if (position == historyGenerations.end() || *position != entry.getGeneration())
 	{
-		throw std::invalid_argument("Website and username cannot be empty.");
+		historyGenerations.insert(position, entry.getGeneration());
 	}
+}
 
-	for (auto it = passwords.begin(); it != passwords.end(); ++it)
+std::vector<PasswordHistory::Version> PasswordManager::readHistory() const
+{
+	std::vector<PasswordHistory::Version> versions;
+	if (!historyRewrite && !historyRecords.empty())
 	{
-		if (it->getWebsite() == website && it->getUsername() == username)
+		std::ifstream file(filename.c_str(), std::ios::binary);
+		std::string record;
+		for (const VaultChunks::Chunk& chunk : historyRecords)
 		{
-			passwords.erase(it);
-			saveToFile();
-			std::cout << "Password deleted for website: " << website << "(user: " << username << ")" << std::endl;
-			return true;
+			record.resize(chunk.recordSize);
+			file.seekg(static_cast<std::streamoff>(chunk.fileOffset));
+			file.read(&record[0], record.size());
+			if (!file || VaultChunks::recordTag(record.data()) != chunk.tag)
+			{
+				throw std::runtime_error("File was changed on disk since it was opened: " + filename);
+			}
+			size_t before = versions.size();
+			PasswordHistory::decode(VaultChunks::open(dataKey, VaultChunks::HISTORY, record.data(), record.size()), versions);
+			if (versions.size() - before != chunk.entries)
+			{
+				throw std::runtime_error("History record holds a different number of versions than listed");
+			}
 		}
 	}
-	return false;
+	versions.insert(versions.end(), pendingHistory.begin(), pendingHistory.end());
+	PasswordHistory::sort(versions);
+	PasswordHistory::applyDeletions(versions);
+	return versions;
 }
-int PasswordManager::deletePasswordsByWebsite(const std::string& website)
+
+void PasswordManager::forgetHistory(const std::vector<size_t>& positions)
 {
-	if (!isFileOpen)
+	if (positions.empty() || (historyRecords.empty() && pendingHistory.empty()))
 	{
-		throw std::runtime_error("No file is open.");
+		return;
 	}
-	if (website.empty())
+
+	std::unordered_set<std::string> deleted;
+	for (size_t position : positions)
 	{
-		throw std::invalid_argument("Website cannot be empty.");
+		deleted.insert(passwords[position].getWebsite() + '\n' + passwords[position].getUsername());
+	}
+	pendingHistory.erase(std::remove_if(pendingHistory.begin(), pendingHistory.end(), [&deleted](const PasswordHistory::Version& version)
+	{
+		return deleted.count(version.website + '\n' + version.username) != 0;
+	}), pendingHistory.end());
+	if (historyRewrite || historyRecords.empty())
+	{
+		return; // nothing on disk survives the next save
 	}
-	int deletedCount = 0;
-	auto it = passwords.begin();
 
-	while (it != passwords.end())
+	// versions already on disk stay hidden behind a marker until the next merge drops them
+	int64_t now = static_cast<int64_t>(std::time(nullptr));
+	for (size_t position : positions)
 	{
-		if (it->getWebsite() == website)
-		{
-			it = passwords.erase(it);
-			deletedCount++;
-		}
-		else
+		pendingHistory.push_back(PasswordHistory::Version{ passwords[position].getWebsite(), passwords[position].getUsername(), now, 0, "" });
+	}
+}
+
+void PasswordManager::clearHistory()
+{
+	historyRecords.clear();
+	pendingHistory.clear();
+	historyRewrite = false;
+	historyGenerations.clear();
+	historyKeep = PasswordHistory::DEFAULT_KEEP;
+}
+
+std::vector<PasswordHistory::Version> PasswordManager::getHistory(const std::string& website, const std::string& username) const
+{
+	if (!isFileOpen)
+	{
+		throw std::runtime_error("No password file is currently open");
+	}
+
+	// versions are kept under the stored spelling of the entry's website
+	const PasswordEntry* entry = locatePassword(website, username);
+	const std::string& storedWebsite = entry ? entry->getWebsite() : website;
+
+	std::vector<PasswordHistory::Version> versions;
+	for (PasswordHistory::Version& version : readHistory())
+	{
+		if (version.website == storedWebsite && version.username == username)
 		{
-			++it;
+			versions.push_back(std::move(version));
 		}
 	}
+	std::reverse(versions.begin(), versions.end());
+	versions.resize(std::min(versions.size(), historyKeep));
+	return versions;
+}
 
-	if (deletedCount > 0)
+void PasswordManager::revertPassword(const std::string& website, const std::string& username, size_t version)
+{
+	if (findPassword(website, username) == nullptr)
 	{
-		saveToFile();
-		std::cout << "Deleted " << deletedCount << " entries for website: " << website << std::endl;
+		throw std::runtime_error("Password not found for " + username + "@" + website + ".");
+	}
+	std::vector<PasswordHistory::Version> versions = getHistory(website, username);
+	if (version == 0 || version > versions.size())
+	{
+		throw std::invalid_argument("No version " + std::to_string(version) + " in the history of " + username + "@" + website
+			+ " (" + std::to_string(versions.size()) + " kept).");
 	}
 
-	return deletedCount;
+	// stored again with the current cipher; the password it replaces goes to the history like any update
+	const PasswordHistory::Version& chosen = versions[version - 1];
+	updatePassword(website, username, getCipherFor(chosen.generation)->decrypt(chosen.password));
 }
 
-bool PasswordManager::isOpen() const
+void PasswordManager::setHistoryKeep(size_t keep)
 {
-	return isFileOpen;
+	if (!isFileOpen)
+	{
+		throw std::runtime_error("No file is open.");
+	}
+	if (keep < historyKeep && (!historyRecords.empty() || !pendingHistory.empty()))
+	{
+		pendingHistory = readHistory(); // merged and cut to the new limit by the save
+		historyRewrite = true;
+	}
+	historyKeep = keep;
+	saveToFile();
 }
 
-std::vector<PasswordEntry> PasswordManager::loadAllUsers(const std::string& website) const
+bool PasswordManager::deletePassword(const std::string& website, const std::string& username)
 {
-	if (!isFileOpen) 
+	if (!isFileOpen)
 	{
-		throw std::runtime_error("No password file is currently open");
+		throw std::runtime_error("No file is open.");
 	}
-
-	if (website.empty()) 
+	if (website.empty() || username.empty())
 	{
-		throw std::invalid_argument("Website cannot be empty");
+		throw std::invalid_argument("Website and username cannot be empty.");
 	}
 
-	std::vector<PasswordEntry> userEntries;
-	userEntries.reserve(passwords.size());
-
-	for (const auto& entry : passwords) 
+	PasswordEntry* entry = findPassword(website, username);
+	if (!entry)
 	{
-		if (entry.getWebsite() == website) 
-		{
-			userEntries.push_back(entry);
-		}
+		return false;
 	}
 
-	return userEntries;
+	size_t position = static_cast<size_t>(entry - passwords.data());
+	std::string storedWebsite = entry->getWebsite(); //the spelling the indexes know
+	forgetHistory({ position });
+	chunks.remove(position);
+	searchIndex.remove(position);
+	domainIndex.remove(storedWebsite);
+	tagIndex.remove(position, *entry);
+	sortedIndex.remove(position);
+	passwords.erase(passwords.begin() + static_cast<std::ptrdiff_t>(position));
+	saveToFile();
+	if (output)
+	{
+		*output << "Password deleted for website: " << storedWebsite << "(user: " << username << ")" << '\n';
+	}
+	return true;
 }
-
-//helper functions
-int stringToInt(const std::string& str)
+int PasswordManager::deletePasswordsByWebsite(const std::string& website, const std::string& username)
 {
-	int result = 0;
-	bool negative = false;
-	size_t i = 0;
+	if (!isFileOpen)
+	{
+		throw std::runtime_error("No file is open.");
+	}
+	if (website.empty())
+	{
+		throw std::invalid_argument("Website cannot be empty.");
+	}
 
-	if (str[0] == '-')
+	std::vector<std::string> matched = domainIndex.match(website);
+	std::unordered_set<std::string> websites(matched.begin(), matched.end());
+	std::vector<size_t> removed;
+	for (size_t i = 0; i < passwords.size() && !websites.empty(); ++i)
 	{
-		negative = true;
-		i = 1;
+		if (websites.count(passwords[i].getWebsite()) && (username.empty() || passwords[i].getUsername() == username))
+		{
+			removed.push_back(i);
+		}
 	}
 
-	for (; i < str.length(); ++i)
+	// the history, the layout and the indexes first, highest position first as if erased one by one
+	forgetHistory(removed);
+	for (size_t i = removed.size(); i-- > 0;)
 	{
-		if (str[i] >= '0' && str[i] <= '9')
+		chunks.remove(removed[i]);
+		domainIndex.remove(passwords[removed[i]].getWebsite());
+	}
+	searchIndex.remove(removed);
+	tagIndex.remove(removed, passwords);
+	sortedIndex.remove(removed);
+
+	// then the entries in one pass instead of one erase each
+	size_t next = 0;
+	size_t kept = 0;
+	for (size_t i = 0; i < passwords.size(); ++i)
+	{
+		if (next < removed.size() && removed[next] == i)
 		{
-			result = result * 10 + (str[i] - '0');
+			++next;
 		}
 		else
 		{
-			throw std::invalid_argument("Invalid integer string");
+			if (kept != i)
+			{
+				passwords[kept] = std::move(passwords[i]);
+			}
+			++kept;
 		}
 	}
+	passwords.erase(passwords.begin() + kept, passwords.end());
+	int deletedCount = static_cast<int>(removed.size());
 
-	return negative ? -result : result;
+	if (deletedCount > 0)
+	{
+		saveToFile();
+		if (output)
+		{
+			*output << "Deleted " << deletedCount << " entries for website: " << website << '\n';
+		}
+	}
+
+	return deletedCount;
 }
-std::string intToString(int value)
+
+size_t PasswordManager::tagEntries(const std::string& website, const std::string& username, const std::vector<std::string>& tags,
+	const std::vector<std::pair<std::string, std::string>>& fields, bool removing, size_t& matched)
 {
-	if (value == 0) return "0";
+	if (!isFileOpen)
+	{
+		throw std::runtime_error("No file is open.");
+	}
+	if (website.empty() || username.empty())
+	{
+		throw std::invalid_argument("Website and username cannot be empty.");
+	}
 
-	std::string result;
-	bool negative = false;
+	std::vector<std::string> websites = domainIndex.match(website);
+	std::unordered_set<std::string> wanted(websites.begin(), websites.end());
+	size_t changed = 0;
+	matched = 0;
+	for (size_t i = 0; i < passwords.size() && !wanted.empty(); ++i)
+	{
+		PasswordEntry& entry = passwords[i];
+		if (!wanted.count(entry.getWebsite()) || (username != "*" && entry.getUsername() != username))
+		{
+			continue;
+		}
+		++matched;
 
-	if (value < 0)
+		PasswordEntry before = entry;
+		bool modified = false;
+		for (const std::string& tag : tags)
+		{
+			modified |= removing ? entry.removeTag(tag) : entry.addTag(tag);
+		}
+		for (const auto& field : fields)
+		{
+			modified |= removing ? entry.removeField(field.first) : entry.setField(field.first, field.second);
+		}
+		if (modified)
+		{
+			tagIndex.update(i, before, entry);
+			chunks.touch(i);
+			++changed;
+		}
+	}
+
+	if (changed > 0)
 	{
-		negative = true;
-		value = -value;
+		saveToFile();
 	}
+	return changed;
+}
 
-	while (value > 0)
+PasswordManager::MergeResult PasswordManager::mergeEntries(std::vector<PasswordEntry>& entries, bool overwriteExisting)
+{
+	if (!isFileOpen)
 	{
-		result = char('0' + (value % 10)) + result;
-		value /= 10;
+		throw std::runtime_error("No file is open.");
 	}
 
-	if (negative)
+	// one hash lookup per entry instead of a findPassword scan
+	std::unordered_map<std::string, size_t> positions;
+	positions.reserve(passwords.size() + entries.size());
+	for (size_t i = 0; i < passwords.size(); ++i)
 	{
-		result = "-" + result;
+		positions.emplace(passwords[i].getWebsite() + '\n' + passwords[i].getUsername(), i);
 	}
 
-	return result;
-}
-std::vector<std::string> splitString(const std::string& str, char delimiter)
-{
-	std::vector<std::string> result;
-	std::string current;
+	MergeResult result = { 0, 0, 0 };
+	passwords.reserve(passwords.size() + entries.size());
 
-	for (char c : str)
+	for (PasswordEntry& entry : entries)
 	{
-		if (c == delimiter)
+		// imported passwords were encrypted with the current cipher
+		auto inserted = positions.emplace(entry.getWebsite() + '\n' + entry.getUsername(), passwords.size());
+		if (inserted.second)
 		{
-			if (!current.empty())
-			{
-				result.push_back(current);
-				current.clear();
-			}
+			entry.setGeneration(cipherGeneration);
+			passwords.push_back(std::move(entry));
+			chunks.append();
+			searchIndex.append(passwords.back());
+			domainIndex.add(passwords.back().getWebsite());
+			tagIndex.append(passwords.back());
+			sortedIndex.append(passwords.back());
+			++result.added;
+		}
+		else if (overwriteExisting)
+		{
+			recordHistory(passwords[inserted.first->second]);
+			passwords[inserted.first->second].setPassword(entry.getPassword());
+			passwords[inserted.first->second].setGeneration(cipherGeneration);
+			chunks.touch(inserted.first->second);
+			++result.overwritten;
 		}
 		else
 		{
-			current += c;
+			++result.skipped;
 		}
 	}
+	entries.clear();
 
-	if (!current.empty())
+	if (result.added > 0 || result.overwritten > 0)
 	{
-		result.push_back(current);
-	}
-
-	return result;
-}
-std::string simpleEncryptDecrypt(const std::string& text, const std::string& key) {
-	std::string result = text;
-	for (size_t i = 0; i < result.length(); ++i) {
-		result[i] ^= key[i % key.length()];
+		saveToFile();
 	}
 	return result;
 }
 
-
-void PasswordManager::saveToFile() const 
+void PasswordManager::replaceCipher(const Cipher& cipher, std::vector<std::string>& encryptedPasswords)
 {
 	if (!isFileOpen)
 	{
 		throw std::runtime_error("No file is open.");
 	}
+	if (encryptedPasswords.size() != passwords.size())
+	{
+		throw std::invalid_argument("Re-encrypted passwords do not match the open file.");
+	}
 
-	// Create content to save
-	std::string content = "CIPHER_TYPE:" + fileCipher->getType() + "\n";
-	content += "CIPHER_CONFIG:" + fileCipher->getConfig() + "\n";
-	content += "ENTRIES:\n";
-
-	for (const auto& entry : passwords) 
+	// the history moves to the new cipher too, so no old cipher has to stay; a version it cannot hold is dropped
+	std::vector<PasswordHistory::Version> oldPending = pendingHistory;
+	bool oldRewrite = historyRewrite;
+	std::vector<unsigned> oldHistoryGenerations = historyGenerations;
+	if (!historyRecords.empty() || !pendingHistory.empty())
 	{
-		content += entry.getWebsite() + "|" + entry.getUsername() + "|" + entry.getPassword() + "\n";
+		std::vector<PasswordHistory::Version> versions = readHistory();
+		std::unique_ptr<Cipher> target(cipher.clone());
+		size_t kept = 0;
+		for (size_t i = 0; i < versions.size(); ++i)
+		{
+			std::string encrypted;
+			try
+			{
+				if (!Rekeyer::encryptLossless(*target, getCipherFor(versions[i].generation)->decrypt(versions[i].password), encrypted))
+				{
+					continue;
+				}
+			}
+			catch (const std::exception&)
+			{
+				continue;
+			}
+			versions[i].password = encrypted;
+			versions[i].generation = cipherGeneration + 1;
+			if (kept != i)
+			{
+				versions[kept] = std::move(versions[i]);
+			}
+			++kept;
+		}
+		versions.resize(kept);
+		pendingHistory.swap(versions);
+		historyRewrite = true;
+		historyGenerations.assign(pendingHistory.empty() ? 0 : 1, cipherGeneration + 1);
 	}
 
-	// Encrypt content using simple XOR with master password
-	std::string encryptedContent = simpleEncryptDecrypt(content, masterPassword);
+	// swap in place so a failed save can put everything back
+	Cipher* oldCipher = fileCipher;
+	unsigned oldGeneration = cipherGeneration;
+	std::vector<Cipher*> oldLegacyCiphers;
+	oldLegacyCiphers.swap(legacyCiphers); // every entry moves to the new cipher, none of them is needed any more
+	std::vector<unsigned> oldGenerations(passwords.size());
 
-	// Write to file
-	std::ofstream file(filename.c_str());
-	if (!file.is_open()) 
+	fileCipher = cipher.clone();
+	cipherGeneration = oldGeneration + 1;
+	for (size_t i = 0; i < passwords.size(); ++i)
 	{
-		throw std::runtime_error("Cannot write to file: " + filename);
+		std::string previous = passwords[i].getPassword();
+		passwords[i].setPassword(encryptedPasswords[i]);
+		encryptedPasswords[i].swap(previous);
+		oldGenerations[i] = passwords[i].getGeneration();
+		passwords[i].setGeneration(cipherGeneration);
 	}
+	chunks.touchAll();
 
-	file << encryptedContent;
-	file.close();
-}
-
-// Helper function to parse Hill cipher 
-std::string parseHillMatrixString(const std::string& config)
-{
-	size_t matrixPos = config.find("Key matrix: ");
-	if (matrixPos == std::string::npos)
+	try
+	{
+		saveToFile();
+	}
+	catch (...)
 	{
-		throw std::runtime_error("Invalid Hill cipher config format");
+		for (size_t i = 0; i < passwords.size(); ++i)
+		{
+			passwords[i].setPassword(encryptedPasswords[i]);
+			passwords[i].setGeneration(oldGenerations[i]);
+		}
+		delete fileCipher;
+		fileCipher = oldCipher;
+		cipherGeneration = oldGeneration;
+		legacyCiphers.swap(oldLegacyCiphers);
+		pendingHistory.swap(oldPending);
+		historyRewrite = oldRewrite;
+		historyGenerations.swap(oldHistoryGenerations);
+		throw;
 	}
 
-	return config.substr(matrixPos + 12); // 12 is Length of "Key matrix: "
+	delete oldCipher;
+	for (Cipher* legacy : oldLegacyCiphers)
+	{
+		delete legacy;
+	}
+	encryptedPasswords.clear();
 }
-int parseHillMatrixSize(const std::string& config)
+
+void PasswordManager::startMigration(const Cipher& cipher)
 {
-	size_t sizePos = config.find("Matrix size: ");
-	if (sizePos == std::string::npos)
+	if (!isFileOpen)
 	{
-		throw std::runtime_error("Invalid Hill cipher config format");
+		throw std::runtime_error("No file is open.");
 	}
 
-	size_t startPos = sizePos + 13; // Length of "Matrix size: "
-	size_t endPos = config.find(",", startPos);
-	if (endPos == std::string::npos)
+	// nothing is re-encrypted here, the current cipher just becomes a legacy one
+	if (legacyCiphers.size() <= cipherGeneration)
 	{
-		throw std::runtime_error("Invalid Hill cipher config format");
+		legacyCiphers.resize(cipherGeneration + 1, nullptr);
 	}
+	legacyCiphers[cipherGeneration] = fileCipher;
+	fileCipher = cipher.clone();
+	++cipherGeneration;
 
-	std::string sizeStr = config.substr(startPos, endPos - startPos);
-	return stringToInt(sizeStr);
+	try
+	{
+		saveToFile();
+	}
+	catch (...)
+	{
+		delete fileCipher;
+		--cipherGeneration;
+		fileCipher = legacyCiphers[cipherGeneration];
+		legacyCiphers[cipherGeneration] = nullptr;
+		throw;
+	}
+	retireUnusedCiphers(); // e.g. an empty vault
 }
 
-std::vector<std::vector<int>> parseHillMatrix(const std::string& matrixStr, int matrixSize) {
-	std::vector<std::vector<int>> matrix(matrixSize, std::vector<int>(matrixSize));
-
-	// Parse format "1 2; 3 4" or "1 2 3; 4 5 6; 7 8 9"
-	std::vector<std::string> rows = splitString(matrixStr, ';');
-	if (rows.size() != matrixSize) {
-		throw std::runtime_error("Invalid matrix format: incorrect number of rows");
+bool PasswordManager::migrateEntry(PasswordEntry& entry)
+{
+	if (entry.getGeneration() == cipherGeneration)
+	{
+		return true;
 	}
 
-	for (int i = 0; i < matrixSize; i++) {
-		std::string rowStr = rows[i];
-		// Trim whitespace
-		size_t start = rowStr.find_first_not_of(" \t");
-		size_t end = rowStr.find_last_not_of(" \t");
-		if (start != std::string::npos && end != std::string::npos) {
-			rowStr = rowStr.substr(start, end - start + 1);
-		}
-
-		std::vector<std::string> elements = splitString(rowStr, ' ');
-		if (elements.size() != matrixSize) {
-			throw std::runtime_error("Invalid matrix format: incorrect number of columns in row " + std::to_string(i));
-		}
-
-		for (int j = 0; j < matrixSize; j++) {
-			matrix[i][j] = stringToInt(elements[j]);
-		}
+	std::string encrypted;
+	if (!Rekeyer::encryptLossless(*fileCipher, decryptPassword(entry), encrypted))
+	{
+		return false; // stays on its old cipher, see countEntriesByGeneration
 	}
-
-	return matrix;
+	entry.setPassword(encrypted);
+	entry.setGeneration(cipherGeneration);
+	return true;
 }
 
-
-void PasswordManager::loadFromFile()
+size_t PasswordManager::migrateEntries(const std::vector<EntryKey>& keys)
 {
-	std::ifstream file(filename.c_str());
-	if (!file.is_open())
+	if (!isFileOpen)
 	{
-		throw std::runtime_error("Cannot open file: " + filename);
+		throw std::runtime_error("No file is open.");
 	}
 
-	// Read encrypted content
-	std::string encryptedContent;
-	std::string line;
-	while (std::getline(file, line))
+	std::unordered_set<std::string> wanted;
+	for (const EntryKey& key : keys)
 	{
-		encryptedContent += line + "\n";
+		wanted.insert(key.first + '\n' + key.second);
 	}
-	file.close();
 
-	if (encryptedContent.empty())
+	size_t migrated = 0;
+	for (size_t i = 0; i < passwords.size(); ++i)
 	{
-		throw std::runtime_error("File is empty or corrupted: " + filename);
+		PasswordEntry& entry = passwords[i];
+		if (entry.getGeneration() != cipherGeneration && wanted.count(entry.getWebsite() + '\n' + entry.getUsername()) > 0
+			&& migrateEntry(entry))
+		{
+			chunks.touch(i);
+			++migrated;
+		}
+	}
+
+	if (migrated > 0)
+	{
+		retireUnusedCiphers();
+		saveToFile();
+	}
+	return migrated;
+}
+
+std::vector<size_t> PasswordManager::countEntriesByGeneration() const
+{
+	std::vector<size_t> counts(std::max<size_t>(legacyCiphers.size(), cipherGeneration + 1), 0);
+	for (const PasswordEntry& entry : passwords)
+	{
+		if (entry.getGeneration() < counts.size())
+		{
+			++counts[entry.getGeneration()];
+		}
+	}
+	return counts;
+}
+
+void PasswordManager::retireUnusedCiphers()
+{
+	std::vector<size_t> counts = countEntriesByGeneration();
+	for (size_t generation = 0; generation < legacyCiphers.size(); ++generation)
+	{
+		if (legacyCiphers[generation] != nullptr && counts[generation] == 0
+			&& !std::binary_search(historyGenerations.begin(), historyGenerations.end(), static_cast<unsigned>(generation)))
+		{
+			delete legacyCiphers[generation];
+			legacyCiphers[generation] = nullptr;
+		}
+	}
+	while (!legacyCiphers.empty() && legacyCiphers.back() == nullptr)
+	{
+		legacyCiphers.pop_back();
+	}
+}
+
+void PasswordManager::clearLegacyCiphers()
+{
+	for (Cipher* legacy : legacyCiphers)
+	{
+		delete legacy;
+	}
+	legacyCiphers.clear();
+}
+
+Cipher* PasswordManager::getCipherFor(unsigned generation) const
+{
+	if (generation == cipherGeneration)
+	{
+		return fileCipher;
+	}
+	if (generation < legacyCiphers.size() && legacyCiphers[generation] != nullptr)
+	{
+		return legacyCiphers[generation];
+	}
+	throw std::runtime_error("No cipher for generation " + std::to_string(generation) + ".");
+}
+
+std::vector<const Cipher*> PasswordManager::getCipherGenerations() const
+{
+	std::vector<const Cipher*> ciphers(legacyCiphers.begin(), legacyCiphers.end());
+	if (ciphers.size() <= cipherGeneration)
+	{
+		ciphers.resize(cipherGeneration + 1, nullptr);
+	}
+	ciphers[cipherGeneration] = fileCipher;
+	return ciphers;
+}
+
+std::string PasswordManager::decryptPassword(const PasswordEntry& entry) const
+{
+	return getCipherFor(entry.getGeneration())->decrypt(entry.getPassword());
+}
+
+void PasswordManager::changeMasterPassword(const std::string& currentPassword, const std::string& newPassword)
+{
+	if (!isFileOpen)
+	{
+		throw std::runtime_error("No file is open.");
+	}
+	if (currentPassword != masterPassword)
+	{
+		throw std::runtime_error("Current master password is incorrect.");
+	}
+	if (newPassword.empty())
+	{
+		throw std::invalid_argument("Master password cannot be empty.");
+	}
+
+	storeHeader(VaultHeader::seal(dataKey, newPassword, kdfIterations));
+	masterPassword = newPassword;
+}
+
+void PasswordManager::changeKdfCost(uint32_t iterations)
+{
+	if (!isFileOpen)
+	{
+		throw std::runtime_error("No file is open.");
+	}
+
+	uint32_t oldIterations = kdfIterations;
+	kdfIterations = iterations;
+	try
+	{
+		storeHeader(VaultHeader::seal(dataKey, masterPassword, iterations));
+	}
+	catch (...)
+	{
+		kdfIterations = oldIterations;
+		throw;
+	}
+}
+
+void PasswordManager::storeHeader(const VaultHeader& newHeader)
+{
+	VaultHeader oldHeader = header;
+	header = newHeader;
+	header.setBody(oldHeader.getBodyMode(), oldHeader.getBodyNonce()); // the body on disk does not change
+	header.setTrailer(oldHeader.hasTrailer());
+
+	try
+	{
+		// the body stays as it is, only the wrapped key in front of it changes
+		std::fstream file(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		char magic[VaultHeader::MAGIC_SIZE];
+		if (file.is_open() && file.read(magic, sizeof(magic)) && VaultHeader::sizeFromMagic(magic) == VaultHeader::SIZE)
+		{
+			std::string headerBytes = header.serialize();
+			file.seekp(0, std::ios::beg);
+			file.write(headerBytes.data(), headerBytes.size());
+			file.flush();
+			if (!file)
+			{
+				throw std::runtime_error("Cannot write to file: " + filename);
+			}
+		}
+		else
+		{
+			saveToFile(); // still in an older format, convert it now
+		}
+	}
+	catch (...)
+	{
+		header = oldHeader;
+		throw;
+	}
+}
+
+bool PasswordManager::isOpen() const
+{
+	return isFileOpen;
+}
+
+std::vector<PasswordEntry> PasswordManager::loadAllUsers(const std::string& website) const
+{
+	if (!isFileOpen) 
+	{
+		throw std::runtime_error("No password file is currently open");
+	}
+
+	if (website.empty()) 
+	{
+		throw std::invalid_argument("Website cannot be empty");
+	}
+
+	// every stored spelling of the host, or of all hosts under a pattern, in one pass
+	std::vector<std::string> matched = domainIndex.match(website);
+	std::unordered_set<std::string> websites(matched.begin(), matched.end());
+	std::vector<PasswordEntry> userEntries;
+
+	for (const auto& entry : passwords) 
+	{
+		if (!websites.empty() && websites.count(entry.getWebsite())) 
+		{
+			userEntries.push_back(entry);
+		}
+	}
+
+	return userEntries;
+}
+
+std::vector<std::string> PasswordManager::suggestWebsites(const std::string& website, size_t limit) const
+{
+	std::vector<std::string> suggestions;
+	for (const BkTree::Match& match : domainIndex.suggest(website, limit))
+	{
+		suggestions.push_back(match.key);
+	}
+	return suggestions;
+}
+
+std::vector<SearchIndex::Match> PasswordManager::search(const std::string& text, size_t limit, size_t& total) const
+{
+	if (!isFileOpen)
+	{
+		throw std::runtime_error("No password file is currently open");
+	}
+	return searchIndex.search(text, limit, total);
+}
+
+std::vector<const PasswordEntry*> PasswordManager::listEntries(const ListQuery& query, std::string& next) const
+{
+	if (!isFileOpen)
+	{
+		throw std::runtime_error("No password file is currently open");
+	}
+
+	// cursors read "website|username" or, in username order, "username|website"; neither part holds a '|'
+	std::string after;
+	if (!query.after.empty())
+	{
+		size_t bar = query.after.find('|');
+		if (bar == std::string::npos)
+		{
+			throw std::invalid_argument("Invalid list cursor: " + query.after);
+		}
+		std::string first = query.after.substr(0, bar);
+		std::string second = query.after.substr(bar + 1);
+		after = query.order == SortedIndex::BY_WEBSITE ? SortedIndex::keyOf(first, second) : SortedIndex::keyOf(second, first);
+	}
+
+	std::vector<size_t> allowed;
+	bool filtered = !query.tags.empty() || !query.fields.empty();
+	if (filtered)
+	{
+		std::vector<std::string> terms;
+		for (const std::string& tag : query.tags)
+		{
+			terms.push_back(TagIndex::tagTerm(tag));
+		}
+		for (const auto& field : query.fields)
+		{
+			terms.push_back(TagIndex::fieldTerm(field.first, field.second));
+		}
+		allowed = tagIndex.find(terms);
+	}
+
+	bool more = false;
+	std::vector<const PasswordEntry*> entries;
+	for (size_t position : sortedIndex.page(query.order, query.sitePrefix, after, query.limit, filtered ? &allowed : nullptr, more))
+	{
+		entries.push_back(&passwords[position]);
+	}
+
+	next.clear();
+	if (more && !entries.empty())
+	{
+		const PasswordEntry& last = *entries.back();
+		next = query.order == SortedIndex::BY_WEBSITE ? last.getWebsite() + "|" + last.getUsername() : last.getUsername() + "|" + last.getWebsite();
+	}
+	return entries;
+}
+
+//helper functions
+int stringToInt(const std::string& str)
+{
+	int result = 0;
+	bool negative = false;
+	size_t i = 0;
+
+	if (str[0] == '-')
+	{
+		negative = true;
+		i = 1;
+	}
+
+	for (; i < str.length(); ++i)
+	{
+		if (str[i] >= '0' && str[i] <= '9')
+		{
+			result = result * 10 + (str[i] - '0');
+		}
+		else
+		{
+			throw std::invalid_argument("Invalid integer string");
+		}
+	}
+
+	return negative ? -result : result;
+}
+std::string intToString(int value)
+{
+	if (value == 0) return "0";
+
+	std::string result;
+	bool negative = false;
+
+	if (value < 0)
+	{
+		negative = true;
+		value = -value;
+	}
+
+	while (value > 0)
+	{
+		result = char('0' + (value % 10)) + result;
+		value /= 10;
+	}
+
+	if (negative)
+	{
+		result = "-" + result;
+	}
+
+	return result;
+}
+void appendRecordChecksum(std::string& out, size_t lineStart)
+{
+	static const char digits[] = "0123456789abcdef";
+	uint32_t checksum = Crc32c::compute(out.data() + lineStart, out.size() - lineStart);
+	out += "|#";
+	for (int shift = 28; shift >= 0; shift -= 4)
+	{
+		out.push_back(digits[(checksum >> shift) & 0xf]);
+	}
+}
+
+bool checkRecord(const std::string& line, size_t& fieldsLength)
+{
+	const size_t SUFFIX_SIZE = 10; // "|#" and 8 hex digits
+	if (line.size() < SUFFIX_SIZE || line[line.size() - SUFFIX_SIZE] != '|' || line[line.size() - SUFFIX_SIZE + 1] != '#')
+	{
+		return false;
+	}
+
+	fieldsLength = line.size() - SUFFIX_SIZE;
+	uint32_t stored = 0;
+	for (size_t i = fieldsLength + 2; i < line.size(); ++i)
+	{
+		char c = line[i];
+		int digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+		if (digit < 0)
+		{
+			return false;
+		}
+		stored = (stored << 4) | static_cast<uint32_t>(digit);
+	}
+	return Crc32c::compute(line.data(), fieldsLength) == stored;
+}
+
+bool splitEntryFields(const std::string& fields, std::vector<std::string>& parts)
+{
+	// Website and username never hold '|', a password may. The generation is
+	// written for entries that were not migrated yet and for every password
+	// holding a '|', so a '|' after the username always starts the generation.
+	// Entries with tags or fields always have the generation too, followed by
+	// the '&' attributes, which never hold a '|'.
+	parts.clear();
+	size_t userStart = fields.find('|');
+	size_t passwordStart = userStart == std::string::npos ? std::string::npos : fields.find('|', userStart + 1);
+	if (passwordStart == std::string::npos)
+	{
+		return false;
+	}
+	parts.push_back(fields.substr(0, userStart));
+	parts.push_back(fields.substr(userStart + 1, passwordStart - userStart - 1));
+
+	size_t fieldsEnd = fields.size();
+	std::string attributes;
+	size_t attributesStart = fields.rfind('|');
+	if (attributesStart > passwordStart && fields[attributesStart + 1] == '&')
+	{
+		size_t generationStart = fields.rfind('|', attributesStart - 1);
+		if (generationStart > passwordStart && generationStart + 1 < attributesStart
+			&& fields.find_first_not_of("0123456789", generationStart + 1) == attributesStart)
+		{
+			attributes = fields.substr(attributesStart + 1);
+			fieldsEnd = attributesStart;
+		}
+	}
+
+	size_t generationStart = fields.rfind('|', fieldsEnd - 1);
+	if (generationStart == passwordStart)
+	{
+		parts.push_back(fields.substr(passwordStart + 1));
+	}
+	else
+	{
+		parts.push_back(fields.substr(passwordStart + 1, generationStart - passwordStart - 1));
+		parts.push_back(fields.substr(generationStart + 1, fieldsEnd - generationStart - 1));
+		if (parts[3].empty() || parts[3].find_first_not_of("0123456789") != std::string::npos)
+		{
+			return false;
+		}
+		if (!attributes.empty())
+		{
+			parts.push_back(attributes);
+		}
+	}
+	return !parts[0].empty() && !parts[1].empty() && !parts[2].empty();
+}
+// XOR with the master password. The key position follows the absolute file offset,
+// so the file can be processed block by block.
+void simpleEncryptDecrypt(char* data, size_t length, const std::string& key, size_t offset)
+{
+	const size_t keyLength = key.length();
+	size_t k = offset % keyLength;
+	for (size_t i = 0; i < length; ++i)
+	{
+		data[i] ^= key[k];
+		if (++k == keyLength)
+		{
+			k = 0;
+		}
+	}
+}
+
+const size_t FILE_BLOCK_SIZE = 1 << 20; //read/write granularity, also the cancellation granularity for I/O
+const size_t CHECKPOINT_INTERVAL = 4096; //entries between cancellation checks
+
+// Moves the freshly written temp file over the real one
+void replaceFile(const std::string& tempFilename, const std::string& filename)
+{
+	if (std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+	{
+		// rename does not overwrite on every platform
+		std::remove(filename.c_str());
+		if (std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+		{
+			throw std::runtime_error("Cannot replace file: " + filename);
+		}
+	}
+}
+
+std::string PasswordManager::metadataText() const
+{
+	std::string content = "CIPHER:" + CipherRegistry::store(*fileCipher) + "\n";
+	if (cipherGeneration > 0)
+	{
+		content += "CIPHER_GENERATION:" + intToString(cipherGeneration) + "\n";
+	}
+	for (size_t generation = 0; generation < legacyCiphers.size(); ++generation)
+	{
+		if (legacyCiphers[generation] != nullptr)
+		{
+			content += "LEGACY_CIPHER:" + intToString(generation) + ":" + CipherRegistry::store(*legacyCiphers[generation]) + "\n";
+		}
+	}
+	return content;
+}
+
+void PasswordManager::appendEntryLine(std::string& out, const PasswordEntry& entry, bool withChecksum) const
+{
+	size_t lineStart = out.size();
+	out += entry.getWebsite();
+	out += '|';
+	out += entry.getUsername();
+	out += '|';
+	out += entry.getPassword();
+	if (entry.getGeneration() != cipherGeneration || entry.getPassword().find('|') != std::string::npos || entry.hasAttributes())
+	{
+		out += "|" + intToString(entry.getGeneration()); // not migrated yet, or needed to find the end of the password
+	}
+	if (entry.hasAttributes())
+	{
+		out += "|" + entry.encodeAttributes();
+	}
+	if (withChecksum)
+	{
+		appendRecordChecksum(out, lineStart); // chunked files authenticate whole records instead
+	}
+	out += '\n';
+}
+
+void PasswordManager::saveToFile() const 
+{
+	if (!isFileOpen)
+	{
+		throw std::runtime_error("No file is open.");
+	}
+	if (fileMode == VaultHeader::BODY_CHUNKED)
+	{
+		saveChunked();
+		return;
+	}
+
+	// Create content to save
+	std::string content = metadataText() + "ENTRIES:\n";
+
+	for (size_t i = 0; i < passwords.size(); ++i)
+	{
+		if (jobControl && i % CHECKPOINT_INTERVAL == 0)
+		{
+			jobControl->checkpoint();
+		}
+		appendEntryLine(content, passwords[i], true);
+	}
+	if (jobControl)
+	{
+		jobControl->setBytesTotal(content.size());
+	}
+
+	// Write next to the real file and swap it in at the end, so a failed or cancelled save keeps the old vault
+	std::string tempFilename = filename + ".tmp";
+	std::ofstream file(tempFilename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) 
+	{
+		throw std::runtime_error("Cannot write to file: " + filename);
+	}
+
+	// a fresh nonce on every save, the data key stays the same
+	VaultHeader written = header;
+	std::unique_ptr<ChaCha20> stream;
+	if (fileMode == VaultHeader::BODY_CHACHA20)
+	{
+		std::string nonce = SecureRandom::bytes(ChaCha20::NONCE_SIZE);
+		written.setBody(fileMode, nonce);
+		stream.reset(new ChaCha20(dataKey, nonce));
+	}
+	else
+	{
+		written.setBody(fileMode, std::string());
+	}
+	written.setTrailer(true);
+	uint32_t checksum = 0;
+
+	try
+	{
+		std::string headerBytes = written.serialize();
+		file.write(headerBytes.data(), headerBytes.size());
+
+		for (size_t offset = 0; offset < content.size(); offset += FILE_BLOCK_SIZE)
+		{
+			if (jobControl)
+			{
+				jobControl->checkpoint();
+			}
+
+			size_t length = std::min(FILE_BLOCK_SIZE, content.size() - offset);
+			if (stream)
+			{
+				stream->apply(&content[offset], length, offset);
+			}
+			else
+			{
+				// Encrypt content using simple XOR with the data key
+				simpleEncryptDecrypt(&content[offset], length, dataKey, offset);
+			}
+			checksum = Crc32c::update(checksum, &content[offset], length);
+			file.write(&content[offset], length);
+
+			if (jobControl)
+			{
+				jobControl->addBytes(length);
+			}
+		}
+		std::string trailer = VaultHeader::makeTrailer(content.size(), checksum);
+		file.write(trailer.data(), trailer.size());
+		file.close();
+		if (file.fail())
+		{
+			throw std::runtime_error("Cannot write to file: " + filename);
+		}
+	}
+	catch (...)
+	{
+		file.close();
+		std::remove(tempFilename.c_str());
+		throw;
+	}
+
+	replaceFile(tempFilename, filename);
+	header = written; // passwd rewrites this header in place, it must carry the nonce now on disk
+	chunks.reset(passwords.size()); // nothing on disk to reuse if the file becomes chunked later
+	savedMetadata.clear();
+	historyRecords.clear(); // only a chunked body has a history segment
+	pendingHistory.clear();
+	historyRewrite = false;
+	historyGenerations.clear();
+}
+
+void PasswordManager::saveChunked() const
+{
+	std::vector<VaultChunks::Chunk>& layout = chunks.getChunks();
+	size_t tracked = 0;
+	for (const VaultChunks::Chunk& chunk : layout)
+	{
+		tracked += chunk.entries;
+	}
+	if (tracked != passwords.size())
+	{
+		chunks.reset(passwords.size()); // out of step with the entries, write everything again
+	}
+
+	// 1. seal the dirty chunks in parallel; one that grew past twice the target size is cut into several
+	struct Sealed
+	{
+		std::vector<VaultChunks::Chunk> pieces;
+		std::vector<std::string> records;
+	};
+	std::vector<size_t> firstEntry(layout.size());
+	std::vector<size_t> dirty;
+	for (size_t i = 0, first = 0; i < layout.size(); first += layout[i].entries, ++i)
+	{
+		firstEntry[i] = first;
+		if (layout[i].dirty)
+		{
+			dirty.push_back(i);
+		}
+	}
+
+	std::vector<Sealed> sealed(dirty.size());
+	ThreadPool::shared().parallelFor(dirty.size(), [this, &layout, &firstEntry, &dirty, &sealed](size_t d)
+	{
+		if (jobControl)
+		{
+			jobControl->checkpoint();
+		}
+
+		size_t begin = firstEntry[dirty[d]];
+		size_t end = begin + layout[dirty[d]].entries;
+		std::string text;
+		std::vector<size_t> lineEnds;
+		for (size_t i = begin; i < end; ++i)
+		{
+			appendEntryLine(text, passwords[i], false);
+			lineEnds.push_back(text.size());
+		}
+
+		size_t pieceStart = 0;
+		size_t pieceEntries = 0;
+		for (size_t i = 0; i < lineEnds.size(); ++i)
+		{
+			++pieceEntries;
+			bool last = i + 1 == lineEnds.size();
+			if (last || (text.size() > 2 * VaultChunks::TARGET_SIZE && lineEnds[i] - pieceStart >= VaultChunks::TARGET_SIZE))
+			{
+				std::string plain = text.substr(pieceStart, lineEnds[i] - pieceStart);
+				std::string record = VaultChunks::seal(dataKey, VaultChunks::ENTRIES, plain);
+				sealed[d].pieces.push_back(VaultChunks::Chunk{ pieceEntries, false, 0, static_cast<uint32_t>(record.size()),
+					VaultChunks::recordTag(record.data()) });
+				sealed[d].records.push_back(std::move(record));
+				pieceStart = lineEnds[i];
+				pieceEntries = 0;
+			}
+		}
+		// an emptied chunk leaves no pieces and disappears from the file
+	});
+
+	// 2. the new layout: clean chunks are copied from the current file, the rest come from step 1
+	std::vector<VaultChunks::Chunk> newLayout;
+	std::vector<const std::string*> newRecords; //nullptr for a chunk copied from the current file
+	for (size_t i = 0, d = 0; i < layout.size(); ++i)
+	{
+		if (d < dirty.size() && dirty[d] == i)
+		{
+			for (size_t p = 0; p < sealed[d].pieces.size(); ++p)
+			{
+				newLayout.push_back(sealed[d].pieces[p]);
+				newRecords.push_back(&sealed[d].records[p]);
+			}
+			++d;
+		}
+		else
+		{
+			newLayout.push_back(layout[i]);
+			newRecords.push_back(nullptr);
+		}
+	}
+
+	// 3. replaced passwords go into one new history record behind the others; past MAX_RECORDS all of them are merged
+	if (!pendingHistory.empty() && !historyRewrite && historyRecords.size() >= PasswordHistory::MAX_RECORDS)
+	{
+		pendingHistory = readHistory();
+		historyRewrite = true;
+	}
+	std::vector<unsigned> newHistoryGenerations = historyGenerations;
+	if (historyRewrite)
+	{
+		// a merge keeps the newest versions of the entries still in the vault
+		std::unordered_set<std::string> live;
+		live.reserve(passwords.size());
+		for (const PasswordEntry& entry : passwords)
+		{
+			live.insert(entry.getWebsite() + '\n' + entry.getUsername());
+		}
+		pendingHistory.erase(std::remove_if(pendingHistory.begin(), pendingHistory.end(), [&live](const PasswordHistory::Version& version)
+		{
+			return live.count(version.website + '\n' + version.username) == 0;
+		}), pendingHistory.end());
+		PasswordHistory::sort(pendingHistory);
+		PasswordHistory::prune(pendingHistory, historyKeep);
+
+		newHistoryGenerations.clear();
+		for (const PasswordHistory::Version& version : pendingHistory)
+		{
+			newHistoryGenerations.push_back(version.generation);
+		}
+		std::sort(newHistoryGenerations.begin(), newHistoryGenerations.end());
+		newHistoryGenerations.erase(std::unique(newHistoryGenerations.begin(), newHistoryGenerations.end()), newHistoryGenerations.end());
+	}
+
+	std::vector<VaultChunks::Chunk> newHistory;
+	if (!historyRewrite)
+	{
+		newHistory = historyRecords;
+	}
+	std::string historyRecord; //the new one, last in newHistory
+	if (!pendingHistory.empty())
+	{
+		std::vector<PasswordHistory::Version> versions = pendingHistory;
+		std::string plain = PasswordHistory::encode(versions);
+		historyRecord = VaultChunks::seal(dataKey, VaultChunks::HISTORY, plain);
+		newHistory.push_back(VaultChunks::Chunk{ versions.size(), false, 0, static_cast<uint32_t>(historyRecord.size()),
+			VaultChunks::recordTag(historyRecord.data()) });
+	}
+
+	std::string metadata = metadataText();
+	for (const VaultChunks::Chunk& chunk : newLayout)
+	{
+		metadata += "CHUNK:" + VaultChunks::describe(chunk) + "\n";
+	}
+	for (const VaultChunks::Chunk& chunk : newHistory)
+	{
+		metadata += "HISTORY:" + VaultChunks::describe(chunk) + "\n";
+	}
+	if (historyKeep != PasswordHistory::DEFAULT_KEEP)
+	{
+		metadata += "HISTORY_KEEP:" + std::to_string(historyKeep) + "\n";
+	}
+	if (!newHistoryGenerations.empty())
+	{
+		std::string generations;
+		for (unsigned generation : newHistoryGenerations)
+		{
+			generations += (generations.empty() ? "" : ",") + std::to_string(generation);
+		}
+		metadata += "HISTORY_GENERATIONS:" + generations + "\n";
+	}
+	metadata += "ENTRIES:\n";
+
+	VaultHeader written = header;
+	written.setBody(VaultHeader::BODY_CHUNKED, std::string());
+	written.setTrailer(true);
+	std::string headerBytes = written.serialize();
+
+	// every change saves right away, so the save on close usually finds the file as it is on disk
+	if (dirty.empty() && metadata == savedMetadata)
+	{
+		std::ifstream current(filename.c_str(), std::ios::binary);
+		std::string onDisk(headerBytes.size(), '\0');
+		if (current.read(&onDisk[0], onDisk.size()) && onDisk == headerBytes)
+		{
+			historyRewrite = false; // an empty history merged into nothing
+			return;
+		}
+	}
+
+	std::string plainMetadata = metadata;
+	std::string metadataRecord = VaultChunks::seal(dataKey, VaultChunks::METADATA, metadata);
+
+	uint64_t total = headerBytes.size() + metadataRecord.size();
+	for (const VaultChunks::Chunk& chunk : newLayout)
+	{
+		total += chunk.recordSize;
+	}
+	for (const VaultChunks::Chunk& chunk : newHistory)
+	{
+		total += chunk.recordSize;
+	}
+	if (jobControl)
+	{
+		jobControl->setBytesTotal(total);
+	}
+
+	// 4. write next to the real file and swap it in at the end, so a failed or cancelled save keeps the old vault
+	std::ifstream current;
+	std::string tempFilename = filename + ".tmp";
+	std::ofstream file(tempFilename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Cannot write to file: " + filename);
+	}
+
+	try
+	{
+		file.write(headerBytes.data(), headerBytes.size());
+		file.write(metadataRecord.data(), metadataRecord.size());
+		uint64_t offset = headerBytes.size() + metadataRecord.size();
+		uint32_t checksum = Crc32c::compute(metadataRecord.data(), metadataRecord.size());
+
+		// a clean record is copied from the current file as it is
+		std::string copied;
+		auto copyRecord = [this, &current, &copied, &checksum, &file](const VaultChunks::Chunk& chunk)
+		{
+			if (!current.is_open())
+			{
+				current.open(filename.c_str(), std::ios::binary);
+			}
+			copied.resize(chunk.recordSize);
+			current.seekg(static_cast<std::streamoff>(chunk.fileOffset));
+			current.read(&copied[0], copied.size());
+			if (!current || VaultChunks::recordSize(copied.data(), copied.size()) != copied.size()
+				|| VaultChunks::recordTag(copied.data()) != chunk.tag)
+			{
+				throw std::runtime_error("File was changed on disk since it was opened: " + filename);
+			}
+			checksum = Crc32c::update(checksum, copied.data(), copied.size());
+			file.write(copied.data(), copied.size());
+		};
+
+		for (size_t i = 0; i < newLayout.size(); ++i)
+		{
+			if (jobControl)
+			{
+				jobControl->checkpoint();
+			}
+
+			VaultChunks::Chunk& chunk = newLayout[i];
+			if (newRecords[i] != nullptr)
+			{
+				checksum = Crc32c::update(checksum, newRecords[i]->data(), newRecords[i]->size());
+				file.write(newRecords[i]->data(), newRecords[i]->size());
+			}
+			else
+			{
+				copyRecord(chunk);
+			}
+			chunk.fileOffset = offset;
+			offset += chunk.recordSize;
+
+			if (jobControl)
+			{
+				jobControl->addBytes(chunk.recordSize);
+			}
+		}
+
+		// the history records stay as they are, the new one goes last
+		for (size_t i = 0; i < newHistory.size(); ++i)
+		{
+			VaultChunks::Chunk& chunk = newHistory[i];
+			if (i + 1 == newHistory.size() && !historyRecord.empty())
+			{
+				checksum = Crc32c::update(checksum, historyRecord.data(), historyRecord.size());
+				file.write(historyRecord.data(), historyRecord.size());
+			}
+			else
+			{
+				copyRecord(chunk);
+			}
+			chunk.fileOffset = offset;
+			offset += chunk.recordSize;
+		}
+		std::string trailer = VaultHeader::makeTrailer(offset - headerBytes.size(), checksum);
+		file.write(trailer.data(), trailer.size());
+		file.close();
+		if (file.fail())
+		{
+			throw std::runtime_error("Cannot write to file: " + filename);
+		}
+	}
+	catch (...)
+	{
+		file.close();
+		std::remove(tempFilename.c_str());
+		throw;
+	}
+
+	current.close();
+	replaceFile(tempFilename, filename);
+	header = written;
+	layout.swap(newLayout);
+	savedMetadata.swap(plainMetadata);
+	historyRecords.swap(newHistory);
+	pendingHistory.clear();
+	historyRewrite = false;
+	historyGenerations.swap(newHistoryGenerations);
+}
+
+bool PasswordManager::parseEntryLine(const std::string& line, bool checksummed, std::vector<PasswordEntry>& out) const
+{
+	size_t fieldsLength = line.size();
+	if (checksummed && !checkRecord(line, fieldsLength))
+	{
+		return false;
+	}
+
+	std::vector<std::string> parts;
+	if (!splitEntryFields(line.substr(0, fieldsLength), parts))
+	{
+		return false;
+	}
+
+	unsigned generation = cipherGeneration;
+	if (parts.size() >= 4)
+	{
+		generation = static_cast<unsigned>(stringToInt(parts[3]));
+		getCipherFor(generation); // throws for a generation without a stored cipher
+	}
+	PasswordEntry entry(parts[0], parts[1], parts[2], generation);
+	if (parts.size() == 5)
+	{
+		try
+		{
+			entry.decodeAttributes(parts[4]);
+		}
+		catch (const std::invalid_argument&)
+		{
+			return false;
+		}
+	}
+	out.push_back(std::move(entry));
+	return true;
+}
+
+void PasswordManager::loadChunks(const std::string& body, uint64_t bodyOffset, const std::vector<VaultChunks::Chunk>& listed,
+	const std::vector<VaultChunks::Chunk>& listedHistory)
+{
+	// find the records first, that is only a hop from one length field to the next
+	std::vector<VaultChunks::Chunk> layout = listed;
+	size_t position = VaultChunks::recordSize(body.data(), body.size()); // past the metadata record
+	for (VaultChunks::Chunk& chunk : layout)
+	{
+		size_t size = VaultChunks::recordSize(body.data() + position, body.size() - position);
+		if (size == 0)
+		{
+			throw std::runtime_error("File is truncated: " + filename);
+		}
+		if (VaultChunks::recordTag(body.data() + position) != chunk.tag)
+		{
+			throw std::runtime_error("Vault chunk does not match the file's chunk list (file modified or corrupted)");
+		}
+		chunk.fileOffset = bodyOffset + position;
+		chunk.recordSize = static_cast<uint32_t>(size);
+		position += size;
+	}
+
+	// the history records are only located; history and revert open them when asked
+	std::vector<VaultChunks::Chunk> history = listedHistory;
+	for (VaultChunks::Chunk& chunk : history)
+	{
+		size_t size = VaultChunks::recordSize(body.data() + position, body.size() - position);
+		if (size == 0)
+		{
+			throw std::runtime_error("File is truncated: " + filename);
+		}
+		if (VaultChunks::recordTag(body.data() + position) != chunk.tag)
+		{
+			throw std::runtime_error("History record does not match the file's history list (file modified or corrupted)");
+		}
+		chunk.fileOffset = bodyOffset + position;
+		chunk.recordSize = static_cast<uint32_t>(size);
+		position += size;
+	}
+	if (position != body.size())
+	{
+		throw std::runtime_error("Unexpected data after the last chunk: " + filename);
 	}
 
-	// Decrypt content using simple XOR with master password
-	std::string decryptedContent = simpleEncryptDecrypt(encryptedContent, masterPassword);
+	// then verify, decrypt and parse them on all cores
+	std::vector<std::vector<PasswordEntry>> parsed(layout.size());
+	ThreadPool::shared().parallelFor(layout.size(), [this, &body, bodyOffset, &layout, &parsed](size_t i)
+	{
+		if (jobControl)
+		{
+			jobControl->checkpoint();
+		}
+
+		const VaultChunks::Chunk& chunk = layout[i];
+		std::string plain = VaultChunks::open(dataKey, VaultChunks::ENTRIES, body.data() + (chunk.fileOffset - bodyOffset), chunk.recordSize);
+		parsed[i].reserve(chunk.entries);
+
+		std::string line;
+		size_t lineStart = 0;
+		while (lineStart < plain.size())
+		{
+			size_t newline = plain.find('\n', lineStart);
+			if (newline == std::string::npos)
+			{
+				newline = plain.size();
+			}
+			line.assign(plain, lineStart, newline - lineStart);
+			if (!line.empty())
+			{
+				parseEntryLine(line, false, parsed[i]);
+			}
+			lineStart = newline + 1;
+		}
+		if (parsed[i].size() != chunk.entries)
+		{
+			throw std::runtime_error("Vault chunk holds a different number of entries than listed");
+		}
+
+		if (jobControl)
+		{
+			jobControl->addBytes(chunk.recordSize);
+			jobControl->addEntries(chunk.entries);
+		}
+	});
+
+	size_t total = 0;
+	for (const std::vector<PasswordEntry>& entries : parsed)
+	{
+		total += entries.size();
+	}
+	passwords.reserve(total);
+	for (std::vector<PasswordEntry>& entries : parsed)
+	{
+		passwords.insert(passwords.end(), std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
+		std::vector<PasswordEntry>().swap(entries);
+	}
+
+	chunks.getChunks().swap(layout);
+	historyRecords.swap(history);
+}
+
+void PasswordManager::loadFromFile()
+{
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Cannot open file: " + filename);
+	}
+
+	if (jobControl)
+	{
+		file.seekg(0, std::ios::end);
+		jobControl->setBytesTotal(static_cast<uint64_t>(file.tellg()));
+		file.seekg(0, std::ios::beg);
+	}
 
-	// Parse decrypted content
 	passwords.clear();
+	chunks.reset(0);
+	savedMetadata.clear();
+	clearHistory();
 	delete fileCipher;
 	fileCipher = nullptr;
+	cipherGeneration = 0;
+	clearLegacyCiphers();
 
-	std::vector<std::string> lines = splitString(decryptedContent, '\n');
 	std::string cipherType, cipherConfig;
 	bool readingEntries = false;
-
-	for (const std::string& currentLine : lines)
+	std::vector<VaultChunks::Chunk> listedChunks; //data records of a chunked file, from its metadata record
+	std::vector<VaultChunks::Chunk> listedHistory; //its history records, not opened here
+	bool checksummed = false; //entry lines end in a CRC-32C, the file in a trailer
+	size_t entryLines = 0;
+	size_t damagedLines = 0; //reported all at once, see fsck
+	size_t firstDamaged = 0;
+
+	auto parseLine = [&](const std::string& currentLine)
 	{
-		if (currentLine.empty()) continue;
+		if (currentLine.empty()) return;
 
-		if (currentLine.find("CIPHER_TYPE:") == 0)
+		if (currentLine.find("CIPHER:") == 0)
+		{
+			// CIPHER:<type id>:<hex config>; files from before type IDs use the two lines below
+			size_t configStart = currentLine.find(':', 7);
+			if (configStart == std::string::npos)
+			{
+				throw std::runtime_error("Invalid cipher line");
+			}
+			cipherType = currentLine.substr(7, configStart - 7);
+			cipherConfig = currentLine.substr(configStart + 1);
+		}
+		else if (currentLine.find("CIPHER_TYPE:") == 0)
 		{
 			cipherType = currentLine.substr(12);
 		}
@@ -515,47 +1871,257 @@ void PasswordManager::loadFromFile()
 		{
 			cipherConfig = currentLine.substr(14);
 		}
-		else if (currentLine == "ENTRIES:")
+		else if (currentLine.find("CIPHER_GENERATION:") == 0)
 		{
-			readingEntries = true;
-
-			// Create cipher based on type and config
-			if (cipherType == "Ceasar")
+			cipherGeneration = static_cast<unsigned>(stringToInt(currentLine.substr(18)));
+		}
+		else if (currentLine.find("LEGACY_CIPHER:") == 0 && !readingEntries)
+		{
+			// LEGACY_CIPHER:<generation>:<type>:<config>, the config may contain ':' itself
+			size_t typeStart = currentLine.find(':', 14);
+			size_t configStart = typeStart == std::string::npos ? std::string::npos : currentLine.find(':', typeStart + 1);
+			if (configStart == std::string::npos)
 			{
-				int shift = stringToInt(cipherConfig);
-				fileCipher = new CeasarCipher(shift);
+				throw std::runtime_error("Invalid legacy cipher line");
 			}
-			else if (cipherType == "TextCode")
+			int generation = stringToInt(currentLine.substr(14, typeStart - 14));
+			if (generation < 0)
 			{
-				fileCipher = new TextCodeCipher(cipherConfig);
+				throw std::runtime_error("Invalid legacy cipher generation");
 			}
-			else if (cipherType == "Hill")
+			if (legacyCiphers.size() <= static_cast<size_t>(generation))
 			{
-				// Parse Hill cipher config: "Matrix size: 2, Key matrix: 1 2; 3 4"
-				int matrixSize = parseHillMatrixSize(cipherConfig);
-				std::string matrixStr = parseHillMatrixString(cipherConfig);
-
-				std::vector<std::vector<int>> keyMatrix = parseHillMatrix(matrixStr, matrixSize);
-				fileCipher = new HillCipher(keyMatrix);
+				legacyCiphers.resize(generation + 1, nullptr);
 			}
-			else
+			delete legacyCiphers[generation];
+			legacyCiphers[generation] = CipherRegistry::instance().restore(currentLine.substr(typeStart + 1, configStart - typeStart - 1),
+				currentLine.substr(configStart + 1));
+		}
+		else if (currentLine == "ENTRIES:")
+		{
+			readingEntries = true;
+
+			// Create cipher based on type and config
+			fileCipher = CipherRegistry::instance().restore(cipherType, cipherConfig);
+		}
+		else if (currentLine.find("CHUNK:") == 0 && !readingEntries)
+		{
+			listedChunks.push_back(VaultChunks::parseDescription(currentLine.substr(6)));
+		}
+		else if (currentLine.find("HISTORY:") == 0 && !readingEntries)
+		{
+			listedHistory.push_back(VaultChunks::parseDescription(currentLine.substr(8)));
+		}
+		else if (currentLine.find("HISTORY_KEEP:") == 0 && !readingEntries)
+		{
+			historyKeep = static_cast<size_t>(stringToInt(currentLine.substr(13)));
+		}
+		else if (currentLine.find("HISTORY_GENERATIONS:") == 0 && !readingEntries)
+		{
+			// HISTORY_GENERATIONS:<generation>,<generation>,..., ascending
+			for (size_t start = 20; start < currentLine.size();)
 			{
-				throw std::runtime_error("Unknown cipher type: " + cipherType);
+				size_t comma = currentLine.find(',', start);
+				if (comma == std::string::npos)
+				{
+					comma = currentLine.size();
+				}
+				historyGenerations.push_back(static_cast<unsigned>(stringToInt(currentLine.substr(start, comma - start))));
+				start = comma + 1;
 			}
 		}
 		else if (readingEntries)
 		{
-			// Parse entry line: website|username|encrypted_password
-			std::vector<std::string> parts = splitString(currentLine, '|');
-			if (parts.size() == 3)
+			++entryLines;
+			if (!parseEntryLine(currentLine, checksummed, passwords))
 			{
-				passwords.push_back(PasswordEntry(parts[0], parts[1], parts[2]));
+				if (damagedLines++ == 0)
+				{
+					firstDamaged = entryLines;
+				}
 			}
+			else if (jobControl)
+			{
+				jobControl->addEntries(1);
+			}
+		}
+	};
+
+	// Files from before the header existed are XORed with the master password itself.
+	// They get a data key now and are converted by the next save.
+	// The KDF runs here once per open; saves reuse the sealed header and the data key.
+	// Older files are converted to a chunked body by the next save.
+	std::string bodyKey;
+	std::unique_ptr<ChaCha20> stream;
+	fileMode = VaultHeader::BODY_CHUNKED;
+	char headerBytes[VaultHeader::SIZE];
+	file.read(headerBytes, VaultHeader::MAGIC_SIZE);
+	size_t headerSize = file.gcount() == VaultHeader::MAGIC_SIZE ? VaultHeader::sizeFromMagic(headerBytes) : 0;
+	if (headerSize > 0)
+	{
+		file.read(headerBytes + VaultHeader::MAGIC_SIZE, headerSize - VaultHeader::MAGIC_SIZE);
+		header = VaultHeader::parse(headerBytes, VaultHeader::MAGIC_SIZE + static_cast<size_t>(file.gcount()));
+		checksummed = header.hasTrailer();
+		dataKey = header.unwrap(masterPassword);
+		bodyKey = dataKey;
+		if (headerSize == VaultHeader::SIZE)
+		{
+			fileMode = header.getBodyMode(); // a file kept in XOR mode on purpose stays that way
+		}
+		if (header.getBodyMode() == VaultHeader::BODY_CHACHA20)
+		{
+			stream.reset(new ChaCha20(dataKey, header.getBodyNonce()));
+		}
+		if (!header.needsReseal())
+		{
+			kdfIterations = header.getIterations();
+		}
+		else
+		{
+			header = VaultHeader::seal(dataKey, masterPassword, kdfIterations); // written by the next save
+		}
+	}
+	else
+	{
+		file.clear();
+		file.seekg(0, std::ios::beg);
+		dataKey = VaultHeader::newDataKey();
+		header = VaultHeader::seal(dataKey, masterPassword, kdfIterations);
+		bodyKey = masterPassword;
+	}
+
+	// the trailer holds the body length and checksum, so a truncated file is caught before parsing
+	uint64_t bodyStart = static_cast<uint64_t>(file.tellg());
+	file.seekg(0, std::ios::end);
+	uint64_t bodyEnd = static_cast<uint64_t>(file.tellg());
+	uint32_t expectedChecksum = 0;
+	if (checksummed)
+	{
+		uint64_t trailerLength = 0;
+		char trailer[VaultHeader::TRAILER_SIZE];
+		if (bodyEnd >= bodyStart + VaultHeader::TRAILER_SIZE)
+		{
+			bodyEnd -= VaultHeader::TRAILER_SIZE;
+			file.seekg(static_cast<std::streamoff>(bodyEnd));
+			file.read(trailer, sizeof(trailer));
+		}
+		if (!file || !VaultHeader::parseTrailer(trailer, trailerLength, expectedChecksum) || trailerLength != bodyEnd - bodyStart)
+		{
+			throw std::runtime_error("File is truncated or damaged (no valid checksum trailer). Run 'fsck " + filename + " <password>' for details.");
+		}
+	}
+	file.seekg(static_cast<std::streamoff>(bodyStart));
+	uint32_t checksum = 0;
+
+	if (headerSize == VaultHeader::SIZE && header.getBodyMode() == VaultHeader::BODY_CHUNKED)
+	{
+		// the records are read in one go, the metadata record is parsed here and the rest by loadChunks
+		std::string body(static_cast<size_t>(bodyEnd - bodyStart), '\0');
+		file.read(&body[0], body.size());
+		if (!file)
+		{
+			throw std::runtime_error("Cannot read file: " + filename);
+		}
+		file.close();
+		if (checksummed && Crc32c::compute(body.data(), body.size()) != expectedChecksum)
+		{
+			throw std::runtime_error("File checksum does not match, the file is damaged. Run 'fsck " + filename + " <password>' for details.");
+		}
+
+		size_t metadataSize = VaultChunks::recordSize(body.data(), body.size());
+		if (metadataSize == 0)
+		{
+			throw std::runtime_error("File is empty or corrupted: " + filename);
+		}
+		std::string metadata = VaultChunks::open(dataKey, VaultChunks::METADATA, body.data(), metadataSize);
+		savedMetadata = metadata;
+		size_t lineStart = 0;
+		size_t newline;
+		while ((newline = metadata.find('\n', lineStart)) != std::string::npos && !readingEntries)
+		{
+			parseLine(metadata.substr(lineStart, newline - lineStart));
+			lineStart = newline + 1;
+		}
+		if (!fileCipher)
+		{
+			throw std::runtime_error("Failed to create cipher from file data");
+		}
+		if (jobControl)
+		{
+			jobControl->addBytes(headerSize + metadataSize);
+		}
+
+		loadChunks(body, headerSize, listedChunks, listedHistory);
+		return;
+	}
+
+	// Read, decrypt and parse block by block, a partial line waits for the next block
+	std::string block(FILE_BLOCK_SIZE, '\0');
+	std::string pendingLine;
+	size_t offset = 0;
+
+	while (file && offset < bodyEnd - bodyStart)
+	{
+		if (jobControl)
+		{
+			jobControl->checkpoint();
+		}
+
+		file.read(&block[0], static_cast<std::streamsize>(std::min<uint64_t>(FILE_BLOCK_SIZE, bodyEnd - bodyStart - offset)));
+		size_t length = static_cast<size_t>(file.gcount());
+		if (length == 0)
+		{
+			break;
+		}
+		checksum = Crc32c::update(checksum, block.data(), length);
+
+		if (stream)
+		{
+			stream->apply(&block[0], length, offset);
+		}
+		else
+		{
+			// Decrypt content using simple XOR with the data key
+			simpleEncryptDecrypt(&block[0], length, bodyKey, offset);
+		}
+		offset += length;
+
+		size_t lineStart = 0;
+		size_t newline;
+		while ((newline = block.find('\n', lineStart)) < length)
+		{
+			pendingLine.append(block, lineStart, newline - lineStart);
+			parseLine(pendingLine);
+			pendingLine.clear();
+			lineStart = newline + 1;
 		}
+		pendingLine.append(block, lineStart, length - lineStart);
+
+		if (jobControl)
+		{
+			jobControl->addBytes(length);
+		}
+	}
+	file.close();
+
+	if (offset == 0)
+	{
+		throw std::runtime_error("File is empty or corrupted: " + filename);
 	}
+	parseLine(pendingLine);
 
+	if (damagedLines > 0)
+	{
+		throw std::runtime_error(std::to_string(damagedLines) + " damaged entry record(s), the first is entry " + std::to_string(firstDamaged)
+			+ ". Run 'fsck " + filename + " <password>' for details.");
+	}
+	if (checksummed && checksum != expectedChecksum)
+	{
+		throw std::runtime_error("File checksum does not match, the file is damaged. Run 'fsck " + filename + " <password>' for details.");
+	}
 	if (!fileCipher)
 	{
 		throw std::runtime_error("Failed to create cipher from file data");
 	}
+	chunks.reset(passwords.size()); // cut into records by the next save
 }
\ No newline at end of file
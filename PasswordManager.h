@@ -1,41 +1,146 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <ostream>
 #include "Cipher.h"
 #include "PasswordEntry.h"
+#include "JobControl.h"
+#include "VaultHeader.h"
+#include "VaultChunks.h"
+#include "SearchIndex.h"
+#include "DomainIndex.h"
+#include "TagIndex.h"
+#include "SortedIndex.h"
+#include "PasswordHistory.h"
+
+// the original file-level repeating-key XOR, still used for files saved in that mode
+void simpleEncryptDecrypt(char* data, size_t length, const std::string& key, size_t offset);
+
+// In files with a checksum trailer, entry lines of XOR and ChaCha20 bodies end
+// in "|#" and the CRC-32C of the rest of the line as 8 hex digits.
+void appendRecordChecksum(std::string& out, size_t lineStart); //lineStart: where the line begins in out
+bool checkRecord(const std::string& line, size_t& fieldsLength); //false if damaged; fieldsLength: the line without its checksum
+bool splitEntryFields(const std::string& fields, std::vector<std::string>& parts); //site|user|pass[|generation[|&attributes]], the password may hold '|'
 
 class PasswordManager
 {
 private:
 	std::string filename; //name of the file that contains the passwords
 	std::string masterPassword; //password used to encrypt/decrypt the file
+	std::string dataKey; //random key that encrypts the file body
+	mutable VaultHeader header; //dataKey wrapped by the master password, written in front of the body; every save gives it a new body nonce
+	VaultHeader::BodyMode fileMode; //how saveToFile encrypts the body
+	mutable VaultChunks chunks; //which records of a chunked file hold which entries, and which changed since the last save
+	mutable std::string savedMetadata; //plaintext of the chunked file's metadata record on disk
+	mutable std::vector<VaultChunks::Chunk> historyRecords; //history segment of a chunked file, entries = versions per record
+	mutable std::vector<PasswordHistory::Version> pendingHistory; //replaced passwords the next save appends
+	mutable bool historyRewrite; //pendingHistory holds the whole history, the next save drops the records on disk
+	mutable std::vector<unsigned> historyGenerations; //sorted cipher generations of stored versions, kept from retiring
+	size_t historyKeep; //versions kept per entry, 0 keeps none
+	uint32_t kdfIterations; //KDF cost for the next time the header is sealed
 	Cipher* fileCipher; //cipher used to encrypt/decrypt the passwords
+	unsigned cipherGeneration; //generation of fileCipher, stamped on every entry it encrypts
+	std::vector<Cipher*> legacyCiphers; //earlier generations still used by some entries, indexed by generation, nullptr once retired
 	std::vector<PasswordEntry> passwords; //list of passwords stored in the file
+	SearchIndex searchIndex; //substring search over the websites and usernames of passwords
+	DomainIndex domainIndex; //websites of passwords by host, for patterns like *.example.com
+	TagIndex tagIndex; //passwords by tag and metadata field
+	SortedIndex sortedIndex; //passwords ordered by website and by username, for paged listing
 	bool isFileOpen; //flag to indicate if a file is currently open
+	std::ostream* output; //where status messages are written, nullptr keeps the manager quiet
+	JobControl* jobControl; //progress/cancellation for long file operations, nullptr when not run as a job
 
-	
+	void storeHeader(const VaultHeader& newHeader); //in place when the file already has a current header
+	std::string metadataText() const; //cipher lines in front of the entries
+	void appendEntryLine(std::string& out, const PasswordEntry& entry, bool withChecksum) const;
+	bool parseEntryLine(const std::string& line, bool checksummed, std::vector<PasswordEntry>& out) const; //false for a damaged line
+	void saveChunked() const;
+	void loadChunks(const std::string& body, uint64_t bodyOffset, const std::vector<VaultChunks::Chunk>& listed,
+		const std::vector<VaultChunks::Chunk>& listedHistory);
+	void recordHistory(const PasswordEntry& entry); //before its password is replaced
+	void forgetHistory(const std::vector<size_t>& positions); //before those entries are erased
+	std::vector<PasswordHistory::Version> readHistory() const; //every version on disk and pending, sorted
+	void clearHistory();
+	const PasswordEntry* locatePassword(const std::string& website, const std::string& username) const; //see findPassword
+	bool migrateEntry(PasswordEntry& entry); //re-encrypt with the current cipher, false if it cannot be stored without loss
+	void retireUnusedCiphers();
+	void clearLegacyCiphers();
 
 public:
+	struct MergeResult
+	{
+		size_t added;
+		size_t overwritten;
+		size_t skipped; //already stored and left alone
+	};
+
+	typedef std::pair<std::string, std::string> EntryKey; //website, username
+
+	struct ListQuery
+	{
+		std::vector<std::string> tags; //entries must carry all of them
+		std::vector<std::pair<std::string, std::string>> fields; //and all of these name=value fields
+		std::string sitePrefix; //websites starting with it, empty for all
+		SortedIndex::Order order;
+		std::string after; //cursor returned with the previous page, empty for the first
+		size_t limit;
+	};
+
 	PasswordManager();
 	~PasswordManager();
 
 	bool getIsFileOpen() const { return isFileOpen; }
 	Cipher* getFileCipher() const { return fileCipher; }
+	unsigned getCipherGeneration() const { return cipherGeneration; }
+	Cipher* getCipherFor(unsigned generation) const;
+	std::vector<const Cipher*> getCipherGenerations() const; //indexed by generation, nullptr for retired ones
+	std::string decryptPassword(const PasswordEntry& entry) const; //with the cipher of the entry's generation
+	const std::string& getFilename() const { return filename; }
+	const std::vector<PasswordEntry>& getEntries() const { return passwords; }
 	void setFileCipher(Cipher* cipher);
+	void setOutput(std::ostream* stream) { output = stream; }
+	void setJobControl(JobControl* control) { jobControl = control; }
 	
 	void saveToFile() const;
 	void loadFromFile();
-	std::vector<PasswordEntry> loadAllUsers(const std::string& website) const;
+	std::vector<PasswordEntry> loadAllUsers(const std::string& website) const; //website may be a pattern, see DomainIndex
+	std::vector<std::string> suggestWebsites(const std::string& website, size_t limit) const; //close misspellings, closest first
+	std::vector<SearchIndex::Match> search(const std::string& text, size_t limit, size_t& total) const; //websites and usernames containing text
+	// one page of entries in the query's order; next is the cursor of the following page, empty after the last
+	std::vector<const PasswordEntry*> listEntries(const ListQuery& query, std::string& next) const;
 
 	void createFile(const std::string& filename, Cipher* cipher, const std::string& masterPassword);
 	void openFile(const std::string& filename, const std::string& masterPassword);
+	void changeMasterPassword(const std::string& currentPassword, const std::string& newPassword); //rewrites only the header
+	void changeKdfCost(uint32_t iterations); //reseals the open file's header with the new cost
+	size_t getHistoryKeep() const { return historyKeep; }
+	void setHistoryKeep(size_t keep); //saves; a lower limit drops the versions past it right away
+	uint32_t getKdfIterations() const { return kdfIterations; }
+	void setKdfIterations(uint32_t iterations) { kdfIterations = iterations; } //for files created afterwards
+	VaultHeader::BodyMode getFileMode() const { return fileMode; }
+	void setFileMode(VaultHeader::BodyMode mode) { fileMode = mode; } //applies from the next save
 
 	void addPassword(const std::string& website, const std::string& username, const std::string& password);
+	// the exact spelling first, then any spelling of the same host (case, www., trailing dot), as load matches
 	PasswordEntry* findPassword(const std::string& website, const std::string& username);
 	std::vector<PasswordEntry*> findPasswordsByWebsite(const std::string& website);
 	bool updatePassword(const std::string& website, const std::string& username, const std::string& newPassword);
+	// earlier passwords of an entry, newest first, at most getHistoryKeep(); chunked files only
+	std::vector<PasswordHistory::Version> getHistory(const std::string& website, const std::string& username) const;
+	void revertPassword(const std::string& website, const std::string& username, size_t version); //1 = the password before the current one
 	bool deletePassword(const std::string& website, const std::string& username);
-	int deletePasswordsByWebsite(const std::string& website);
+	int deletePasswordsByWebsite(const std::string& website, const std::string& username = ""); //website may be a pattern, see DomainIndex
+	// adds (or with removing, drops) tags and fields; website may be a pattern and username "*" for every user.
+	// Removing a field only looks at its name. Saves once, returns how many entries changed.
+	size_t tagEntries(const std::string& website, const std::string& username, const std::vector<std::string>& tags,
+		const std::vector<std::pair<std::string, std::string>>& fields, bool removing, size_t& matched);
+	MergeResult mergeEntries(std::vector<PasswordEntry>& entries, bool overwriteExisting); //bulk add, saves once
+	void replaceCipher(const Cipher& cipher, std::vector<std::string>& encryptedPasswords); //rekey, saves once
+
+	// lazy rotation: new entries use the new cipher, old ones move over as they are touched
+	void startMigration(const Cipher& cipher);
+	size_t migrateEntries(const std::vector<EntryKey>& keys); //returns how many moved, saves once
+	std::vector<size_t> countEntriesByGeneration() const;
 	bool isOpen() const;
 
 };
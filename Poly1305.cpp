@@ -0,0 +1,162 @@
+#include "Poly1305.h"
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+	inline uint64_t load64(const unsigned char* bytes)
+	{
+		uint64_t value = 0;
+		for (int i = 7; i >= 0; --i)
+		{
+			value = (value << 8) | bytes[i];
+		}
+		return value;
+	}
+
+	inline void store64(unsigned char* bytes, uint64_t value)
+	{
+		for (int i = 0; i < 8; ++i)
+		{
+			bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+		}
+	}
+
+	typedef unsigned __int128 uint128;
+	const uint64_t MASK44 = 0xfffffffffffULL;
+	const uint64_t MASK42 = 0x3ffffffffffULL;
+}
+
+Poly1305::Poly1305(const std::string& key) : buffered(0)
+{
+	if (key.size() != KEY_SIZE)
+	{
+		throw std::invalid_argument("Poly1305 key must be 32 bytes");
+	}
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(key.data());
+
+	// r &= 0xffffffc0ffffffc0ffffffc0fffffff, split into 44/44/42 bits
+	uint64_t t0 = load64(bytes);
+	uint64_t t1 = load64(bytes + 8);
+	r[0] = t0 & 0xffc0fffffffULL;
+	r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffULL;
+	r[2] = (t1 >> 24) & 0x00ffffffc0fULL;
+
+	h[0] = h[1] = h[2] = 0;
+	pad[0] = load64(bytes + 16);
+	pad[1] = load64(bytes + 24);
+}
+
+void Poly1305::blocks(const unsigned char* data, size_t length, uint64_t highBit)
+{
+	const uint64_t r0 = r[0], r1 = r[1], r2 = r[2];
+	const uint64_t s1 = r1 * (5 << 2), s2 = r2 * (5 << 2);
+	uint64_t h0 = h[0], h1 = h[1], h2 = h[2];
+
+	while (length >= 16)
+	{
+		uint64_t t0 = load64(data);
+		uint64_t t1 = load64(data + 8);
+		h0 += t0 & MASK44;
+		h1 += ((t0 >> 44) | (t1 << 20)) & MASK44;
+		h2 += ((t1 >> 24) & MASK42) | highBit;
+
+		// h *= r mod 2^130 - 5
+		uint128 d0 = (uint128)h0 * r0 + (uint128)h1 * s2 + (uint128)h2 * s1;
+		uint128 d1 = (uint128)h0 * r1 + (uint128)h1 * r0 + (uint128)h2 * s2;
+		uint128 d2 = (uint128)h0 * r2 + (uint128)h1 * r1 + (uint128)h2 * r0;
+
+		uint64_t carry = (uint64_t)(d0 >> 44); h0 = (uint64_t)d0 & MASK44;
+		d1 += carry; carry = (uint64_t)(d1 >> 44); h1 = (uint64_t)d1 & MASK44;
+		d2 += carry; carry = (uint64_t)(d2 >> 42); h2 = (uint64_t)d2 & MASK42;
+		h0 += carry * 5; carry = h0 >> 44; h0 &= MASK44;
+		h1 += carry;
+
+		data += 16;
+		length -= 16;
+	}
+
+	h[0] = h0; h[1] = h1; h[2] = h2;
+}
+
+void Poly1305::update(const void* data, size_t length)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	if (buffered > 0)
+	{
+		size_t take = std::min(length, 16 - buffered);
+		std::memcpy(buffer + buffered, bytes, take);
+		buffered += take;
+		bytes += take;
+		length -= take;
+		if (buffered < 16)
+		{
+			return;
+		}
+		blocks(buffer, 16, 1ULL << 40);
+		buffered = 0;
+	}
+
+	size_t whole = length & ~size_t(15);
+	blocks(bytes, whole, 1ULL << 40);
+	std::memcpy(buffer, bytes + whole, length - whole);
+	buffered = length - whole;
+}
+
+std::string Poly1305::finish()
+{
+	if (buffered > 0)
+	{
+		// the last partial block gets its 1 bit right after the data instead of at bit 128
+		buffer[buffered] = 1;
+		std::memset(buffer + buffered + 1, 0, 16 - buffered - 1);
+		blocks(buffer, 16, 0);
+		buffered = 0;
+	}
+
+	uint64_t h0 = h[0], h1 = h[1], h2 = h[2];
+	uint64_t carry = h1 >> 44; h1 &= MASK44;
+	h2 += carry; carry = h2 >> 42; h2 &= MASK42;
+	h0 += carry * 5; carry = h0 >> 44; h0 &= MASK44;
+	h1 += carry; carry = h1 >> 44; h1 &= MASK44;
+	h2 += carry; carry = h2 >> 42; h2 &= MASK42;
+	h0 += carry * 5; carry = h0 >> 44; h0 &= MASK44;
+	h1 += carry;
+
+	// g = h + 5 - 2^130, take it when it does not go negative
+	uint64_t g0 = h0 + 5; carry = g0 >> 44; g0 &= MASK44;
+	uint64_t g1 = h1 + carry; carry = g1 >> 44; g1 &= MASK44;
+	uint64_t g2 = h2 + carry - (1ULL << 42);
+
+	uint64_t useG = (g2 >> 63) - 1; // all ones when g2 did not borrow
+	h0 = (h0 & ~useG) | (g0 & useG);
+	h1 = (h1 & ~useG) | (g1 & useG);
+	h2 = (h2 & ~useG) | (g2 & useG);
+
+	// h + pad mod 2^128
+	uint64_t t0 = pad[0], t1 = pad[1];
+	h0 += t0 & MASK44; carry = h0 >> 44; h0 &= MASK44;
+	h1 += (((t0 >> 44) | (t1 << 20)) & MASK44) + carry; carry = h1 >> 44; h1 &= MASK44;
+	h2 += ((t1 >> 24) & MASK42) + carry; h2 &= MASK42;
+
+	unsigned char tag[TAG_SIZE];
+	store64(tag, h0 | (h1 << 44));
+	store64(tag + 8, (h1 >> 20) | (h2 << 24));
+	return std::string(reinterpret_cast<char*>(tag), TAG_SIZE);
+}
+
+bool Poly1305::tagsEqual(const std::string& a, const std::string& b)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	unsigned char difference = 0;
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		difference |= static_cast<unsigned char>(a[i] ^ b[i]);
+	}
+	return difference == 0;
+}
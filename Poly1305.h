@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Poly1305 one-time authenticator (RFC 8439). A key must never be used for two messages;
+// ChaCha20 derives a fresh one for every nonce.
+class Poly1305
+{
+private:
+	uint64_t r[3]; //clamped key half, 44/44/42-bit limbs
+	uint64_t h[3]; //accumulator
+	uint64_t pad[2]; //added at the end
+	unsigned char buffer[16];
+	size_t buffered;
+
+	void blocks(const unsigned char* data, size_t length, uint64_t highBit);
+
+public:
+	static const size_t KEY_SIZE = 32;
+	static const size_t TAG_SIZE = 16;
+
+	explicit Poly1305(const std::string& key);
+
+	void update(const void* data, size_t length);
+	std::string finish(); //the object must not be updated afterwards
+
+	static bool tagsEqual(const std::string& a, const std::string& b); //constant time
+};
@@ -0,0 +1,73 @@
+#include "RandomGenerator.h"
+#include "SecureRandom.h"
+#include <cstring>
+#include <stdexcept>
+
+RandomGenerator::RandomGenerator() : key(SecureRandom::bytes(ChaCha20::KEY_SIZE)), used(BUFFER_SIZE) {}
+
+RandomGenerator::~RandomGenerator()
+{
+	std::memset(buffer, 0, BUFFER_SIZE);
+	std::fill(key.begin(), key.end(), '\0');
+}
+
+void RandomGenerator::refill()
+{
+	// the keystream of a fresh key with a zero nonce; its first bytes become the next key
+	ChaCha20 stream(key, std::string(ChaCha20::NONCE_SIZE, '\0'));
+	std::memset(buffer, 0, BUFFER_SIZE);
+	stream.apply(buffer, BUFFER_SIZE, 0);
+	key.assign(buffer, ChaCha20::KEY_SIZE);
+	std::memset(buffer, 0, ChaCha20::KEY_SIZE);
+	used = ChaCha20::KEY_SIZE;
+}
+
+void RandomGenerator::fill(void* out, size_t length)
+{
+	unsigned char* target = static_cast<unsigned char*>(out);
+	while (length > 0)
+	{
+		if (used == BUFFER_SIZE)
+		{
+			refill();
+		}
+		size_t take = std::min(length, BUFFER_SIZE - used);
+		std::memcpy(target, buffer + used, take);
+		std::memset(buffer + used, 0, take);
+		used += take;
+		target += take;
+		length -= take;
+	}
+}
+
+uint64_t RandomGenerator::next64()
+{
+	uint64_t value;
+	fill(&value, sizeof(value));
+	return value;
+}
+
+uint32_t RandomGenerator::uniform(uint32_t bound)
+{
+	if (bound == 0)
+	{
+		throw std::invalid_argument("Random bound must be positive.");
+	}
+
+	// Lemire's multiply-shift: the high half of a 64x32 product is the result.
+	// Values whose low half falls below 2^64 mod bound would bias it; that
+	// happens with probability under 2^-32 and is the only time a draw repeats.
+	typedef unsigned __int128 uint128;
+	uint128 product = static_cast<uint128>(next64()) * bound;
+	uint64_t low = static_cast<uint64_t>(product);
+	if (low < bound)
+	{
+		uint64_t threshold = (0 - static_cast<uint64_t>(bound)) % bound;
+		while (low < threshold)
+		{
+			product = static_cast<uint128>(next64()) * bound;
+			low = static_cast<uint64_t>(product);
+		}
+	}
+	return static_cast<uint32_t>(product >> 64);
+}
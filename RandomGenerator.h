@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "ChaCha20.h"
+
+// Userspace CSPRNG for bulk work: a ChaCha20 keystream keyed from
+// SecureRandom, so a million passwords cost a few syscalls instead of one
+// each. Every refill rekeys from the start of the new block (fast key
+// erasure), so bytes already handed out cannot be recomputed from the state.
+// Not thread-safe, give every thread its own.
+class RandomGenerator
+{
+private:
+	static const size_t BUFFER_SIZE = 4096;
+
+	std::string key;
+	char buffer[BUFFER_SIZE];
+	size_t used; //bytes of buffer handed out or consumed as the next key
+
+	void refill();
+
+public:
+	RandomGenerator();
+	~RandomGenerator();
+
+	RandomGenerator(const RandomGenerator&) = delete;
+	RandomGenerator& operator=(const RandomGenerator&) = delete;
+
+	void fill(void* out, size_t length);
+	uint64_t next64();
+	uint32_t uniform(uint32_t bound); //0 <= result < bound, exactly uniform
+};
@@ -0,0 +1,116 @@
+#include "RekeyBenchmark.h"
+#include "Rekeyer.h"
+#include "ThreadPool.h"
+#include "CeasarCipher.h"
+#include "TextCodeCipher.h"
+#include "HillCipher.h"
+#include <iostream>
+#include <stdexcept>
+#include <chrono>
+#include <memory>
+#include <cstdlib>
+
+RekeyBenchmark::RekeyBenchmark(size_t entryCount) : entryCount(entryCount)
+{
+	if (entryCount == 0)
+	{
+		throw std::invalid_argument("Entry count must be positive.");
+	}
+}
+
+std::vector<PasswordEntry> RekeyBenchmark::makeEntries(Cipher& cipher, const std::string& alphabet, size_t length) const
+{
+	std::vector<PasswordEntry> entries;
+	entries.reserve(entryCount);
+
+	uint64_t state = 0x9E3779B97F4A7C15ULL; // fixed seed, every run rekeys the same vault
+	std::string password(length, ' ');
+	for (size_t i = 0; i < entryCount; ++i)
+	{
+		for (char& c : password)
+		{
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+			c = alphabet[(state >> 33) % alphabet.size()];
+		}
+		entries.emplace_back("bench-" + std::to_string(i) + ".example", "user", cipher.encrypt(password));
+	}
+	return entries;
+}
+
+double RekeyBenchmark::runSequential(const std::vector<PasswordEntry>& entries, const Cipher& from, const Cipher& to)
+{
+	std::unique_ptr<Cipher> oldCipher(from.clone());
+	std::unique_ptr<Cipher> newCipher(to.clone());
+	std::vector<std::string> reencrypted(entries.size());
+
+	auto started = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		std::string plain = oldCipher->decrypt(entries[i].getPassword());
+		reencrypted[i] = newCipher->encrypt(plain);
+		if (newCipher->decrypt(reencrypted[i]) != plain)
+		{
+			throw std::runtime_error("Benchmark passwords do not survive the new cipher.");
+		}
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+double RekeyBenchmark::runParallel(const std::vector<PasswordEntry>& entries, const Cipher& from, const Cipher& to)
+{
+	JobControl control;
+	auto started = std::chrono::steady_clock::now();
+	Rekeyer({ &from }, to).run(entries, control); // generated entries are all generation 0
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+void RekeyBenchmark::runCase(const std::string& label, Cipher& from, Cipher& to, const std::string& alphabet, size_t length) const
+{
+	std::vector<PasswordEntry> entries = makeEntries(from, alphabet, length);
+
+	double sequential = runSequential(entries, from, to);
+	double parallel = runParallel(entries, from, to);
+
+	std::cout << label << ": " << entries.size() << " entries" << std::endl;
+	std::cout << "  sequential: " << sequential << " s, " << (entries.size() / sequential) << " entries/s" << std::endl;
+	std::cout << "  parallel:   " << parallel << " s, " << (entries.size() / parallel) << " entries/s on "
+		<< ThreadPool::shared().size() << " threads (x" << (sequential / parallel) << ")" << std::endl;
+}
+
+void RekeyBenchmark::run() const
+{
+	// Hill keeps only letters and pads to the block size, so those passwords are upper-case and a multiple of 2 long
+	CeasarCipher caesar(3);
+	HillCipher hill(std::vector<std::vector<int>>{ { 3, 3 }, { 2, 5 } });
+	runCase("caesar -> hill", caesar, hill, "ABCDEFGHIJKLMNOPQRSTUVWXYZ", 16);
+
+	// a shift of 1 keeps every pangram character away from the '|' separator
+	TextCodeCipher textCode("The quick brown fox jumps over the lazy dog");
+	CeasarCipher caesarOne(1);
+	runCase("textcode -> caesar", textCode, caesarOne, "Thequickbrownfxjmpsvtlazydg", 16);
+}
+
+int RekeyBenchmark::runFromArguments(const std::vector<std::string>& args)
+{
+	size_t entries = 1000000;
+
+	for (size_t i = 1; i < args.size(); i += 2)
+	{
+		if (args[i] != "--entries" || i + 1 >= args.size())
+		{
+			std::cerr << "Usage: --bench-rekey [--entries N]" << std::endl;
+			return 1;
+		}
+
+		char* end;
+		long value = std::strtol(args[i + 1].c_str(), &end, 10);
+		if (*end != '\0' || value <= 0)
+		{
+			throw std::invalid_argument("Invalid value for " + args[i] + ": " + args[i + 1]);
+		}
+		entries = static_cast<size_t>(value);
+	}
+
+	RekeyBenchmark(entries).run();
+	return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Cipher.h"
+#include "PasswordEntry.h"
+
+// Measures rekey throughput on a synthetic vault: a plain single-threaded
+// loop against Rekeyer on the shared pool, for Caesar->Hill and TextCode->Caesar.
+class RekeyBenchmark
+{
+private:
+	size_t entryCount;
+
+	std::vector<PasswordEntry> makeEntries(Cipher& cipher, const std::string& alphabet, size_t length) const;
+	static double runSequential(const std::vector<PasswordEntry>& entries, const Cipher& from, const Cipher& to);
+	static double runParallel(const std::vector<PasswordEntry>& entries, const Cipher& from, const Cipher& to);
+	void runCase(const std::string& label, Cipher& from, Cipher& to, const std::string& alphabet, size_t length) const;
+
+public:
+	explicit RekeyBenchmark(size_t entryCount);
+
+	void run() const;
+
+	// --bench-rekey [--entries N]
+	static int runFromArguments(const std::vector<std::string>& args);
+};
@@ -0,0 +1,79 @@
+#include "Rekeyer.h"
+#include "ThreadPool.h"
+#include <stdexcept>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+
+Rekeyer::Rekeyer(const std::vector<const Cipher*>& from, const Cipher& to) : from(from), to(to) {}
+
+bool Rekeyer::encryptLossless(Cipher& cipher, const std::string& plainText, std::string& encrypted)
+{
+	try
+	{
+		encrypted = cipher.encrypt(plainText);
+		return !encrypted.empty() && encrypted.find('\n') == std::string::npos
+			&& cipher.decrypt(encrypted) == plainText;
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+}
+
+std::vector<std::string> Rekeyer::run(const std::vector<PasswordEntry>& entries, JobControl& control) const
+{
+	std::vector<std::string> reencrypted(entries.size());
+	std::atomic<size_t> unrepresentable(0);
+	std::atomic<size_t> firstBad(entries.size());
+
+	const size_t taskCount = (entries.size() + ENTRIES_PER_TASK - 1) / ENTRIES_PER_TASK;
+	ThreadPool::shared().parallelFor(taskCount, [&](size_t task)
+	{
+		control.checkpoint();
+
+		// ciphers are not required to be thread-safe, every task clones the ones it needs
+		std::vector<std::unique_ptr<Cipher>> oldCiphers(from.size());
+		std::unique_ptr<Cipher> newCipher(to.clone());
+
+		size_t begin = task * ENTRIES_PER_TASK;
+		size_t end = std::min(begin + ENTRIES_PER_TASK, entries.size());
+		uint64_t bytes = 0;
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			unsigned generation = entries[i].getGeneration();
+			if (generation >= from.size() || from[generation] == nullptr)
+			{
+				throw std::runtime_error("No cipher for generation " + std::to_string(generation) + ".");
+			}
+			if (!oldCiphers[generation])
+			{
+				oldCiphers[generation].reset(from[generation]->clone());
+			}
+
+			std::string plain = oldCiphers[generation]->decrypt(entries[i].getPassword());
+			if (!encryptLossless(*newCipher, plain, reencrypted[i]))
+			{
+				unrepresentable.fetch_add(1);
+				size_t seen = firstBad.load();
+				while (i < seen && !firstBad.compare_exchange_weak(seen, i))
+				{
+				}
+				continue;
+			}
+			bytes += plain.size();
+		}
+
+		control.addEntries(end - begin);
+		control.addBytes(bytes);
+	});
+
+	if (unrepresentable.load() > 0)
+	{
+		const PasswordEntry& example = entries[firstBad.load()];
+		throw std::runtime_error(std::to_string(unrepresentable.load()) + " password(s) cannot be stored by the new cipher "
+			"without loss (first: " + example.getUsername() + "@" + example.getWebsite() + "). Nothing was changed.");
+	}
+	return reencrypted;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Cipher.h"
+#include "PasswordEntry.h"
+#include "JobControl.h"
+
+// Re-encrypts every password to one cipher across the shared pool. Each entry
+// is decrypted with the cipher of its generation (see PasswordManager), and every
+// result is decrypted again and compared, because some ciphers cannot represent
+// every password (Hill keeps only letters). Nothing is changed here; the caller
+// swaps the results in.
+class Rekeyer
+{
+private:
+	std::vector<const Cipher*> from; //indexed by entry generation, nullptr for generations no entry uses
+	const Cipher& to;
+
+	static const size_t ENTRIES_PER_TASK = 4096;
+
+public:
+	Rekeyer(const std::vector<const Cipher*>& from, const Cipher& to);
+
+	std::vector<std::string> run(const std::vector<PasswordEntry>& entries, JobControl& control) const;
+
+	// false when the result would not decrypt back to plainText or would break the vault's line format
+	static bool encryptLossless(Cipher& cipher, const std::string& plainText, std::string& encrypted);
+};
@@ -0,0 +1,235 @@
+#include "RoaringBitmap.h"
+#include <algorithm>
+
+void RoaringBitmap::Container::toBitset()
+{
+	bits.assign(BITSET_WORDS, 0);
+	for (uint16_t low : array)
+	{
+		bits[low >> 6] |= uint64_t(1) << (low & 63);
+	}
+	array.clear();
+	array.shrink_to_fit();
+}
+
+void RoaringBitmap::Container::toArray()
+{
+	array.clear();
+	array.reserve(cardinality);
+	for (size_t word = 0; word < bits.size(); ++word)
+	{
+		for (uint64_t w = bits[word]; w != 0; w &= w - 1)
+		{
+			array.push_back(static_cast<uint16_t>(word * 64 + __builtin_ctzll(w)));
+		}
+	}
+	bits.clear();
+	bits.shrink_to_fit();
+}
+
+std::vector<RoaringBitmap::Container>::iterator RoaringBitmap::find(uint16_t key)
+{
+	return std::lower_bound(containers.begin(), containers.end(), key, [](const Container& c, uint16_t k) { return c.key < k; });
+}
+
+std::vector<RoaringBitmap::Container>::const_iterator RoaringBitmap::find(uint16_t key) const
+{
+	return std::lower_bound(containers.begin(), containers.end(), key, [](const Container& c, uint16_t k) { return c.key < k; });
+}
+
+void RoaringBitmap::add(uint32_t id)
+{
+	uint16_t key = static_cast<uint16_t>(id >> 16);
+	uint16_t low = static_cast<uint16_t>(id);
+
+	// ids mostly arrive in increasing order, so the last container is tried first
+	auto container = !containers.empty() && containers.back().key == key ? containers.end() - 1 : find(key);
+	if (container == containers.end() || container->key != key)
+	{
+		container = containers.insert(container, Container{ key, {}, {}, 0 });
+	}
+
+	if (container->isBitset())
+	{
+		uint64_t& word = container->bits[low >> 6];
+		uint64_t bit = uint64_t(1) << (low & 63);
+		if (!(word & bit))
+		{
+			word |= bit;
+			++container->cardinality;
+		}
+		return;
+	}
+
+	std::vector<uint16_t>& array = container->array;
+	auto position = !array.empty() && array.back() < low ? array.end() : std::lower_bound(array.begin(), array.end(), low);
+	if (position != array.end() && *position == low)
+	{
+		return;
+	}
+	array.insert(position, low);
+	if (++container->cardinality > ARRAY_LIMIT)
+	{
+		container->toBitset();
+	}
+}
+
+bool RoaringBitmap::remove(uint32_t id)
+{
+	auto container = find(static_cast<uint16_t>(id >> 16));
+	if (container == containers.end() || container->key != static_cast<uint16_t>(id >> 16))
+	{
+		return false;
+	}
+
+	uint16_t low = static_cast<uint16_t>(id);
+	if (container->isBitset())
+	{
+		uint64_t& word = container->bits[low >> 6];
+		uint64_t bit = uint64_t(1) << (low & 63);
+		if (!(word & bit))
+		{
+			return false;
+		}
+		word &= ~bit;
+		if (--container->cardinality <= ARRAY_LIMIT)
+		{
+			container->toArray();
+		}
+	}
+	else
+	{
+		auto position = std::lower_bound(container->array.begin(), container->array.end(), low);
+		if (position == container->array.end() || *position != low)
+		{
+			return false;
+		}
+		container->array.erase(position);
+		--container->cardinality;
+	}
+
+	if (container->cardinality == 0)
+	{
+		containers.erase(container);
+	}
+	return true;
+}
+
+bool RoaringBitmap::contains(uint32_t id) const
+{
+	auto container = find(static_cast<uint16_t>(id >> 16));
+	if (container == containers.end() || container->key != static_cast<uint16_t>(id >> 16))
+	{
+		return false;
+	}
+	uint16_t low = static_cast<uint16_t>(id);
+	if (container->isBitset())
+	{
+		return (container->bits[low >> 6] >> (low & 63)) & 1;
+	}
+	return std::binary_search(container->array.begin(), container->array.end(), low);
+}
+
+size_t RoaringBitmap::cardinality() const
+{
+	size_t total = 0;
+	for (const Container& container : containers)
+	{
+		total += container.cardinality;
+	}
+	return total;
+}
+
+bool RoaringBitmap::intersect(const Container& a, const Container& b, Container& out)
+{
+	out = Container{ a.key, {}, {}, 0 };
+	if (a.isBitset() && b.isBitset())
+	{
+		out.bits.resize(BITSET_WORDS);
+		for (size_t i = 0; i < BITSET_WORDS; ++i)
+		{
+			out.bits[i] = a.bits[i] & b.bits[i];
+			out.cardinality += static_cast<uint32_t>(__builtin_popcountll(out.bits[i]));
+		}
+		if (out.cardinality <= ARRAY_LIMIT)
+		{
+			out.toArray();
+		}
+	}
+	else if (a.isBitset() || b.isBitset())
+	{
+		const Container& sparse = a.isBitset() ? b : a;
+		const Container& dense = a.isBitset() ? a : b;
+		for (uint16_t low : sparse.array)
+		{
+			if ((dense.bits[low >> 6] >> (low & 63)) & 1)
+			{
+				out.array.push_back(low);
+			}
+		}
+		out.cardinality = static_cast<uint32_t>(out.array.size());
+	}
+	else
+	{
+		std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(out.array));
+		out.cardinality = static_cast<uint32_t>(out.array.size());
+	}
+	return out.cardinality > 0;
+}
+
+RoaringBitmap RoaringBitmap::intersect(const RoaringBitmap& a, const RoaringBitmap& b)
+{
+	RoaringBitmap result;
+	auto i = a.containers.begin();
+	auto j = b.containers.begin();
+	while (i != a.containers.end() && j != b.containers.end())
+	{
+		if (i->key < j->key)
+		{
+			++i;
+		}
+		else if (j->key < i->key)
+		{
+			++j;
+		}
+		else
+		{
+			Container both;
+			if (intersect(*i, *j, both))
+			{
+				result.containers.push_back(std::move(both));
+			}
+			++i;
+			++j;
+		}
+	}
+	return result;
+}
+
+std::vector<uint32_t> RoaringBitmap::toVector() const
+{
+	std::vector<uint32_t> ids;
+	ids.reserve(cardinality());
+	for (const Container& container : containers)
+	{
+		uint32_t high = static_cast<uint32_t>(container.key) << 16;
+		if (container.isBitset())
+		{
+			for (size_t word = 0; word < container.bits.size(); ++word)
+			{
+				for (uint64_t w = container.bits[word]; w != 0; w &= w - 1)
+				{
+					ids.push_back(high | static_cast<uint32_t>(word * 64 + __builtin_ctzll(w)));
+				}
+			}
+		}
+		else
+		{
+			for (uint16_t low : container.array)
+			{
+				ids.push_back(high | low);
+			}
+		}
+	}
+	return ids;
+}
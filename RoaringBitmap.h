@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Compressed set of 32-bit ids in the style of Roaring bitmaps: ids are
+// grouped by their high 16 bits, and each group is a sorted array of the low
+// halves while it holds up to ARRAY_LIMIT of them (8 KiB at most), or a
+// 65536-bit bitset beyond that. Sparse sets stay small, dense ones intersect
+// 64 ids per AND.
+class RoaringBitmap
+{
+private:
+	struct Container
+	{
+		uint16_t key; //high 16 bits shared by its ids
+		std::vector<uint16_t> array; //sorted low halves, while not a bitset
+		std::vector<uint64_t> bits; //BITSET_WORDS words once more than ARRAY_LIMIT ids
+		uint32_t cardinality;
+
+		bool isBitset() const { return !bits.empty(); }
+		void toBitset();
+		void toArray();
+	};
+
+	std::vector<Container> containers; //sorted by key
+
+	static const size_t ARRAY_LIMIT = 4096;
+	static const size_t BITSET_WORDS = 65536 / 64;
+
+	std::vector<Container>::iterator find(uint16_t key);
+	std::vector<Container>::const_iterator find(uint16_t key) const;
+	static bool intersect(const Container& a, const Container& b, Container& out); //false if empty
+
+public:
+	void add(uint32_t id);
+	bool remove(uint32_t id); //false if it was not there
+	bool contains(uint32_t id) const;
+	size_t cardinality() const;
+	bool empty() const { return containers.empty(); }
+	void clear() { containers.clear(); }
+
+	static RoaringBitmap intersect(const RoaringBitmap& a, const RoaringBitmap& b);
+	std::vector<uint32_t> toVector() const; //ascending
+};
@@ -0,0 +1,263 @@
+#include "SearchIndex.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+	// trigrams of an already lower-cased text, each once
+	void trigramsOf(const std::string& text, std::vector<uint32_t>& out)
+	{
+		out.clear();
+		for (size_t i = 0; i + 3 <= text.size(); ++i)
+		{
+			out.push_back(static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16
+				| static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8
+				| static_cast<unsigned char>(text[i + 2]));
+		}
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+	}
+}
+
+std::string SearchIndex::lowered(const std::string& text)
+{
+	std::string result = text;
+	for (char& c : result)
+	{
+		if (c >= 'A' && c <= 'Z')
+		{
+			c = static_cast<char>(c + ('a' - 'A'));
+		}
+	}
+	return result;
+}
+
+void SearchIndex::index(uint32_t id)
+{
+	std::vector<uint32_t> trigrams;
+	trigramsOf(lowered(keys[id]), trigrams);
+	for (uint32_t trigram : trigrams)
+	{
+		postings[trigram].push_back(id);
+	}
+}
+
+void SearchIndex::build(const std::vector<PasswordEntry>& entries)
+{
+	clear();
+	keys.reserve(entries.size());
+	ids.reserve(entries.size());
+	for (const PasswordEntry& entry : entries)
+	{
+		ids.push_back(static_cast<uint32_t>(keys.size()));
+		keys.push_back(entry.getWebsite() + '\n' + entry.getUsername());
+	}
+
+	// 1. every task indexes a range of ids on its own
+	ThreadPool& pool = ThreadPool::shared();
+	const size_t taskCount = (keys.size() + ENTRIES_PER_TASK - 1) / ENTRIES_PER_TASK;
+	std::vector<std::unordered_map<uint32_t, std::vector<uint32_t>>> partial(taskCount);
+	pool.parallelFor(taskCount, [this, &partial](size_t task)
+	{
+		std::vector<uint32_t> trigrams;
+		size_t end = std::min(keys.size(), (task + 1) * ENTRIES_PER_TASK);
+		for (size_t id = task * ENTRIES_PER_TASK; id < end; ++id)
+		{
+			trigramsOf(lowered(keys[id]), trigrams);
+			for (uint32_t trigram : trigrams)
+			{
+				partial[task][trigram].push_back(static_cast<uint32_t>(id));
+			}
+		}
+	});
+
+	// 2. lists of a trigram joined in task order stay sorted; each shard of trigrams is joined by one task
+	const size_t shardCount = std::max<size_t>(1, pool.size() * 4);
+	std::vector<std::unordered_map<uint32_t, std::vector<uint32_t>>> shards(shardCount);
+	pool.parallelFor(shardCount, [&partial, &shards, shardCount](size_t shard)
+	{
+		for (auto& ranges : partial)
+		{
+			for (auto& list : ranges)
+			{
+				if (list.first % shardCount == shard)
+				{
+					std::vector<uint32_t>& joined = shards[shard][list.first];
+					joined.insert(joined.end(), list.second.begin(), list.second.end());
+				}
+			}
+		}
+	});
+
+	size_t trigramCount = 0;
+	for (const auto& shard : shards)
+	{
+		trigramCount += shard.size();
+	}
+	postings.reserve(trigramCount);
+	for (auto& shard : shards)
+	{
+		for (auto& list : shard)
+		{
+			postings.emplace(list.first, std::move(list.second));
+		}
+	}
+}
+
+void SearchIndex::clear()
+{
+	keys.clear();
+	ids.clear();
+	postings.clear();
+	dead = 0;
+}
+
+void SearchIndex::append(const PasswordEntry& entry)
+{
+	uint32_t id = static_cast<uint32_t>(keys.size());
+	keys.push_back(entry.getWebsite() + '\n' + entry.getUsername());
+	ids.push_back(id);
+	index(id);
+}
+
+void SearchIndex::remove(size_t position)
+{
+	remove(std::vector<size_t>{ position });
+}
+
+void SearchIndex::remove(const std::vector<size_t>& positions)
+{
+	size_t next = 0;
+	size_t kept = 0;
+	for (size_t position = 0; position < ids.size(); ++position)
+	{
+		if (next < positions.size() && positions[next] == position)
+		{
+			keys[ids[position]].clear(); // the posting lists keep the id until the next rebuild
+			++dead;
+			++next;
+		}
+		else
+		{
+			ids[kept++] = ids[position];
+		}
+	}
+	ids.resize(kept);
+
+	if (dead > ids.size() && dead > 1024)
+	{
+		rebuild();
+	}
+}
+
+void SearchIndex::rebuild()
+{
+	std::vector<std::string> live;
+	live.reserve(ids.size());
+	for (uint32_t id : ids)
+	{
+		live.push_back(std::move(keys[id]));
+	}
+
+	keys.swap(live);
+	postings.clear();
+	dead = 0;
+	for (uint32_t id = 0; id < keys.size(); ++id)
+	{
+		ids[id] = id;
+		index(id);
+	}
+}
+
+void SearchIndex::intersect(std::vector<uint32_t>& candidates, const std::vector<uint32_t>& list)
+{
+	// galloping: candidates is the shorter list, each one is searched for from where the last one was found
+	size_t kept = 0;
+	auto from = list.begin();
+	for (uint32_t id : candidates)
+	{
+		size_t step = 1;
+		auto bound = from;
+		while (bound != list.end() && *bound < id)
+		{
+			from = bound;
+			bound = static_cast<size_t>(list.end() - bound) > step ? bound + step : list.end();
+			step *= 2;
+		}
+		from = std::lower_bound(from, bound, id);
+		if (from != list.end() && *from == id)
+		{
+			candidates[kept++] = id;
+		}
+	}
+	candidates.resize(kept);
+}
+
+std::vector<SearchIndex::Match> SearchIndex::search(const std::string& text, size_t limit, size_t& total) const
+{
+	std::string query = lowered(text);
+	std::vector<Match> matches;
+	total = 0;
+	if (query.empty())
+	{
+		return matches;
+	}
+
+	auto check = [this, &query, &matches, &total, limit](uint32_t id)
+	{
+		const std::string& key = keys[id];
+		auto found = std::search(key.begin(), key.end(), query.begin(), query.end(), [](char a, char b)
+		{
+			return (a >= 'A' && a <= 'Z' ? static_cast<char>(a + ('a' - 'A')) : a) == b;
+		});
+		if (!key.empty() && found != key.end())
+		{
+			if (matches.size() < limit)
+			{
+				size_t newline = key.find('\n');
+				matches.push_back(Match{ key.substr(0, newline), key.substr(newline + 1) });
+			}
+			++total;
+		}
+	};
+
+	std::vector<uint32_t> trigrams;
+	trigramsOf(query, trigrams);
+	if (trigrams.empty())
+	{
+		// shorter than a trigram: no list to start from, check every live entry
+		for (uint32_t id : ids)
+		{
+			check(id);
+		}
+		return matches;
+	}
+
+	std::vector<const std::vector<uint32_t>*> lists;
+	for (uint32_t trigram : trigrams)
+	{
+		auto found = postings.find(trigram);
+		if (found == postings.end())
+		{
+			return matches;
+		}
+		lists.push_back(&found->second);
+	}
+	std::sort(lists.begin(), lists.end(), [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b)
+	{
+		return a->size() < b->size();
+	});
+
+	std::vector<uint32_t> candidates = *lists.front();
+	for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i)
+	{
+		intersect(candidates, *lists[i]);
+	}
+
+	// the trigrams may all occur without the query itself, e.g. "abcXbcd" for "abcd"
+	for (uint32_t id : candidates)
+	{
+		check(id);
+	}
+	return matches;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "PasswordEntry.h"
+
+// Case-insensitive substring search over websites and usernames, behind the
+// 'search' command. Every entry gets an id in vault order and every trigram
+// of its lower-cased "website\nusername" a posting list of ids, so a query
+// intersects the lists of its own trigrams (smallest first, galloping) and
+// only checks the few survivors. Ids only grow, which keeps every list sorted
+// as entries are appended; a removed entry is only marked dead until dead
+// ones outnumber the rest and the index is rebuilt.
+//
+// Like VaultChunks, the index follows the positions of PasswordManager's
+// entries: append() after pushing an entry, remove() before erasing one.
+class SearchIndex
+{
+public:
+	struct Match
+	{
+		std::string website;
+		std::string username;
+	};
+
+private:
+	std::vector<std::string> keys; //"website\nusername" per id, empty once removed
+	std::vector<uint32_t> ids; //id of the entry at each vault position
+	size_t dead;
+	std::unordered_map<uint32_t, std::vector<uint32_t>> postings; //trigram -> ids
+
+	static const size_t ENTRIES_PER_TASK = 65536;
+
+	void index(uint32_t id);
+	void rebuild(); //drops dead ids and renumbers the rest
+	static std::string lowered(const std::string& text);
+	static void intersect(std::vector<uint32_t>& candidates, const std::vector<uint32_t>& list);
+
+public:
+	SearchIndex() : dead(0) {}
+
+	void build(const std::vector<PasswordEntry>& entries); //in parallel on the shared pool
+	void clear();
+	void append(const PasswordEntry& entry);
+	void remove(size_t position);
+	void remove(const std::vector<size_t>& positions); //ascending, all at once
+
+	// matches in vault order, at most limit of them; total counts them all
+	std::vector<Match> search(const std::string& text, size_t limit, size_t& total) const;
+	size_t size() const { return ids.size(); }
+};
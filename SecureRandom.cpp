@@ -0,0 +1,61 @@
+#include "SecureRandom.h"
+#include <stdexcept>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/random.h>
+
+void SecureRandom::fill(void* buffer, size_t length)
+{
+	unsigned char* out = static_cast<unsigned char*>(buffer);
+	size_t done = 0;
+
+	while (done < length)
+	{
+		ssize_t got = getrandom(out + done, length - done, 0);
+		if (got < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == ENOSYS)
+			{
+				break; // old kernel, use the device below
+			}
+			throw std::runtime_error("Cannot get random bytes from the kernel.");
+		}
+		done += static_cast<size_t>(got);
+	}
+
+	if (done < length)
+	{
+		int fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			throw std::runtime_error("Cannot open /dev/urandom.");
+		}
+		while (done < length)
+		{
+			ssize_t got = ::read(fd, out + done, length - done);
+			if (got <= 0)
+			{
+				if (got < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				::close(fd);
+				throw std::runtime_error("Cannot read /dev/urandom.");
+			}
+			done += static_cast<size_t>(got);
+		}
+		::close(fd);
+	}
+}
+
+std::string SecureRandom::bytes(size_t length)
+{
+	std::string result(length, '\0');
+	fill(&result[0], length);
+	return result;
+}
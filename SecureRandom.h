@@ -0,0 +1,11 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Cryptographically secure bytes from the kernel (getrandom, /dev/urandom as a fallback).
+class SecureRandom
+{
+public:
+	static void fill(void* buffer, size_t length);
+	static std::string bytes(size_t length);
+};
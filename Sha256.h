@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// SHA-256 (FIPS 180-4). Feed data with update(), then take the 32-byte digest.
+class Sha256
+{
+private:
+	uint32_t state[8];
+	unsigned char block[64];
+	size_t blockLength; //bytes waiting in block
+	uint64_t totalLength; //bytes hashed so far
+
+	void compress(const unsigned char* data);
+
+public:
+	static const size_t DIGEST_SIZE = 32;
+	static const size_t BLOCK_SIZE = 64;
+
+	Sha256();
+
+	void update(const void* data, size_t length);
+	void update(const std::string& data) { update(data.data(), data.size()); }
+	std::string digest(); //the object must not be updated afterwards
+
+	static std::string hash(const std::string& data);
+};
@@ -0,0 +1,359 @@
+#include "SortedIndex.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <string_view>
+
+namespace
+{
+	std::string_view websiteOf(const std::string& key)
+	{
+		return std::string_view(key).substr(0, key.find('\n'));
+	}
+
+	std::string_view usernameOf(const std::string& key)
+	{
+		size_t newline = key.find('\n');
+		return newline == std::string::npos ? std::string_view() : std::string_view(key).substr(newline + 1);
+	}
+}
+
+bool SortedIndex::less(Order order, const std::string& a, const std::string& b) const
+{
+	if (order == BY_WEBSITE)
+	{
+		return a < b; // '\n' ends the website, and no website holds one
+	}
+
+	// as if comparing "username\nwebsite", the order prefixOf() assumes
+	std::string_view userA = usernameOf(a);
+	std::string_view userB = usernameOf(b);
+	size_t common = std::min(userA.size(), userB.size());
+	int byUser = userA.substr(0, common).compare(userB.substr(0, common));
+	if (byUser != 0)
+	{
+		return byUser < 0;
+	}
+	if (userA.size() != userB.size())
+	{
+		return userA.size() < userB.size() ? '\n' < static_cast<unsigned char>(userB[common]) : static_cast<unsigned char>(userA[common]) < '\n';
+	}
+	return websiteOf(a) < websiteOf(b);
+}
+
+uint64_t SortedIndex::prefixOf(Order order, const std::string& key)
+{
+	// the first 8 bytes of the key in this order, big-endian, so most comparisons while sorting are one integer compare
+	std::string_view first = order == BY_WEBSITE ? std::string_view(key) : usernameOf(key);
+	std::string_view second = order == BY_WEBSITE ? std::string_view() : websiteOf(key);
+	uint64_t prefix = 0;
+	size_t length = 0;
+	auto push = [&prefix, &length](unsigned char c)
+	{
+		if (length < 8)
+		{
+			prefix |= static_cast<uint64_t>(c) << (56 - 8 * length++);
+		}
+	};
+	for (size_t i = 0; i < first.size() && length < 8; ++i)
+	{
+		push(static_cast<unsigned char>(first[i]));
+	}
+	if (order == BY_USERNAME)
+	{
+		push('\n');
+		for (size_t i = 0; i < second.size() && length < 8; ++i)
+		{
+			push(static_cast<unsigned char>(second[i]));
+		}
+	}
+	return prefix;
+}
+
+void SortedIndex::sortIds(Order order, std::vector<uint32_t>& sorted) const
+{
+	std::vector<std::pair<uint64_t, uint32_t>> items(sorted.size());
+	auto before = [this, order](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b)
+	{
+		return a.first != b.first ? a.first < b.first : less(order, keys[a.second], keys[b.second]);
+	};
+
+	// sorted runs in parallel on the shared pool, then merged pairwise
+	ThreadPool& pool = ThreadPool::shared();
+	const size_t runCount = std::max<size_t>(1, std::min(pool.size(), (sorted.size() + IDS_PER_TASK - 1) / IDS_PER_TASK));
+	const size_t runLength = (sorted.size() + runCount - 1) / runCount;
+	pool.parallelFor(runCount, [this, order, &items, &sorted, &before, runLength](size_t run)
+	{
+		size_t begin = std::min(sorted.size(), run * runLength);
+		size_t end = std::min(sorted.size(), begin + runLength);
+		for (size_t i = begin; i < end; ++i)
+		{
+			items[i] = std::make_pair(prefixOf(order, keys[sorted[i]]), sorted[i]);
+		}
+		std::sort(items.begin() + begin, items.begin() + end, before);
+	});
+	for (size_t width = runLength; width < items.size(); width *= 2)
+	{
+		const size_t merges = (items.size() + 2 * width - 1) / (2 * width);
+		pool.parallelFor(merges, [&items, &before, width](size_t merge)
+		{
+			size_t begin = merge * 2 * width;
+			size_t middle = std::min(items.size(), begin + width);
+			size_t end = std::min(items.size(), begin + 2 * width);
+			std::inplace_merge(items.begin() + begin, items.begin() + middle, items.begin() + end, before);
+		});
+	}
+
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		sorted[i] = items[i].second;
+	}
+}
+
+void SortedIndex::build(const std::vector<PasswordEntry>& entries)
+{
+	clear();
+	keys.reserve(entries.size());
+	ids.reserve(entries.size());
+	for (const PasswordEntry& entry : entries)
+	{
+		ids.push_back(static_cast<uint32_t>(keys.size()));
+		keys.push_back(keyOf(entry.getWebsite(), entry.getUsername()));
+	}
+
+	for (Order order : { BY_WEBSITE, BY_USERNAME })
+	{
+		std::vector<uint32_t> sorted(ids);
+		sortIds(order, sorted);
+
+		// blocks start three quarters full so appends in the middle rarely split
+		const size_t fill = MAX_BLOCK * 3 / 4;
+		for (size_t begin = 0; begin < sorted.size(); begin += fill)
+		{
+			blocks[order].emplace_back(sorted.begin() + begin, sorted.begin() + std::min(sorted.size(), begin + fill));
+		}
+	}
+}
+
+void SortedIndex::clear()
+{
+	keys.clear();
+	ids.clear();
+	dead = 0;
+	blocks[BY_WEBSITE].clear();
+	blocks[BY_USERNAME].clear();
+}
+
+void SortedIndex::locate(Order order, const std::string& key, size_t& block, size_t& offset) const
+{
+	const std::vector<std::vector<uint32_t>>& list = blocks[order];
+	auto found = std::lower_bound(list.begin(), list.end(), key, [this, order](const std::vector<uint32_t>& b, const std::string& k)
+	{
+		return less(order, keys[b.back()], k);
+	});
+	block = static_cast<size_t>(found - list.begin());
+	offset = 0;
+	if (found != list.end())
+	{
+		offset = static_cast<size_t>(std::lower_bound(found->begin(), found->end(), key, [this, order](uint32_t id, const std::string& k)
+		{
+			return less(order, keys[id], k);
+		}) - found->begin());
+	}
+}
+
+void SortedIndex::insert(Order order, uint32_t id)
+{
+	std::vector<std::vector<uint32_t>>& list = blocks[order];
+	size_t block, offset;
+	locate(order, keys[id], block, offset);
+	if (block == list.size())
+	{
+		if (list.empty() || list.back().size() >= MAX_BLOCK)
+		{
+			list.emplace_back();
+		}
+		block = list.size() - 1;
+		offset = list[block].size();
+	}
+
+	std::vector<uint32_t>& target = list[block];
+	target.insert(target.begin() + offset, id);
+	if (target.size() > MAX_BLOCK)
+	{
+		std::vector<uint32_t> upper(target.begin() + target.size() / 2, target.end());
+		target.resize(target.size() / 2);
+		list.insert(list.begin() + block + 1, std::move(upper));
+	}
+}
+
+void SortedIndex::erase(Order order, uint32_t id)
+{
+	std::vector<std::vector<uint32_t>>& list = blocks[order];
+	size_t block, offset;
+	locate(order, keys[id], block, offset);
+	if (block == list.size() || offset == list[block].size() || list[block][offset] != id)
+	{
+		return;
+	}
+	list[block].erase(list[block].begin() + offset);
+	if (list[block].empty())
+	{
+		list.erase(list.begin() + block);
+	}
+}
+
+void SortedIndex::append(const PasswordEntry& entry)
+{
+	uint32_t id = static_cast<uint32_t>(keys.size());
+	keys.push_back(keyOf(entry.getWebsite(), entry.getUsername()));
+	ids.push_back(id);
+	insert(BY_WEBSITE, id);
+	insert(BY_USERNAME, id);
+}
+
+void SortedIndex::remove(size_t position)
+{
+	uint32_t id = ids[position];
+	erase(BY_WEBSITE, id);
+	erase(BY_USERNAME, id);
+	keys[id].clear();
+	keys[id].shrink_to_fit();
+	ids.erase(ids.begin() + position);
+	++dead;
+	if (dead > ids.size() && dead > 1024)
+	{
+		rebuild();
+	}
+}
+
+void SortedIndex::remove(const std::vector<size_t>& positions)
+{
+	if (positions.empty())
+	{
+		return;
+	}
+
+	size_t kept = positions[0];
+	size_t next = 0;
+	for (size_t position = positions[0]; position < ids.size(); ++position)
+	{
+		if (next < positions.size() && positions[next] == position)
+		{
+			erase(BY_WEBSITE, ids[position]);
+			erase(BY_USERNAME, ids[position]);
+			keys[ids[position]].clear();
+			keys[ids[position]].shrink_to_fit();
+			++next;
+		}
+		else
+		{
+			ids[kept++] = ids[position];
+		}
+	}
+	ids.resize(kept);
+	dead += positions.size();
+	if (dead > ids.size() && dead > 1024)
+	{
+		rebuild();
+	}
+}
+
+void SortedIndex::rebuild()
+{
+	// the orders stay as they are, only the ids change
+	std::vector<uint32_t> renumbered(keys.size(), 0);
+	std::vector<std::string> liveKeys;
+	liveKeys.reserve(ids.size());
+	for (size_t position = 0; position < ids.size(); ++position)
+	{
+		renumbered[ids[position]] = static_cast<uint32_t>(position);
+		liveKeys.push_back(std::move(keys[ids[position]]));
+		ids[position] = static_cast<uint32_t>(position);
+	}
+	keys.swap(liveKeys);
+	dead = 0;
+
+	for (auto& list : blocks)
+	{
+		for (auto& block : list)
+		{
+			for (uint32_t& id : block)
+			{
+				id = renumbered[id];
+			}
+		}
+	}
+}
+
+std::vector<size_t> SortedIndex::page(Order order, const std::string& sitePrefix, const std::string& after, size_t limit,
+	const std::vector<size_t>* only, bool& more) const
+{
+	std::vector<size_t> positions;
+	more = false;
+	auto hasPrefix = [&sitePrefix](const std::string& key) { return key.compare(0, sitePrefix.size(), sitePrefix) == 0 && key.find('\n') >= sitePrefix.size(); };
+	auto positionOf = [this](uint32_t id) { return static_cast<size_t>(std::lower_bound(ids.begin(), ids.end(), id) - ids.begin()); };
+
+	// a few allowed entries are cheaper to sort on their own than to find along the whole order
+	if (only && only->size() * 64 < ids.size())
+	{
+		std::vector<uint32_t> candidates;
+		for (size_t position : *only)
+		{
+			const std::string& key = keys[ids[position]];
+			if (hasPrefix(key) && (after.empty() || less(order, after, key)))
+			{
+				candidates.push_back(ids[position]);
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [this, order](uint32_t a, uint32_t b) { return less(order, keys[a], keys[b]); });
+		more = candidates.size() > limit;
+		candidates.resize(std::min(candidates.size(), limit));
+		for (uint32_t id : candidates)
+		{
+			positions.push_back(positionOf(id));
+		}
+		return positions;
+	}
+
+	// start right after the cursor, or at the prefix when that comes later
+	const std::vector<std::vector<uint32_t>>& list = blocks[order];
+	size_t block = 0;
+	size_t offset = 0;
+	std::string start = order == BY_WEBSITE && (after.empty() || less(order, after, sitePrefix)) ? sitePrefix : after;
+	if (!start.empty())
+	{
+		locate(order, start, block, offset);
+		if (block < list.size() && offset < list[block].size() && keys[list[block][offset]] == start && start == after)
+		{
+			++offset; // the cursor entry itself was on the previous page
+		}
+	}
+
+	for (; block < list.size(); ++block, offset = 0)
+	{
+		for (; offset < list[block].size(); ++offset)
+		{
+			const std::string& key = keys[list[block][offset]];
+			if (!hasPrefix(key))
+			{
+				if (order == BY_WEBSITE && key.compare(0, sitePrefix.size(), sitePrefix) > 0)
+				{
+					return positions; // past every website with the prefix
+				}
+				continue;
+			}
+			size_t position = positionOf(list[block][offset]);
+			if (only && !std::binary_search(only->begin(), only->end(), position))
+			{
+				continue;
+			}
+			if (positions.size() == limit)
+			{
+				more = true;
+				return positions;
+			}
+			positions.push_back(position);
+		}
+	}
+	return positions;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "PasswordEntry.h"
+
+// Entries ordered by (website, username) and by (username, website), behind
+// 'list'. Each order is a sorted array of entry ids cut into blocks of at
+// most MAX_BLOCK, a two-level B-tree: finding a key is a binary search over
+// the blocks' last keys and one inside a block, an insert or removal moves at
+// most one block, and a page is read straight off consecutive blocks, so
+// listing 50 entries costs O(log n + 50) whatever the vault size.
+//
+// Like SearchIndex, it follows the positions of PasswordManager's entries:
+// append() after pushing an entry, remove() before erasing one. Ids only grow
+// and are renumbered once removed ones outnumber the rest.
+class SortedIndex
+{
+public:
+	enum Order { BY_WEBSITE, BY_USERNAME };
+
+private:
+	std::vector<std::string> keys; //"website\nusername" per id, empty once removed
+	std::vector<uint32_t> ids; //id of the entry at each vault position, increasing
+	size_t dead;
+	std::vector<std::vector<uint32_t>> blocks[2]; //ids in each order
+
+	static const size_t MAX_BLOCK = 512;
+	static const size_t IDS_PER_TASK = 65536;
+
+	bool less(Order order, const std::string& a, const std::string& b) const;
+	static uint64_t prefixOf(Order order, const std::string& key);
+	void sortIds(Order order, std::vector<uint32_t>& sorted) const; //in parallel on the shared pool
+	void insert(Order order, uint32_t id);
+	void erase(Order order, uint32_t id);
+	void rebuild(); //drops removed ids and renumbers the rest
+	void locate(Order order, const std::string& key, size_t& block, size_t& offset) const; //first id not before key
+
+public:
+	SortedIndex() : dead(0) {}
+
+	static std::string keyOf(const std::string& website, const std::string& username) { return website + '\n' + username; }
+
+	void build(const std::vector<PasswordEntry>& entries);
+	void clear();
+	void append(const PasswordEntry& entry);
+	void remove(size_t position);
+	void remove(const std::vector<size_t>& positions); //ascending, all at once
+
+	// Positions of up to limit entries in order, from the first key past
+	// after (empty: from the start) whose website starts with sitePrefix.
+	// only, when given, holds the ascending positions allowed at all. more
+	// tells whether entries are left for another page. The prefix only
+	// narrows the walk in website order; in username order it filters.
+	std::vector<size_t> page(Order order, const std::string& sitePrefix, const std::string& after, size_t limit,
+		const std::vector<size_t>* only, bool& more) const;
+	size_t size() const { return ids.size(); }
+};
@@ -0,0 +1,184 @@
+#include "TagIndex.h"
+#include <algorithm>
+#include <limits>
+
+std::string TagIndex::tagTerm(const std::string& tag)
+{
+	return "#" + tag;
+}
+
+std::string TagIndex::fieldTerm(const std::string& name, const std::string& value)
+{
+	return "=" + name + "\n" + value; //names and values never hold a line break
+}
+
+std::vector<std::string> TagIndex::termsOf(const PasswordEntry& entry)
+{
+	std::vector<std::string> result;
+	for (const std::string& tag : entry.getTags())
+	{
+		result.push_back(tagTerm(tag));
+	}
+	for (const auto& field : entry.getFields())
+	{
+		result.push_back(fieldTerm(field.first, field.second));
+	}
+	return result;
+}
+
+void TagIndex::clear()
+{
+	terms.clear();
+	ids.clear();
+	nextId = 0;
+}
+
+void TagIndex::build(const std::vector<PasswordEntry>& entries)
+{
+	clear();
+	ids.reserve(entries.size());
+	for (const PasswordEntry& entry : entries)
+	{
+		append(entry);
+	}
+}
+
+void TagIndex::renumber()
+{
+	std::vector<uint32_t> oldIds;
+	oldIds.swap(ids);
+	std::unordered_map<std::string, RoaringBitmap> oldTerms;
+	oldTerms.swap(terms);
+
+	ids.resize(oldIds.size());
+	for (size_t position = 0; position < oldIds.size(); ++position)
+	{
+		ids[position] = static_cast<uint32_t>(position);
+	}
+	nextId = static_cast<uint32_t>(oldIds.size());
+
+	for (const auto& term : oldTerms)
+	{
+		RoaringBitmap& renumbered = terms[term.first];
+		for (uint32_t id : term.second.toVector())
+		{
+			renumbered.add(static_cast<uint32_t>(std::lower_bound(oldIds.begin(), oldIds.end(), id) - oldIds.begin()));
+		}
+	}
+}
+
+void TagIndex::append(const PasswordEntry& entry)
+{
+	if (nextId == std::numeric_limits<uint32_t>::max())
+	{
+		renumber();
+	}
+	uint32_t id = nextId++;
+	ids.push_back(id);
+	for (const std::string& term : termsOf(entry))
+	{
+		terms[term].add(id);
+	}
+}
+
+void TagIndex::remove(size_t position, const PasswordEntry& entry)
+{
+	uint32_t id = ids[position];
+	for (const std::string& term : termsOf(entry))
+	{
+		auto found = terms.find(term);
+		if (found != terms.end() && found->second.remove(id) && found->second.empty())
+		{
+			terms.erase(found);
+		}
+	}
+	ids.erase(ids.begin() + position);
+}
+
+void TagIndex::remove(const std::vector<size_t>& positions, const std::vector<PasswordEntry>& entries)
+{
+	if (positions.empty())
+	{
+		return;
+	}
+
+	size_t kept = positions[0];
+	size_t next = 0;
+	for (size_t position = positions[0]; position < ids.size(); ++position)
+	{
+		if (next < positions.size() && positions[next] == position)
+		{
+			for (const std::string& term : termsOf(entries[position]))
+			{
+				auto found = terms.find(term);
+				if (found != terms.end() && found->second.remove(ids[position]) && found->second.empty())
+				{
+					terms.erase(found);
+				}
+			}
+			++next;
+		}
+		else
+		{
+			ids[kept++] = ids[position];
+		}
+	}
+	ids.resize(kept);
+}
+
+void TagIndex::update(size_t position, const PasswordEntry& before, const PasswordEntry& after)
+{
+	uint32_t id = ids[position];
+	for (const std::string& term : termsOf(before))
+	{
+		auto found = terms.find(term);
+		if (found != terms.end() && found->second.remove(id) && found->second.empty())
+		{
+			terms.erase(found);
+		}
+	}
+	for (const std::string& term : termsOf(after))
+	{
+		terms[term].add(id);
+	}
+}
+
+std::vector<size_t> TagIndex::find(const std::vector<std::string>& wanted) const
+{
+	std::vector<size_t> positions;
+	if (wanted.empty())
+	{
+		positions.resize(ids.size());
+		for (size_t position = 0; position < ids.size(); ++position)
+		{
+			positions[position] = position;
+		}
+		return positions;
+	}
+
+	std::vector<const RoaringBitmap*> bitmaps;
+	for (const std::string& term : wanted)
+	{
+		auto found = terms.find(term);
+		if (found == terms.end())
+		{
+			return positions;
+		}
+		bitmaps.push_back(&found->second);
+	}
+	std::sort(bitmaps.begin(), bitmaps.end(), [](const RoaringBitmap* a, const RoaringBitmap* b) { return a->cardinality() < b->cardinality(); });
+
+	RoaringBitmap result = *bitmaps[0];
+	for (size_t i = 1; i < bitmaps.size() && !result.empty(); ++i)
+	{
+		result = RoaringBitmap::intersect(result, *bitmaps[i]);
+	}
+
+	auto searchFrom = ids.begin();
+	for (uint32_t id : result.toVector())
+	{
+		searchFrom = std::lower_bound(searchFrom, ids.end(), id);
+		positions.push_back(static_cast<size_t>(searchFrom - ids.begin()));
+	}
+	return positions;
+}
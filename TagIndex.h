@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "PasswordEntry.h"
+#include "RoaringBitmap.h"
+
+// Inverted index from tags and metadata fields to entries, behind
+// 'list --tag ... --field ...'. Every entry gets an id in vault order and
+// every tag or name=value pair a RoaringBitmap of the ids carrying it, so a
+// query intersects the bitmaps of its terms, smallest first. Ids only grow,
+// so a removed entry simply drops out of its bitmaps and positions are found
+// again by binary search in the increasing id list.
+//
+// Like SearchIndex, it follows the positions of PasswordManager's entries:
+// append() after pushing an entry, remove() before erasing one, and update()
+// when an entry's tags or fields change in place.
+class TagIndex
+{
+private:
+	std::unordered_map<std::string, RoaringBitmap> terms; //term -> ids
+	std::vector<uint32_t> ids; //id of the entry at each vault position, increasing
+	uint32_t nextId;
+
+	static std::vector<std::string> termsOf(const PasswordEntry& entry);
+	void renumber(); //before ids would run out
+
+public:
+	TagIndex() : nextId(0) {}
+
+	static std::string tagTerm(const std::string& tag);
+	static std::string fieldTerm(const std::string& name, const std::string& value);
+
+	void build(const std::vector<PasswordEntry>& entries);
+	void clear();
+	void append(const PasswordEntry& entry);
+	void remove(size_t position, const PasswordEntry& entry);
+	void remove(const std::vector<size_t>& positions, const std::vector<PasswordEntry>& entries); //ascending, all at once
+	void update(size_t position, const PasswordEntry& before, const PasswordEntry& after);
+
+	// positions of the entries carrying every term, ascending; no terms matches everything
+	std::vector<size_t> find(const std::vector<std::string>& wanted) const;
+};
@@ -1,6 +1,15 @@
 ﻿#include "TextCodeCipher.h"
+#include "CipherRegistry.h"
 #include <fstream>
 #include <cstdlib>
+#include <climits>
+
+namespace
+{
+    // the text config of old files is the reference text too
+    const CipherRegistry::Registrar registrar(CipherType{ TextCodeCipher::TYPE_ID, "textcode", "<textfile> | file <path> | text <text>", 1, 2,
+        &TextCodeCipher::fromParams, &TextCodeCipher::decodeConfig, "TextCode", &TextCodeCipher::decodeConfig });
+}
 
 TextCodeCipher::TextCodeCipher(const std::string& text) : referenceText(text) 
 {
@@ -245,4 +254,49 @@ std::string TextCodeCipher::getType() const
 std::string TextCodeCipher::getConfig() const
 {
 	return referenceText;
+}
+std::string TextCodeCipher::encodeConfig() const
+{
+    return referenceText;
+}
+
+std::string TextCodeCipher::getAlphabet() const
+{
+    std::string alphabet;
+    for (const auto& mapping : charToPosition)
+    {
+        if (mapping.first >= 32 && mapping.first <= 126)
+        {
+            alphabet.push_back(mapping.first);
+        }
+    }
+    return alphabet;
+}
+
+Cipher* TextCodeCipher::fromParams(const std::vector<std::string>& params)
+{
+    if (params[0] == "file" && params.size() > 1)
+    {
+        return new TextCodeCipher(params[1], true);
+    }
+    else if (params[0] == "text" && params.size() > 1)
+    {
+        return new TextCodeCipher(params[1], false);
+    }
+    else if (params.size() == 1 && params[0].find("file:") == 0)
+    {
+        return new TextCodeCipher(params[0].substr(5), true);
+    }
+    else if (params.size() == 1 && params[0].find("text:") == 0)
+    {
+        return new TextCodeCipher(params[0].substr(5), false);
+    }
+    else
+    {   // If no specific type is given, treat it as a text code cipher with the provided text
+        return new TextCodeCipher(params.back());
+    }
+}
+Cipher* TextCodeCipher::decodeConfig(const std::string& config)
+{
+    return new TextCodeCipher(config);
 }
\ No newline at end of file
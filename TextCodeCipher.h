@@ -25,7 +25,14 @@ public:
     Cipher* clone() const override;
     std::string getType() const override;
 	virtual std::string getConfig() const override;
+    uint8_t getTypeId() const override { return TYPE_ID; }
+    std::string encodeConfig() const override; //the reference text itself
+    std::string getAlphabet() const override; //printable characters of the reference text
 
     static std::string readTextFromFile(const std::string& filePath);
+
+    static const uint8_t TYPE_ID = 2;
+    static Cipher* fromParams(const std::vector<std::string>& params);
+    static Cipher* decodeConfig(const std::string& config);
 };
 
@@ -0,0 +1,206 @@
+#include "ThreadPool.h"
+#include <stdexcept>
+#include <algorithm>
+
+size_t ThreadPool::defaultThreadCount()
+{
+	unsigned int count = std::thread::hardware_concurrency();
+	return count == 0 ? 1 : count;
+}
+
+thread_local ThreadPool* ThreadPool::currentPool = nullptr;
+thread_local size_t ThreadPool::currentWorker = 0;
+
+ThreadPool::ThreadPool(size_t threadCount) : pendingTasks(0), nextQueue(0), stopping(false)
+{
+	if (threadCount == 0)
+	{
+		threadCount = defaultThreadCount();
+	}
+
+	for (size_t i = 0; i < threadCount; ++i)
+	{
+		queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+	}
+	workers.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; ++i)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	if (!task)
+	{
+		throw std::invalid_argument("Task cannot be empty.");
+	}
+
+	{
+		// counted under the sleep mutex so a worker between its check and wait() cannot miss it
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		if (stopping)
+		{
+			throw std::runtime_error("Thread pool is shutting down.");
+		}
+		pendingTasks.fetch_add(1);
+	}
+
+	size_t target = (currentPool == this) ? currentWorker : nextQueue.fetch_add(1) % queues.size();
+	{
+		std::lock_guard<std::mutex> lock(queues[target]->mutex);
+		queues[target]->tasks.push_back(std::move(task));
+	}
+	taskAvailable.notify_one();
+}
+
+bool ThreadPool::tryRunTask(size_t home)
+{
+	std::function<void()> task;
+
+	{
+		WorkerQueue& own = *queues[home];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+		}
+	}
+
+	for (size_t step = 1; !task && step < queues.size(); ++step)
+	{
+		WorkerQueue& victim = *queues[(home + step) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+		}
+	}
+
+	if (!task)
+	{
+		return false;
+	}
+	pendingTasks.fetch_sub(1);
+
+	// a throwing task must not take the worker down with it
+	try
+	{
+		task();
+	}
+	catch (...)
+	{
+	}
+	return true;
+}
+
+void ThreadPool::workerLoop(size_t index)
+{
+	currentPool = this;
+	currentWorker = index;
+
+	while (true)
+	{
+		if (tryRunTask(index))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		taskAvailable.wait(lock, [this] { return stopping || pendingTasks.load() > 0; });
+
+		// drain whatever is queued before leaving
+		if (stopping && pendingTasks.load() == 0)
+		{
+			return;
+		}
+	}
+}
+
+ThreadPool& ThreadPool::shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	struct Progress
+	{
+		std::atomic<size_t> next;
+		std::atomic<size_t> finished;
+		std::atomic<bool> failed;
+		std::mutex mutex;
+		std::condition_variable allDone;
+		std::exception_ptr error;
+
+		Progress() : next(0), finished(0), failed(false) {}
+	};
+	std::shared_ptr<Progress> progress = std::make_shared<Progress>();
+
+	// helpers that start after the loop is drained find nothing left and only touch progress
+	auto drain = [progress, count, &body]
+	{
+		size_t index;
+		while ((index = progress->next.fetch_add(1)) < count)
+		{
+			// after a failure the remaining items are only counted, not run
+			if (!progress->failed.load(std::memory_order_relaxed))
+			{
+				try
+				{
+					body(index);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(progress->mutex);
+					if (!progress->error)
+					{
+						progress->error = std::current_exception();
+					}
+					progress->failed.store(true);
+				}
+			}
+
+			if (progress->finished.fetch_add(1) + 1 == count)
+			{
+				std::lock_guard<std::mutex> lock(progress->mutex);
+				progress->allDone.notify_all();
+			}
+		}
+	};
+
+	size_t helpers = std::min(workers.size(), count - 1);
+	for (size_t i = 0; i < helpers; ++i)
+	{
+		submit(drain);
+	}
+	drain();
+
+	std::unique_lock<std::mutex> lock(progress->mutex);
+	progress->allDone.wait(lock, [&progress, count] { return progress->finished.load() >= count; });
+	if (progress->error)
+	{
+		std::rethrow_exception(progress->error);
+	}
+}
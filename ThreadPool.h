@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+// Work-stealing pool: every worker owns a deque. Tasks submitted from a worker
+// go to its own deque and are taken newest-first (cache friendly), tasks from
+// outside are spread round-robin. An idle worker steals the oldest task of
+// another worker before it goes to sleep.
+class ThreadPool
+{
+private:
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<std::unique_ptr<WorkerQueue>> queues; //one per worker
+	std::vector<std::thread> workers;
+	std::atomic<size_t> pendingTasks;
+	std::atomic<size_t> nextQueue; //round-robin target for outside submissions
+
+	std::mutex sleepMutex;
+	std::condition_variable taskAvailable;
+	bool stopping;
+
+	static thread_local ThreadPool* currentPool; //pool of the calling worker thread, if any
+	static thread_local size_t currentWorker;
+
+	bool tryRunTask(size_t home); //own deque first, then steal; false when every deque is empty
+	void workerLoop(size_t index);
+
+public:
+	explicit ThreadPool(size_t threadCount = 0); //0 means one worker per hardware thread
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void submit(std::function<void()> task);
+	size_t size() const { return workers.size(); }
+
+	// Runs body(0..count-1) across the pool and waits. Indices are claimed in
+	// increasing order as threads become free, and the calling thread works too,
+	// so this is safe to call from inside a task. The first exception is rethrown.
+	void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+	static size_t defaultThreadCount();
+	static ThreadPool& shared(); //process-wide pool for bulk vault operations
+};
@@ -0,0 +1,552 @@
+#include "VaultChecker.h"
+#include "VaultHeader.h"
+#include "VaultChunks.h"
+#include "ChaCha20.h"
+#include "Crc32c.h"
+#include "PasswordManager.h"
+#include "CipherRegistry.h"
+#include "PasswordHistory.h"
+#include "ThreadPool.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+static bool attributesValid(const std::string& text)
+{
+	PasswordEntry entry("", "", "");
+	try
+	{
+		entry.decodeAttributes(text);
+		return true;
+	}
+	catch (const std::invalid_argument&)
+	{
+		return false;
+	}
+}
+
+VaultChecker::VaultChecker(const std::string& path, const std::string& masterPassword)
+	: path(path), masterPassword(masterPassword) {}
+
+VaultChecker::Metadata VaultChecker::parseMetadata(const char* text, size_t length, size_t& end, std::vector<Damage>& damage)
+{
+	Metadata metadata;
+	metadata.generation = 0;
+	metadata.complete = false;
+
+	std::string type, config;
+	std::vector<std::pair<unsigned, std::pair<std::string, std::string>>> legacy; //generation, type, config
+
+	end = length;
+	size_t lineStart = 0;
+	while (lineStart < length)
+	{
+		const char* newlineAt = static_cast<const char*>(std::memchr(text + lineStart, '\n', length - lineStart));
+		size_t newline = newlineAt ? static_cast<size_t>(newlineAt - text) : length;
+		std::string line(text + lineStart, newline - lineStart);
+		lineStart = newline + 1;
+
+		try
+		{
+			if (line.find("CIPHER:") == 0)
+			{
+				size_t configStart = line.find(':', 7);
+				if (configStart == std::string::npos)
+				{
+					throw std::runtime_error("invalid CIPHER line");
+				}
+				type = line.substr(7, configStart - 7);
+				config = line.substr(configStart + 1);
+			}
+			else if (line.find("CIPHER_TYPE:") == 0)
+			{
+				type = line.substr(12);
+			}
+			else if (line.find("CIPHER_CONFIG:") == 0)
+			{
+				config = line.substr(14);
+			}
+			else if (line.find("CIPHER_GENERATION:") == 0)
+			{
+				metadata.generation = static_cast<unsigned>(std::stoul(line.substr(18)));
+			}
+			else if (line.find("LEGACY_CIPHER:") == 0)
+			{
+				size_t typeStart = line.find(':', 14);
+				size_t configStart = typeStart == std::string::npos ? std::string::npos : line.find(':', typeStart + 1);
+				if (configStart == std::string::npos)
+				{
+					throw std::runtime_error("invalid LEGACY_CIPHER line");
+				}
+				legacy.push_back({ static_cast<unsigned>(std::stoul(line.substr(14, typeStart - 14))),
+					{ line.substr(typeStart + 1, configStart - typeStart - 1), line.substr(configStart + 1) } });
+			}
+			else if (line.find("CHUNK:") == 0)
+			{
+				VaultChunks::Chunk chunk = VaultChunks::parseDescription(line.substr(6));
+				metadata.chunks.push_back({ chunk.entries, chunk.tag });
+			}
+			else if (line.find("HISTORY:") == 0)
+			{
+				VaultChunks::Chunk chunk = VaultChunks::parseDescription(line.substr(8));
+				metadata.history.push_back({ chunk.entries, chunk.tag });
+			}
+			else if (line.find("HISTORY_KEEP:") == 0 || line.find("HISTORY_GENERATIONS:") == 0)
+			{
+				// settings of the history, nothing to check
+			}
+			else if (line == "ENTRIES:")
+			{
+				metadata.complete = true;
+				end = std::min(lineStart, length);
+				break;
+			}
+			else if (!line.empty())
+			{
+				throw std::runtime_error("unexpected line before the entries");
+			}
+		}
+		catch (const std::exception& e)
+		{
+			damage.push_back(Damage{ 0, 0, 0, 0, std::string("metadata: ") + e.what() });
+		}
+	}
+
+	if (!metadata.complete)
+	{
+		damage.push_back(Damage{ 0, 0, 0, 0, "metadata: no ENTRIES line, the entries cannot be located" });
+		return metadata;
+	}
+
+	auto addCipher = [&metadata, &damage](unsigned generation, const std::string& cipherType, const std::string& cipherConfig)
+	{
+		if (metadata.ciphers.size() <= generation)
+		{
+			metadata.ciphers.resize(generation + 1);
+		}
+		try
+		{
+			metadata.ciphers[generation].reset(CipherRegistry::instance().restore(cipherType, cipherConfig));
+		}
+		catch (const std::exception& e)
+		{
+			damage.push_back(Damage{ 0, 0, 0, 0, "metadata: cipher of generation " + std::to_string(generation) + ": " + e.what() });
+		}
+	};
+	addCipher(metadata.generation, type, config);
+	for (const auto& stored : legacy)
+	{
+		addCipher(stored.first, stored.second.first, stored.second.second);
+	}
+	return metadata;
+}
+
+void VaultChecker::checkLines(const char* text, size_t length, uint64_t fileOffset, bool checksummed, const Metadata& metadata, RangeResult& result)
+{
+	result.entries = 0;
+	result.decrypted = 0;
+
+	// ciphers are not required to be thread-safe, every range clones the ones it uses
+	Ciphers local(metadata.ciphers.size());
+	std::string line;
+	std::vector<std::string> parts;
+
+	size_t lineStart = 0;
+	while (lineStart < length)
+	{
+		const char* newlineAt = static_cast<const char*>(std::memchr(text + lineStart, '\n', length - lineStart));
+		size_t newline = newlineAt ? static_cast<size_t>(newlineAt - text) : length;
+		if (newline > lineStart)
+		{
+			line.assign(text + lineStart, newline - lineStart);
+			uint64_t entry = result.entries++;
+			std::string reason;
+
+			size_t fieldsLength = line.size();
+			if (checksummed && !checkRecord(line, fieldsLength))
+			{
+				reason = "checksum mismatch";
+			}
+			else if (!splitEntryFields(line.substr(0, fieldsLength), parts))
+			{
+				reason = "malformed record";
+			}
+			else if (parts.size() == 5 && !attributesValid(parts[4]))
+			{
+				reason = "malformed tags or fields";
+			}
+			else
+			{
+				unsigned long generation = parts.size() >= 4 ? std::strtoul(parts[3].c_str(), nullptr, 10) : metadata.generation;
+				if (generation >= metadata.ciphers.size() || !metadata.ciphers[generation])
+				{
+					reason = "no cipher for generation " + std::to_string(generation);
+				}
+				else
+				{
+					if (!local[generation])
+					{
+						local[generation].reset(metadata.ciphers[generation]->clone());
+					}
+					try
+					{
+						local[generation]->decrypt(parts[2]);
+						++result.decrypted;
+					}
+					catch (const std::exception& e)
+					{
+						reason = std::string("password does not decrypt: ") + e.what();
+					}
+				}
+			}
+
+			if (!reason.empty())
+			{
+				result.findings.push_back(Finding{ entry, entry, fileOffset + lineStart, fileOffset + newline - 1, reason });
+			}
+		}
+		lineStart = newline + 1;
+	}
+}
+
+void VaultChecker::collect(const std::vector<RangeResult>& results, Report& report)
+{
+	uint64_t first = 0;
+	for (const RangeResult& result : results)
+	{
+		for (const Finding& finding : result.findings)
+		{
+			Damage damage{ first + finding.firstEntry + 1, first + finding.lastEntry + 1, finding.firstByte, finding.lastByte, finding.reason };
+			Damage* previous = report.damage.empty() ? nullptr : &report.damage.back();
+			if (previous && previous->firstEntry > 0 && previous->reason == damage.reason && damage.firstEntry <= previous->lastEntry + 1)
+			{
+				previous->lastEntry = std::max(previous->lastEntry, damage.lastEntry);
+				previous->lastByte = std::max(previous->lastByte, damage.lastByte);
+			}
+			else
+			{
+				report.damage.push_back(damage);
+			}
+		}
+		first += result.entries;
+		report.entries += result.entries;
+		report.decrypted += result.decrypted;
+	}
+}
+
+void VaultChecker::checkStream(std::string& data, uint64_t bodyStart, uint64_t bodyEnd, int mode, const std::string& key, const std::string& nonce,
+	bool checksummed, Report& report, JobControl& control) const
+{
+	ThreadPool& pool = ThreadPool::shared();
+	char* body = &data[bodyStart];
+	size_t bodyLength = static_cast<size_t>(bodyEnd - bodyStart);
+
+	// 1. decrypt in place, both stream modes can start anywhere
+	std::unique_ptr<ChaCha20> stream;
+	if (mode == VaultHeader::BODY_CHACHA20)
+	{
+		stream.reset(new ChaCha20(key, nonce));
+	}
+	pool.parallelFor((bodyLength + RANGE_SIZE - 1) / RANGE_SIZE, [body, bodyLength, &stream, &key, &control](size_t i)
+	{
+		control.checkpoint();
+		size_t offset = i * RANGE_SIZE;
+		size_t length = std::min(RANGE_SIZE, bodyLength - offset);
+		if (stream)
+		{
+			stream->apply(body + offset, length, offset);
+		}
+		else
+		{
+			simpleEncryptDecrypt(body + offset, length, key, offset);
+		}
+	});
+
+	size_t entriesStart;
+	Metadata metadata = parseMetadata(body, bodyLength, entriesStart, report.damage);
+	if (!metadata.complete)
+	{
+		return;
+	}
+
+	// 2. cut the entries into ranges on line boundaries and check them in parallel
+	std::vector<std::pair<size_t, size_t>> ranges;
+	for (size_t start = entriesStart; start < bodyLength;)
+	{
+		size_t end = std::min(start + RANGE_SIZE, bodyLength);
+		if (end < bodyLength)
+		{
+			const char* newlineAt = static_cast<const char*>(std::memchr(body + end, '\n', bodyLength - end));
+			end = newlineAt ? static_cast<size_t>(newlineAt - body) + 1 : bodyLength;
+		}
+		ranges.push_back({ start, end });
+		start = end;
+	}
+
+	std::vector<RangeResult> results(ranges.size());
+	pool.parallelFor(ranges.size(), [&](size_t i)
+	{
+		control.checkpoint();
+		checkLines(body + ranges[i].first, ranges[i].second - ranges[i].first, bodyStart + ranges[i].first, checksummed, metadata, results[i]);
+		control.addBytes(ranges[i].second - ranges[i].first);
+		control.addEntries(results[i].entries);
+	});
+
+	collect(results, report);
+	report.records = report.entries;
+}
+
+void VaultChecker::checkChunked(std::string& data, uint64_t bodyStart, uint64_t bodyEnd, const std::string& key, Report& report, JobControl& control) const
+{
+	const char* body = data.data() + bodyStart;
+	size_t bodyLength = static_cast<size_t>(bodyEnd - bodyStart);
+
+	size_t metadataSize = VaultChunks::recordSize(body, bodyLength);
+	if (metadataSize == 0)
+	{
+		report.damage.push_back(Damage{ 0, 0, bodyStart, bodyEnd - 1, "metadata record is cut off" });
+		return;
+	}
+	bool authentic;
+	std::string text = VaultChunks::open(key, VaultChunks::METADATA, body, metadataSize, &authentic);
+	if (!authentic)
+	{
+		report.damage.push_back(Damage{ 0, 0, bodyStart, bodyStart + metadataSize - 1, "metadata record failed authentication" });
+	}
+	size_t end;
+	Metadata metadata = parseMetadata(text.data(), text.size(), end, report.damage);
+
+	// find the data records, then open and check them in parallel
+	std::vector<std::pair<size_t, size_t>> records; //offset in the body, size
+	for (size_t position = metadataSize; position < bodyLength;)
+	{
+		size_t size = VaultChunks::recordSize(body + position, bodyLength - position);
+		if (size == 0)
+		{
+			report.damage.push_back(Damage{ 0, 0, bodyStart + position, bodyEnd - 1, "record " + std::to_string(records.size() + 1) + " is cut off" });
+			break;
+		}
+		records.push_back({ position, size });
+		position += size;
+	}
+	if (records.size() != metadata.chunks.size() + metadata.history.size())
+	{
+		report.damage.push_back(Damage{ 0, 0, bodyStart, bodyEnd - 1, "file holds " + std::to_string(records.size())
+			+ " records, the metadata lists " + std::to_string(metadata.chunks.size()) + " data and "
+			+ std::to_string(metadata.history.size()) + " history records" });
+	}
+	size_t dataRecords = records.size() - std::min(records.size(), metadata.history.size()); //history records come last
+
+	std::vector<RangeResult> results(dataRecords);
+	ThreadPool::shared().parallelFor(dataRecords, [&](size_t i)
+	{
+		control.checkpoint();
+		size_t offset = records[i].first;
+		size_t size = records[i].second;
+		uint64_t firstByte = bodyStart + offset;
+		uint64_t lastByte = firstByte + size - 1;
+
+		bool valid;
+		std::string plain = VaultChunks::open(key, VaultChunks::ENTRIES, body + offset, size, &valid);
+		checkLines(plain.data(), plain.size(), firstByte + VaultChunks::RECORD_HEADER_SIZE, false, metadata, results[i]);
+
+		uint64_t lastEntry = results[i].entries > 0 ? results[i].entries - 1 : 0;
+		std::vector<Finding> whole; //problems of the record itself go in front of its lines
+		if (!valid)
+		{
+			whole.push_back(Finding{ 0, lastEntry, firstByte, lastByte, "record failed authentication" });
+		}
+		else if (i < metadata.chunks.size() && VaultChunks::recordTag(body + offset) != metadata.chunks[i].second)
+		{
+			whole.push_back(Finding{ 0, lastEntry, firstByte, lastByte, "record is not the one the metadata lists (stale or moved)" });
+		}
+		if (i < metadata.chunks.size() && results[i].entries != metadata.chunks[i].first)
+		{
+			whole.push_back(Finding{ 0, lastEntry, firstByte, lastByte, "record holds " + std::to_string(results[i].entries)
+				+ " entries, the metadata lists " + std::to_string(metadata.chunks[i].first) });
+		}
+		results[i].findings.insert(results[i].findings.begin(), whole.begin(), whole.end());
+
+		control.addBytes(size);
+		control.addEntries(results[i].entries);
+	});
+
+	// history records hold earlier passwords, not entries; they only have to open and parse
+	std::vector<std::string> historyDamage(records.size() - dataRecords);
+	ThreadPool::shared().parallelFor(historyDamage.size(), [&](size_t h)
+	{
+		control.checkpoint();
+		size_t offset = records[dataRecords + h].first;
+		size_t size = records[dataRecords + h].second;
+
+		bool valid;
+		std::string plain = VaultChunks::open(key, VaultChunks::HISTORY, body + offset, size, &valid);
+		std::vector<PasswordHistory::Version> versions;
+		if (!valid)
+		{
+			historyDamage[h] = "failed authentication";
+		}
+		else if (VaultChunks::recordTag(body + offset) != metadata.history[h].second)
+		{
+			historyDamage[h] = "is not the one the metadata lists (stale or moved)";
+		}
+		else
+		{
+			try
+			{
+				PasswordHistory::decode(plain, versions);
+				if (versions.size() != metadata.history[h].first)
+				{
+					historyDamage[h] = "holds " + std::to_string(versions.size()) + " versions, the metadata lists " + std::to_string(metadata.history[h].first);
+				}
+			}
+			catch (const std::exception&)
+			{
+				historyDamage[h] = "is malformed";
+			}
+		}
+		control.addBytes(size);
+	});
+
+	collect(results, report);
+	for (size_t h = 0; h < historyDamage.size(); ++h)
+	{
+		if (!historyDamage[h].empty())
+		{
+			uint64_t firstByte = bodyStart + records[dataRecords + h].first;
+			report.damage.push_back(Damage{ 0, 0, firstByte, firstByte + records[dataRecords + h].second - 1,
+				"history record " + std::to_string(h + 1) + " " + historyDamage[h] });
+		}
+	}
+	report.records = records.size() + 1;
+}
+
+VaultChecker::Report VaultChecker::run(JobControl& control) const
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Cannot open file: " + path);
+	}
+	file.seekg(0, std::ios::end);
+	std::string data(static_cast<size_t>(file.tellg()), '\0');
+	file.seekg(0, std::ios::beg);
+	file.read(&data[0], data.size());
+	if (!file)
+	{
+		throw std::runtime_error("Cannot read file: " + path);
+	}
+	file.close();
+	control.setBytesTotal(data.size());
+
+	Report report = Report();
+	report.fileBytes = data.size();
+	report.trailer = "none";
+	report.threads = ThreadPool::shared().size();
+
+	// the header: a wrong password stops here, everything after it is reported
+	size_t headerSize = data.size() >= VaultHeader::MAGIC_SIZE ? VaultHeader::sizeFromMagic(data.data()) : 0;
+	std::string key = masterPassword;
+	int mode = VaultHeader::BODY_XOR;
+	std::string nonce;
+	bool checksummed = false;
+	if (headerSize == 0)
+	{
+		report.mode = "legacy XOR";
+	}
+	else
+	{
+		if (data.size() < headerSize)
+		{
+			throw std::runtime_error("File is shorter than its header: " + path);
+		}
+		VaultHeader header = VaultHeader::parse(data.data(), headerSize);
+		key = header.unwrap(masterPassword);
+		if (headerSize == VaultHeader::SIZE)
+		{
+			mode = header.getBodyMode();
+			nonce = header.getBodyNonce();
+			checksummed = header.hasTrailer();
+		}
+		report.mode = mode == VaultHeader::BODY_CHUNKED ? "chunked ChaCha20-Poly1305" : mode == VaultHeader::BODY_CHACHA20 ? "ChaCha20" : "XOR";
+	}
+	control.addBytes(headerSize);
+	auto started = std::chrono::steady_clock::now(); //after the deliberately slow key derivation
+
+	uint64_t bodyStart = headerSize;
+	uint64_t bodyEnd = data.size();
+	if (checksummed)
+	{
+		uint64_t length;
+		uint32_t checksum;
+		if (bodyEnd < bodyStart + VaultHeader::TRAILER_SIZE
+			|| !VaultHeader::parseTrailer(data.data() + bodyEnd - VaultHeader::TRAILER_SIZE, length, checksum))
+		{
+			report.trailer = "missing (file truncated?)";
+		}
+		else
+		{
+			bodyEnd -= VaultHeader::TRAILER_SIZE;
+			if (length != bodyEnd - bodyStart)
+			{
+				report.trailer = "records " + std::to_string(length) + " body bytes, the file has " + std::to_string(bodyEnd - bodyStart);
+			}
+			else if (Crc32c::compute(data.data() + bodyStart, static_cast<size_t>(length)) != checksum)
+			{
+				report.trailer = "checksum mismatch";
+			}
+			else
+			{
+				report.trailer = "ok";
+			}
+		}
+	}
+
+	if (mode == VaultHeader::BODY_CHUNKED)
+	{
+		checkChunked(data, bodyStart, bodyEnd, key, report, control);
+	}
+	else
+	{
+		checkStream(data, bodyStart, bodyEnd, mode, key, nonce, checksummed, report, control);
+	}
+
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	return report;
+}
+
+std::string VaultChecker::Report::summary(const std::string& path) const
+{
+	std::ostringstream out;
+	out << "fsck " << path << ": " << mode << " body, " << fileBytes << " bytes" << '\n';
+	out << "  trailer checksum: " << trailer << '\n';
+	out << "  " << entries << " entries in " << records << " records, " << decrypted << " passwords decrypted" << '\n';
+	out << "  checked in " << seconds << " s (" << (fileBytes / seconds / 1e6) << " MB/s, "
+		<< (entries / seconds) << " entries/s) on " << threads << " threads" << '\n';
+
+	for (size_t i = 0; i < damage.size() && i < MAX_REPORTED; ++i)
+	{
+		const Damage& range = damage[i];
+		out << "  damaged: ";
+		if (range.firstEntry > 0)
+		{
+			out << "entries " << range.firstEntry << "-" << range.lastEntry << " ";
+		}
+		if (range.lastByte > 0)
+		{
+			out << "(bytes " << range.firstByte << "-" << range.lastByte << ") ";
+		}
+		out << range.reason << '\n';
+	}
+	if (damage.size() > MAX_REPORTED)
+	{
+		out << "  ... and " << (damage.size() - MAX_REPORTED) << " more damaged ranges" << '\n';
+	}
+
+	size_t problems = damage.size() + (trailer == "ok" || trailer == "none" ? 0 : 1);
+	out << (problems == 0 ? std::string("No problems found.") : std::to_string(problems) + " problem(s) found.");
+	return out.str();
+}
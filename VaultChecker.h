@@ -0,0 +1,88 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "Cipher.h"
+#include "JobControl.h"
+
+// Offline consistency check of a vault file, behind the 'fsck' command. It
+// reads the file on its own instead of through PasswordManager, so it also
+// works on a file that 'open' refuses. Records are verified in parallel on the
+// shared pool: the CRC-32C of every entry line (the Poly1305 tag of every
+// record in a chunked file), the entry fields, and whether each password
+// decrypts with the cipher of its generation.
+class VaultChecker
+{
+public:
+	struct Damage
+	{
+		uint64_t firstEntry; //1-based, in file order; 0 for damage outside the entries
+		uint64_t lastEntry;
+		uint64_t firstByte; //file offsets, inclusive
+		uint64_t lastByte;
+		std::string reason;
+	};
+
+	struct Report
+	{
+		std::string mode; //how the body is encrypted
+		uint64_t fileBytes;
+		size_t records; //entry lines, or sealed records in a chunked file
+		size_t entries;
+		size_t decrypted; //passwords their cipher took back
+		std::string trailer; //"ok", "none" for files from before checksums, otherwise what is wrong
+		std::vector<Damage> damage;
+		double seconds;
+		size_t threads;
+
+		bool isClean() const { return damage.empty() && (trailer == "ok" || trailer == "none"); }
+		std::string summary(const std::string& path) const;
+	};
+
+private:
+	typedef std::vector<std::unique_ptr<Cipher>> Ciphers; //indexed by generation, empty for unknown ones
+
+	struct Metadata
+	{
+		Ciphers ciphers;
+		unsigned generation; //current one, for entries without a generation field
+		std::vector<std::pair<size_t, std::string>> chunks; //entry count and tag per data record, chunked files only
+		std::vector<std::pair<size_t, std::string>> history; //version count and tag per history record, after the data records
+		bool complete; //reached the ENTRIES line
+	};
+
+	struct Finding
+	{
+		uint64_t firstEntry; //0-based within its range
+		uint64_t lastEntry;
+		uint64_t firstByte;
+		uint64_t lastByte;
+		std::string reason;
+	};
+
+	struct RangeResult
+	{
+		size_t entries;
+		size_t decrypted;
+		std::vector<Finding> findings;
+	};
+
+	std::string path;
+	std::string masterPassword;
+
+	static const size_t RANGE_SIZE = 1 << 20;
+	static const size_t MAX_REPORTED = 50; //damage lines printed by summary
+
+	static Metadata parseMetadata(const char* text, size_t length, size_t& end, std::vector<Damage>& damage); //end: just past the ENTRIES line
+	static void checkLines(const char* text, size_t length, uint64_t fileOffset, bool checksummed, const Metadata& metadata, RangeResult& result);
+	void checkStream(std::string& data, uint64_t bodyStart, uint64_t bodyEnd, int mode, const std::string& key, const std::string& nonce,
+		bool checksummed, Report& report, JobControl& control) const;
+	void checkChunked(std::string& data, uint64_t bodyStart, uint64_t bodyEnd, const std::string& key, Report& report, JobControl& control) const;
+	static void collect(const std::vector<RangeResult>& results, Report& report); //numbers the findings and merges neighbours
+
+public:
+	VaultChecker(const std::string& path, const std::string& masterPassword);
+
+	Report run(JobControl& control) const;
+};
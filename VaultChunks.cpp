@@ -0,0 +1,218 @@
+#include "VaultChunks.h"
+#include "ChaCha20.h"
+#include "Poly1305.h"
+#include "SecureRandom.h"
+#include <stdexcept>
+
+namespace
+{
+	void store32(char* bytes, uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			bytes[i] = static_cast<char>(value >> (8 * i));
+		}
+	}
+
+	uint32_t load32(const char* bytes)
+	{
+		uint32_t value = 0;
+		for (int i = 3; i >= 0; --i)
+		{
+			value = (value << 8) | static_cast<unsigned char>(bytes[i]);
+		}
+		return value;
+	}
+
+	// RFC 8439 section 2.8: one-time key from block 0, data from block 1, tag over aad and ciphertext
+	std::string computeTag(const ChaCha20& stream, char kind, const char* ciphertext, size_t length)
+	{
+		std::string oneTimeKey(Poly1305::KEY_SIZE, '\0');
+		stream.apply(&oneTimeKey[0], oneTimeKey.size(), 0);
+
+		static const char zeros[16] = {};
+		char lengths[16] = {};
+		lengths[0] = 1; // aad length, the record kind
+		uint64_t dataLength = length;
+		for (int i = 0; i < 8; ++i)
+		{
+			lengths[8 + i] = static_cast<char>(dataLength >> (8 * i));
+		}
+
+		Poly1305 mac(oneTimeKey);
+		mac.update(&kind, 1);
+		mac.update(zeros, 15);
+		mac.update(ciphertext, length);
+		mac.update(zeros, (16 - length % 16) % 16);
+		mac.update(lengths, sizeof(lengths));
+		return mac.finish();
+	}
+}
+
+size_t VaultChunks::find(size_t index, size_t& first) const
+{
+	first = 0;
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		if (index < first + chunks[i].entries)
+		{
+			return i;
+		}
+		first += chunks[i].entries;
+	}
+	throw std::out_of_range("Entry is not in any vault chunk");
+}
+
+void VaultChunks::reset(size_t entryCount)
+{
+	chunks.assign(1, Chunk{ entryCount, true, 0, 0, std::string() });
+}
+
+void VaultChunks::append()
+{
+	if (chunks.empty())
+	{
+		reset(0);
+	}
+	++chunks.back().entries;
+	chunks.back().dirty = true;
+}
+
+void VaultChunks::touch(size_t index)
+{
+	size_t first;
+	chunks[find(index, first)].dirty = true;
+}
+
+void VaultChunks::remove(size_t index)
+{
+	size_t first;
+	Chunk& chunk = chunks[find(index, first)];
+	--chunk.entries;
+	chunk.dirty = true; // an empty chunk is dropped by the next save
+}
+
+void VaultChunks::touchAll()
+{
+	for (Chunk& chunk : chunks)
+	{
+		chunk.dirty = true;
+	}
+}
+
+bool VaultChunks::isDirty() const
+{
+	for (const Chunk& chunk : chunks)
+	{
+		if (chunk.dirty)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string VaultChunks::seal(const std::string& key, RecordKind kind, std::string& plain)
+{
+	if (plain.size() > UINT32_MAX)
+	{
+		throw std::length_error("Vault chunk is too large");
+	}
+
+	std::string nonce = SecureRandom::bytes(NONCE_SIZE);
+	ChaCha20 stream(key, nonce);
+	if (!plain.empty())
+	{
+		stream.apply(&plain[0], plain.size(), ChaCha20::BLOCK_SIZE);
+	}
+
+	std::string record(RECORD_HEADER_SIZE, '\0');
+	store32(&record[0], static_cast<uint32_t>(plain.size()));
+	record.replace(4, NONCE_SIZE, nonce);
+	record.replace(4 + NONCE_SIZE, TAG_SIZE, computeTag(stream, static_cast<char>(kind), plain.data(), plain.size()));
+	record += plain;
+	return record;
+}
+
+std::string VaultChunks::open(const std::string& key, RecordKind kind, const char* record, size_t size, bool* authentic)
+{
+	if (size < RECORD_HEADER_SIZE || recordSize(record, size) != size)
+	{
+		throw std::runtime_error("Vault chunk is truncated");
+	}
+
+	ChaCha20 stream(key, std::string(record + 4, NONCE_SIZE));
+	const char* ciphertext = record + RECORD_HEADER_SIZE;
+	size_t length = size - RECORD_HEADER_SIZE;
+	bool valid = Poly1305::tagsEqual(computeTag(stream, static_cast<char>(kind), ciphertext, length), recordTag(record));
+	if (authentic)
+	{
+		*authentic = valid;
+	}
+	else if (!valid)
+	{
+		throw std::runtime_error("Vault chunk failed authentication (file modified or corrupted)");
+	}
+
+	std::string plain(ciphertext, length);
+	if (!plain.empty())
+	{
+		stream.apply(&plain[0], plain.size(), ChaCha20::BLOCK_SIZE);
+	}
+	return plain;
+}
+
+size_t VaultChunks::recordSize(const char* recordHeader, size_t available)
+{
+	if (available < RECORD_HEADER_SIZE)
+	{
+		return 0;
+	}
+	size_t size = RECORD_HEADER_SIZE + load32(recordHeader);
+	return size <= available ? size : 0;
+}
+
+std::string VaultChunks::recordTag(const char* record)
+{
+	return std::string(record + 4 + NONCE_SIZE, TAG_SIZE);
+}
+
+std::string VaultChunks::describe(const Chunk& chunk)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string text = std::to_string(chunk.entries) + ":";
+	for (unsigned char byte : chunk.tag)
+	{
+		text.push_back(digits[byte >> 4]);
+		text.push_back(digits[byte & 0x0f]);
+	}
+	return text;
+}
+
+VaultChunks::Chunk VaultChunks::parseDescription(const std::string& text)
+{
+	size_t colon = text.find(':');
+	if (colon == 0 || colon == std::string::npos || text.size() - colon - 1 != TAG_SIZE * 2
+		|| text.find_first_not_of("0123456789") < colon)
+	{
+		throw std::runtime_error("Invalid vault chunk line");
+	}
+
+	Chunk chunk{ static_cast<size_t>(std::stoull(text.substr(0, colon))), false, 0, 0, std::string(TAG_SIZE, '\0') };
+	for (size_t i = 0; i < TAG_SIZE; ++i)
+	{
+		int value = 0;
+		for (size_t j = 0; j < 2; ++j)
+		{
+			char c = text[colon + 1 + 2 * i + j];
+			int digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+			if (digit < 0)
+			{
+				throw std::runtime_error("Invalid vault chunk line");
+			}
+			value = value * 16 + digit;
+		}
+		chunk.tag[i] = static_cast<char>(value);
+	}
+	return chunk;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Body of a chunked vault file: a metadata record followed by records of
+// about TARGET_SIZE bytes of whole entry lines each. Every record is sealed
+// on its own with ChaCha20-Poly1305 (RFC 8439) under the data key and a fresh
+// nonce, so records can be opened and verified on separate threads. The
+// metadata record lists the entry count and tag of every data record in
+// order, which pins the set and order of records in the file. HISTORY records
+// of earlier passwords follow the data records, see PasswordHistory.
+//
+// Record layout: ciphertext length (4, LE) | nonce (12) | tag (16) | ciphertext
+//
+// The layout also remembers which records hold which entries and which of
+// them were touched since the last save; a save seals only those again and
+// copies the rest from the old file as they are.
+class VaultChunks
+{
+public:
+	enum RecordKind { METADATA = 0, ENTRIES = 1, HISTORY = 2 }; //authenticated with the record, so one cannot stand in for the other
+
+	struct Chunk
+	{
+		size_t entries; //consecutive entries of the vault held by this record
+		bool dirty; //must be sealed again by the next save
+		uint64_t fileOffset; //where the record starts in the current file, when clean
+		uint32_t recordSize;
+		std::string tag;
+	};
+
+	static const size_t TARGET_SIZE = 1 << 20;
+	static const size_t NONCE_SIZE = 12;
+	static const size_t TAG_SIZE = 16;
+	static const size_t RECORD_HEADER_SIZE = 4 + NONCE_SIZE + TAG_SIZE;
+
+private:
+	std::vector<Chunk> chunks;
+
+	size_t find(size_t index, size_t& first) const; //chunk holding entry index, first = its first entry
+
+public:
+	std::vector<Chunk>& getChunks() { return chunks; }
+	const std::vector<Chunk>& getChunks() const { return chunks; }
+
+	void reset(size_t entryCount); //everything dirty, cut into records by the next save
+	void append(); //an entry was pushed at the end
+	void touch(size_t index);
+	void remove(size_t index); //call before erasing the entry
+	void touchAll();
+	bool isDirty() const;
+
+	// encrypts plain in place and returns the whole record
+	static std::string seal(const std::string& key, RecordKind kind, std::string& plain);
+	// verifies and decrypts one record, throws if it was modified; size is the full record size.
+	// With authentic given, a modified record is decrypted anyway and reported there (for fsck).
+	static std::string open(const std::string& key, RecordKind kind, const char* record, size_t size, bool* authentic = nullptr);
+	static size_t recordSize(const char* recordHeader, size_t available); //0 if the record is cut off
+	static std::string recordTag(const char* record);
+
+	// "<entries>:<tag in hex>", one metadata line per data record
+	static std::string describe(const Chunk& chunk);
+	static Chunk parseDescription(const std::string& text);
+};
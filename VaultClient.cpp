@@ -0,0 +1,81 @@
+#include "VaultClient.h"
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+VaultClient::VaultClient(const std::string& socketPath) : fd(-1)
+{
+	sockaddr_un address;
+	if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path))
+	{
+		throw std::invalid_argument("Invalid socket path: " + socketPath);
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		throw std::runtime_error("Cannot create socket: " + std::string(std::strerror(errno)));
+	}
+
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+	if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+	{
+		int error = errno;
+		close(fd);
+		fd = -1;
+		throw std::runtime_error("Cannot connect to " + socketPath + ": " + std::strerror(error));
+	}
+}
+VaultClient::~VaultClient()
+{
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+}
+
+VaultProtocol::Frame VaultClient::call(uint8_t operation, const std::vector<std::string>& fields)
+{
+	std::string request;
+	VaultProtocol::appendFrame(request, operation, fields);
+
+	size_t written = 0;
+	while (written < request.size())
+	{
+		ssize_t sent = send(fd, request.data() + written, request.size() - written, MSG_NOSIGNAL);
+		if (sent < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			throw std::runtime_error("Cannot send request: " + std::string(std::strerror(errno)));
+		}
+		written += static_cast<size_t>(sent);
+	}
+
+	VaultProtocol::Frame response;
+	size_t offset = 0;
+	char chunk[4096];
+	while (!VaultProtocol::tryReadFrame(inBuffer, offset, response))
+	{
+		ssize_t received = read(fd, chunk, sizeof(chunk));
+		if (received < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (received <= 0)
+		{
+			throw std::runtime_error("Connection closed by the vault daemon.");
+		}
+		inBuffer.append(chunk, static_cast<size_t>(received));
+	}
+	inBuffer.erase(0, offset);
+
+	return response;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "VaultProtocol.h"
+
+// Blocking client side of the daemon protocol, one request in flight at a time.
+class VaultClient
+{
+private:
+	int fd;
+	std::string inBuffer;
+
+public:
+	explicit VaultClient(const std::string& socketPath);
+	~VaultClient();
+
+	VaultClient(const VaultClient&) = delete;
+	VaultClient& operator=(const VaultClient&) = delete;
+
+	VaultProtocol::Frame call(uint8_t operation, const std::vector<std::string>& fields);
+};
@@ -0,0 +1,212 @@
+#include "VaultHeader.h"
+#include "Sha256.h"
+#include "KeyDerivation.h"
+#include "SecureRandom.h"
+#include <stdexcept>
+#include <cstring>
+
+const char VaultHeader::MAGIC[MAGIC_SIZE] = { 'P', 'M', 'V', 'A', 'U', 'L', 'T', '3' };
+const char VaultHeader::MAGIC_V2[MAGIC_SIZE] = { 'P', 'M', 'V', 'A', 'U', 'L', 'T', '2' };
+const char VaultHeader::MAGIC_V1[MAGIC_SIZE] = { 'P', 'M', 'V', 'A', 'U', 'L', 'T', '1' };
+
+const char TRAILER_MAGIC[4] = { 'P', 'M', 'C', 'K' };
+
+VaultHeader::VaultHeader() : version(3), iterations(DEFAULT_ITERATIONS), bodyMode(BODY_XOR), trailer(false) {}
+
+void VaultHeader::setBody(BodyMode mode, const std::string& nonce)
+{
+	if (mode == BODY_CHACHA20 && nonce.size() != NONCE_SIZE)
+	{
+		throw std::invalid_argument("A ChaCha20 body needs a 12-byte nonce.");
+	}
+	bodyMode = mode;
+	bodyNonce = mode == BODY_CHACHA20 ? nonce : std::string();
+}
+
+std::string VaultHeader::deriveWrappingKey(const std::string& masterPassword) const
+{
+	if (version == 1)
+	{
+		Sha256 sha;
+		sha.update(salt);
+		sha.update(masterPassword);
+		return sha.digest();
+	}
+	return KeyDerivation::pbkdf2(masterPassword, salt, iterations, KEY_SIZE);
+}
+
+std::string VaultHeader::checkValue(const std::string& dataKey)
+{
+	Sha256 sha;
+	sha.update("vault key check");
+	sha.update(dataKey);
+	return sha.digest().substr(0, CHECK_SIZE);
+}
+
+std::string VaultHeader::newDataKey()
+{
+	return SecureRandom::bytes(KEY_SIZE);
+}
+
+VaultHeader VaultHeader::seal(const std::string& dataKey, const std::string& masterPassword, uint32_t iterations)
+{
+	if (dataKey.size() != KEY_SIZE)
+	{
+		throw std::invalid_argument("Data key must be " + std::to_string(KEY_SIZE) + " bytes.");
+	}
+	if (iterations == 0)
+	{
+		throw std::invalid_argument("KDF iterations must be positive.");
+	}
+
+	VaultHeader header;
+	header.iterations = iterations;
+	header.salt = SecureRandom::bytes(SALT_SIZE);
+
+	// the salt is new on every seal, so each wrapping key is used exactly once
+	std::string wrappingKey = header.deriveWrappingKey(masterPassword);
+	header.wrappedKey = dataKey;
+	for (size_t i = 0; i < KEY_SIZE; ++i)
+	{
+		header.wrappedKey[i] ^= wrappingKey[i];
+	}
+	header.keyCheck = checkValue(dataKey);
+	return header;
+}
+
+size_t VaultHeader::sizeFromMagic(const char* magic)
+{
+	if (std::memcmp(magic, MAGIC, MAGIC_SIZE) == 0)
+	{
+		return SIZE;
+	}
+	if (std::memcmp(magic, MAGIC_V2, MAGIC_SIZE) == 0)
+	{
+		return SIZE_V2;
+	}
+	if (std::memcmp(magic, MAGIC_V1, MAGIC_SIZE) == 0)
+	{
+		return SIZE_V1;
+	}
+	return 0;
+}
+
+VaultHeader VaultHeader::parse(const char* data, size_t length)
+{
+	size_t expected = length >= MAGIC_SIZE ? sizeFromMagic(data) : 0;
+	if (expected == 0 || length < expected)
+	{
+		throw std::runtime_error("Vault header is missing or truncated.");
+	}
+
+	VaultHeader header;
+	size_t offset = MAGIC_SIZE;
+	if (expected == SIZE_V1)
+	{
+		header.iterations = 1;
+	}
+	else
+	{
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data + offset);
+		header.iterations = uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+		offset += 4;
+		if (header.iterations == 0)
+		{
+			throw std::runtime_error("Vault header has an invalid KDF cost.");
+		}
+	}
+
+	if (expected == SIZE)
+	{
+		unsigned char mode = static_cast<unsigned char>(data[offset]);
+		header.trailer = (mode & TRAILER_FLAG) != 0;
+		mode &= ~TRAILER_FLAG;
+		if (mode != BODY_XOR && mode != BODY_CHACHA20 && mode != BODY_CHUNKED)
+		{
+			throw std::runtime_error("Vault header has an unknown body encryption mode.");
+		}
+		header.setBody(static_cast<BodyMode>(mode), std::string(data + offset + 1, NONCE_SIZE));
+		offset += 1 + NONCE_SIZE;
+	}
+	else
+	{
+		header.version = expected == SIZE_V2 ? 2 : 1; // the body of older files is XORed
+	}
+
+	header.salt.assign(data + offset, SALT_SIZE);
+	offset += SALT_SIZE;
+	header.wrappedKey.assign(data + offset, KEY_SIZE);
+	offset += KEY_SIZE;
+	header.keyCheck.assign(data + offset, CHECK_SIZE);
+	return header;
+}
+
+std::string VaultHeader::unwrap(const std::string& masterPassword) const
+{
+	std::string wrappingKey = deriveWrappingKey(masterPassword);
+	std::string dataKey = wrappedKey;
+	for (size_t i = 0; i < KEY_SIZE; ++i)
+	{
+		dataKey[i] ^= wrappingKey[i];
+	}
+
+	if (checkValue(dataKey) != keyCheck)
+	{
+		throw std::runtime_error("Wrong master password.");
+	}
+	return dataKey;
+}
+
+std::string VaultHeader::serialize() const
+{
+	if (needsReseal())
+	{
+		throw std::logic_error("Version 1 vault headers cannot be written, seal a new one.");
+	}
+
+	std::string out(MAGIC, MAGIC_SIZE);
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		out.push_back(static_cast<char>(iterations >> shift));
+	}
+	out.push_back(static_cast<char>(bodyMode | (trailer ? TRAILER_FLAG : 0)));
+	out += bodyMode == BODY_CHACHA20 ? bodyNonce : std::string(NONCE_SIZE, '\0');
+	out += salt;
+	out += wrappedKey;
+	out += keyCheck;
+	return out;
+}
+
+std::string VaultHeader::makeTrailer(uint64_t bodyLength, uint32_t checksum)
+{
+	std::string out(TRAILER_MAGIC, sizeof(TRAILER_MAGIC));
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		out.push_back(static_cast<char>(bodyLength >> shift));
+	}
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		out.push_back(static_cast<char>(checksum >> shift));
+	}
+	return out;
+}
+
+bool VaultHeader::parseTrailer(const char* data, uint64_t& bodyLength, uint32_t& checksum)
+{
+	if (std::memcmp(data, TRAILER_MAGIC, sizeof(TRAILER_MAGIC)) != 0)
+	{
+		return false;
+	}
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data + sizeof(TRAILER_MAGIC));
+	bodyLength = 0;
+	for (int i = 7; i >= 0; --i)
+	{
+		bodyLength = (bodyLength << 8) | bytes[i];
+	}
+	checksum = 0;
+	for (int i = 3; i >= 0; --i)
+	{
+		checksum = (checksum << 8) | bytes[8 + i];
+	}
+	return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-size header at the start of a vault file. The body is encrypted with
+// a random data key; the header stores that key wrapped by a key derived from
+// the master password, so changing the password rewrites only these bytes.
+//
+// Layout: magic (8) | KDF iterations (4, LE) | body mode (1) | body nonce (12) | salt (16) | wrapped data key (32) | key check (16)
+// The top bit of the body mode byte says the file ends with a trailer:
+// magic (4) | body length (8, LE) | CRC-32C of the body bytes (4, LE)
+// Version 2 headers had no body fields (XOR body). Version 1 headers also had
+// no iteration count and a single salted SHA-256 instead of PBKDF2.
+class VaultHeader
+{
+public:
+	enum BodyMode { BODY_XOR = 0, BODY_CHACHA20 = 1, BODY_CHUNKED = 2 }; //chunked: see VaultChunks, nonces live in the records
+
+private:
+	int version;
+	uint32_t iterations; //PBKDF2 cost, chosen by 'calibrate'
+	BodyMode bodyMode;
+	std::string bodyNonce; //new on every save, ChaCha20 only
+	bool trailer; //the file ends with a body checksum
+	std::string salt;
+	std::string wrappedKey;
+	std::string keyCheck; //lets a wrong master password fail cleanly instead of decrypting garbage
+
+	std::string deriveWrappingKey(const std::string& masterPassword) const;
+	static std::string checkValue(const std::string& dataKey);
+
+public:
+	static const size_t MAGIC_SIZE = 8;
+	static const char MAGIC[MAGIC_SIZE];
+	static const char MAGIC_V2[MAGIC_SIZE];
+	static const char MAGIC_V1[MAGIC_SIZE];
+	static const size_t SALT_SIZE = 16;
+	static const size_t KEY_SIZE = 32;
+	static const size_t CHECK_SIZE = 16;
+	static const size_t NONCE_SIZE = 12;
+	static const size_t SIZE = MAGIC_SIZE + 4 + 1 + NONCE_SIZE + SALT_SIZE + KEY_SIZE + CHECK_SIZE;
+	static const size_t SIZE_V2 = MAGIC_SIZE + 4 + SALT_SIZE + KEY_SIZE + CHECK_SIZE;
+	static const size_t SIZE_V1 = MAGIC_SIZE + SALT_SIZE + KEY_SIZE + CHECK_SIZE;
+	static const uint32_t DEFAULT_ITERATIONS = 200000;
+	static const size_t TRAILER_SIZE = 16;
+	static const unsigned char TRAILER_FLAG = 0x80;
+
+	VaultHeader();
+
+	// wraps dataKey for masterPassword with a fresh salt; this is where the KDF cost is paid
+	static VaultHeader seal(const std::string& dataKey, const std::string& masterPassword, uint32_t iterations);
+	static size_t sizeFromMagic(const char* magic); //0 for files from before the header existed
+	static VaultHeader parse(const char* data, size_t length);
+
+	std::string unwrap(const std::string& masterPassword) const; //the data key, throws for a wrong password
+	std::string serialize() const; //always the current version
+
+	uint32_t getIterations() const { return iterations; }
+	bool needsReseal() const { return version == 1; } //older key derivation, seal again before saving
+	BodyMode getBodyMode() const { return bodyMode; }
+	const std::string& getBodyNonce() const { return bodyNonce; }
+	void setBody(BodyMode mode, const std::string& nonce);
+	bool hasTrailer() const { return trailer; }
+	void setTrailer(bool present) { trailer = present; }
+
+	static std::string makeTrailer(uint64_t bodyLength, uint32_t checksum);
+	static bool parseTrailer(const char* data, uint64_t& bodyLength, uint32_t& checksum); //false if it is not a trailer
+
+	static std::string newDataKey();
+};
@@ -0,0 +1,104 @@
+#include "VaultProtocol.h"
+#include <stdexcept>
+
+static void appendU16(std::string& buffer, uint16_t value)
+{
+	buffer.push_back(static_cast<char>(value & 0xFF));
+	buffer.push_back(static_cast<char>((value >> 8) & 0xFF));
+}
+static void appendU32(std::string& buffer, uint32_t value)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+	}
+}
+static uint32_t readUnsigned(const std::string& buffer, size_t pos, int bytes)
+{
+	uint32_t value = 0;
+	for (int i = 0; i < bytes; ++i)
+	{
+		value |= static_cast<uint32_t>(static_cast<unsigned char>(buffer[pos + i])) << (8 * i);
+	}
+	return value;
+}
+
+void VaultProtocol::appendFrame(std::string& buffer, uint8_t code, const std::vector<std::string>& fields)
+{
+	size_t bodySize = 1;
+	for (const std::string& field : fields)
+	{
+		if (field.size() > 0xFFFF)
+		{
+			throw std::invalid_argument("Field is too long for a vault frame.");
+		}
+		bodySize += 2 + field.size();
+	}
+	if (bodySize > MAX_FRAME_SIZE)
+	{
+		throw std::invalid_argument("Vault frame is too large.");
+	}
+
+	buffer.reserve(buffer.size() + 4 + bodySize);
+	appendU32(buffer, static_cast<uint32_t>(bodySize));
+	buffer.push_back(static_cast<char>(code));
+	for (const std::string& field : fields)
+	{
+		appendU16(buffer, static_cast<uint16_t>(field.size()));
+		buffer += field;
+	}
+}
+
+bool VaultProtocol::tryReadFrame(const std::string& buffer, size_t& offset, Frame& frame)
+{
+	if (buffer.size() - offset < 4)
+	{
+		return false;
+	}
+
+	uint32_t bodySize = readUnsigned(buffer, offset, 4);
+	if (bodySize == 0 || bodySize > MAX_FRAME_SIZE)
+	{
+		throw std::runtime_error("Malformed vault frame length: " + std::to_string(bodySize));
+	}
+	if (buffer.size() - offset - 4 < bodySize)
+	{
+		return false;
+	}
+
+	size_t pos = offset + 4;
+	size_t end = pos + bodySize;
+
+	frame.code = static_cast<uint8_t>(buffer[pos++]);
+	frame.fields.clear();
+	while (pos < end)
+	{
+		if (end - pos < 2)
+		{
+			throw std::runtime_error("Malformed vault frame: truncated field length");
+		}
+		size_t fieldSize = readUnsigned(buffer, pos, 2);
+		pos += 2;
+		if (end - pos < fieldSize)
+		{
+			throw std::runtime_error("Malformed vault frame: field overruns frame");
+		}
+		frame.fields.push_back(buffer.substr(pos, fieldSize));
+		pos += fieldSize;
+	}
+
+	offset = end;
+	return true;
+}
+
+std::string VaultProtocol::operationName(uint8_t operation)
+{
+	switch (operation)
+	{
+	case OP_LOAD: return "load";
+	case OP_SAVE: return "save";
+	case OP_UPDATE: return "update";
+	case OP_DELETE: return "delete";
+	default: return "unknown";
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Framing used between the vault daemon and its clients.
+// Every frame is: u32 body length (little endian) | u8 code | fields...
+// and every field is: u16 length (little endian) | bytes.
+// For requests the code is the operation, for responses it is the status.
+class VaultProtocol
+{
+public:
+	enum Operation : uint8_t
+	{
+		OP_LOAD = 1,   // website [user]
+		OP_SAVE = 2,   // website user password
+		OP_UPDATE = 3, // website user new-password
+		OP_DELETE = 4  // website [user]
+	};
+
+	enum Status : uint8_t
+	{
+		STATUS_OK = 0,
+		STATUS_NOT_FOUND = 1,
+		STATUS_ERROR = 2 // single field with the error message
+	};
+
+	struct Frame
+	{
+		uint8_t code;
+		std::vector<std::string> fields;
+	};
+
+	static const size_t MAX_FRAME_SIZE = 1 << 20;
+
+	static void appendFrame(std::string& buffer, uint8_t code, const std::vector<std::string>& fields);
+	static bool tryReadFrame(const std::string& buffer, size_t& offset, Frame& frame); //false while the frame is incomplete
+
+	static std::string operationName(uint8_t operation);
+};
@@ -0,0 +1,516 @@
+#include "VaultServer.h"
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+VaultServer* VaultServer::activeServer = nullptr;
+
+VaultServer::VaultServer(PasswordManager* manager, const std::string& socketPath, size_t workerCount)
+	: passwordManager(manager), socketPath(socketPath), workerCount(workerCount),
+	listenFd(-1), epollFd(-1), wakeFd(-1)
+{
+	if (passwordManager == nullptr || !passwordManager->isOpen())
+	{
+		throw std::invalid_argument("Vault server needs an open password file.");
+	}
+	if (socketPath.empty() || socketPath.size() >= sizeof(sockaddr_un::sun_path))
+	{
+		throw std::invalid_argument("Invalid socket path: " + socketPath);
+	}
+}
+VaultServer::~VaultServer()
+{
+	closeAll();
+}
+
+void VaultServer::handleSignal(int)
+{
+	if (activeServer != nullptr)
+	{
+		activeServer->stop();
+	}
+}
+
+void VaultServer::stop()
+{
+	if (wakeFd >= 0)
+	{
+		uint64_t one = 1;
+		ssize_t ignored = write(wakeFd, &one, sizeof(one)); // async-signal-safe
+		(void)ignored;
+	}
+}
+
+void VaultServer::openListener()
+{
+	// only a stale socket may be removed, never a file the path names by mistake
+	struct stat existing;
+	if (lstat(socketPath.c_str(), &existing) == 0)
+	{
+		if (!S_ISSOCK(existing.st_mode))
+		{
+			throw std::runtime_error("Refusing to replace " + socketPath + ": it exists and is not a socket");
+		}
+		unlink(socketPath.c_str()); // stale socket from a previous run
+	}
+
+	listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listenFd < 0)
+	{
+		throw std::runtime_error("Cannot create socket: " + std::string(std::strerror(errno)));
+	}
+
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+	// the socket hands out decrypted passwords, so only its owner may connect
+	mode_t previousMask = umask(077);
+	int bound = bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+	int bindError = errno;
+	umask(previousMask);
+	if (bound < 0)
+	{
+		close(listenFd);
+		listenFd = -1; // closeAll must not unlink a path we never bound
+		throw std::runtime_error("Cannot bind " + socketPath + ": " + std::strerror(bindError));
+	}
+	if (listen(listenFd, SOMAXCONN) < 0)
+	{
+		throw std::runtime_error("Cannot listen on " + socketPath + ": " + std::strerror(errno));
+	}
+}
+
+void VaultServer::run()
+{
+	openListener();
+
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (epollFd < 0 || wakeFd < 0)
+	{
+		throw std::runtime_error("Cannot set up the event loop: " + std::string(std::strerror(errno)));
+	}
+
+	// listener and wake-up fd are told apart from connections by their addresses
+	epoll_event event;
+	std::memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = &listenFd;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+	event.data.ptr = &wakeFd;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+	activeServer = this;
+	struct sigaction action;
+	std::memset(&action, 0, sizeof(action));
+	action.sa_handler = &VaultServer::handleSignal;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+	signal(SIGPIPE, SIG_IGN);
+
+	{
+		// declared inside the loop scope so every in-flight request finishes
+		// (and re-arms against a still valid epoll fd) before we tear down
+		ThreadPool pool(workerCount);
+
+		const int maxEvents = 64;
+		epoll_event events[maxEvents];
+		bool running = true;
+
+		while (running)
+		{
+			int ready = epoll_wait(epollFd, events, maxEvents, -1);
+			if (ready < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				throw std::runtime_error("epoll_wait failed: " + std::string(std::strerror(errno)));
+			}
+
+			for (int i = 0; i < ready; ++i)
+			{
+				void* source = events[i].data.ptr;
+				if (source == &listenFd)
+				{
+					acceptConnections();
+				}
+				else if (source == &wakeFd)
+				{
+					running = false;
+				}
+				else
+				{
+					Connection* connection = static_cast<Connection*>(source);
+					pool.submit([this, connection] { serviceConnection(connection); });
+				}
+			}
+		}
+	}
+
+	activeServer = nullptr;
+	closeAll();
+}
+
+void VaultServer::acceptConnections()
+{
+	while (true)
+	{
+		int clientFd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (clientFd < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return; // EAGAIN: backlog drained, anything else: try again on the next event
+		}
+
+		// the socket mode already keeps other users out, some systems ignore it for sockets
+		ucred peer;
+		socklen_t peerLength = sizeof(peer);
+		if (getsockopt(clientFd, SOL_SOCKET, SO_PEERCRED, &peer, &peerLength) < 0 || peer.uid != geteuid())
+		{
+			close(clientFd);
+			continue;
+		}
+
+		Connection* connection = new Connection{ clientFd, "", "" };
+		{
+			std::lock_guard<std::mutex> lock(connectionsMutex);
+			connections.insert(connection);
+		}
+
+		epoll_event event;
+		std::memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+		event.data.ptr = connection;
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, clientFd, &event) < 0)
+		{
+			closeConnection(connection);
+		}
+	}
+}
+
+void VaultServer::serviceConnection(Connection* connection)
+{
+	bool closing = false;
+	char chunk[16384];
+
+	while (true)
+	{
+		ssize_t received = read(connection->fd, chunk, sizeof(chunk));
+		if (received > 0)
+		{
+			connection->inBuffer.append(chunk, static_cast<size_t>(received));
+		}
+		else if (received == 0)
+		{
+			closing = true;
+			break;
+		}
+		else if (errno == EINTR)
+		{
+			continue;
+		}
+		else
+		{
+			closing = (errno != EAGAIN && errno != EWOULDBLOCK);
+			break;
+		}
+	}
+
+	try
+	{
+		size_t offset = 0;
+		VaultProtocol::Frame request;
+		while (VaultProtocol::tryReadFrame(connection->inBuffer, offset, request))
+		{
+			handleFrame(request, connection->outBuffer);
+		}
+		connection->inBuffer.erase(0, offset);
+	}
+	catch (const std::exception& e)
+	{
+		// framing is lost, tell the client why and hang up
+		VaultProtocol::appendFrame(connection->outBuffer, VaultProtocol::STATUS_ERROR, { e.what() });
+		closing = true;
+	}
+
+	writeAll(connection);
+	if (connection->fd < 0)
+	{
+		closing = true;
+	}
+
+	if (closing)
+	{
+		closeConnection(connection);
+		return;
+	}
+
+	epoll_event event;
+	std::memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	event.data.ptr = connection;
+	if (epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event) < 0)
+	{
+		closeConnection(connection);
+	}
+}
+
+void VaultServer::writeAll(Connection* connection)
+{
+	size_t written = 0;
+	std::string& buffer = connection->outBuffer;
+
+	while (written < buffer.size())
+	{
+		ssize_t sent = send(connection->fd, buffer.data() + written, buffer.size() - written, MSG_NOSIGNAL);
+		if (sent > 0)
+		{
+			written += static_cast<size_t>(sent);
+		}
+		else if (sent < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			// responses are small, so a slow reader only parks this worker briefly
+			pollfd waitFor = { connection->fd, POLLOUT, 0 };
+			if (poll(&waitFor, 1, 1000) <= 0)
+			{
+				break;
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if (written < buffer.size())
+	{
+		// give up on this client, serviceConnection closes it
+		shutdown(connection->fd, SHUT_RDWR);
+		close(connection->fd);
+		connection->fd = -1;
+	}
+	buffer.clear();
+}
+
+void VaultServer::closeConnection(Connection* connection)
+{
+	{
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		connections.erase(connection);
+	}
+	if (connection->fd >= 0)
+	{
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+		close(connection->fd);
+	}
+	delete connection;
+}
+
+void VaultServer::closeAll()
+{
+	{
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		for (Connection* connection : connections)
+		{
+			if (connection->fd >= 0)
+			{
+				close(connection->fd);
+			}
+			delete connection;
+		}
+		connections.clear();
+	}
+
+	if (listenFd >= 0)
+	{
+		close(listenFd);
+		unlink(socketPath.c_str());
+		listenFd = -1;
+	}
+	if (epollFd >= 0)
+	{
+		close(epollFd);
+		epollFd = -1;
+	}
+	if (wakeFd >= 0)
+	{
+		close(wakeFd);
+		wakeFd = -1;
+	}
+}
+
+void VaultServer::handleFrame(const VaultProtocol::Frame& request, std::string& response)
+{
+	const std::vector<std::string>& fields = request.fields;
+
+	try
+	{
+		switch (request.code)
+		{
+		case VaultProtocol::OP_LOAD:
+		{
+			if (fields.size() < 1 || fields.size() > 2)
+			{
+				throw std::invalid_argument("load expects <website> [<user>]");
+			}
+
+			std::shared_lock<std::shared_mutex> lock(vaultMutex);
+			if (fields.size() == 2)
+			{
+				PasswordEntry* entry = passwordManager->findPassword(fields[0], fields[1]);
+				if (entry == nullptr)
+				{
+					VaultProtocol::appendFrame(response, VaultProtocol::STATUS_NOT_FOUND, {});
+					return;
+				}
+				std::string decryptedPassword = passwordManager->decryptPassword(*entry);
+				VaultProtocol::appendFrame(response, VaultProtocol::STATUS_OK, { decryptedPassword });
+				return;
+			}
+
+			// user/password pairs for every account on the website
+			std::vector<PasswordEntry> users = passwordManager->loadAllUsers(fields[0]);
+			if (users.empty())
+			{
+				VaultProtocol::appendFrame(response, VaultProtocol::STATUS_NOT_FOUND, {});
+				return;
+			}
+			std::vector<std::string> result;
+			result.reserve(users.size() * 2);
+			for (const PasswordEntry& entry : users)
+			{
+				result.push_back(entry.getUsername());
+				result.push_back(passwordManager->decryptPassword(entry));
+			}
+			VaultProtocol::appendFrame(response, VaultProtocol::STATUS_OK, result);
+			return;
+		}
+		case VaultProtocol::OP_SAVE:
+		{
+			if (fields.size() != 3)
+			{
+				throw std::invalid_argument("save expects <website> <user> <password>");
+			}
+
+			std::unique_lock<std::shared_mutex> lock(vaultMutex);
+			passwordManager->addPassword(fields[0], fields[1], fields[2]);
+			VaultProtocol::appendFrame(response, VaultProtocol::STATUS_OK, {});
+			return;
+		}
+		case VaultProtocol::OP_UPDATE:
+		{
+			if (fields.size() != 3)
+			{
+				throw std::invalid_argument("update expects <website> <user> <new-password>");
+			}
+
+			std::unique_lock<std::shared_mutex> lock(vaultMutex);
+			bool updated = passwordManager->updatePassword(fields[0], fields[1], fields[2]);
+			VaultProtocol::appendFrame(response, updated ? VaultProtocol::STATUS_OK : VaultProtocol::STATUS_NOT_FOUND, {});
+			return;
+		}
+		case VaultProtocol::OP_DELETE:
+		{
+			if (fields.size() < 1 || fields.size() > 2)
+			{
+				throw std::invalid_argument("delete expects <website> [<user>]");
+			}
+
+			std::unique_lock<std::shared_mutex> lock(vaultMutex);
+			if (fields.size() == 2)
+			{
+				bool deleted = passwordManager->deletePassword(fields[0], fields[1]);
+				VaultProtocol::appendFrame(response, deleted ? VaultProtocol::STATUS_OK : VaultProtocol::STATUS_NOT_FOUND, {});
+				return;
+			}
+			int deletedCount = passwordManager->deletePasswordsByWebsite(fields[0]);
+			VaultProtocol::appendFrame(response, deletedCount > 0 ? VaultProtocol::STATUS_OK : VaultProtocol::STATUS_NOT_FOUND,
+				{ std::to_string(deletedCount) });
+			return;
+		}
+		default:
+			throw std::invalid_argument("Unknown operation code: " + std::to_string(request.code));
+		}
+	}
+	catch (const std::exception& e)
+	{
+		VaultProtocol::appendFrame(response, VaultProtocol::STATUS_ERROR, { e.what() });
+	}
+}
+
+std::string VaultServer::readMasterPassword()
+{
+	// never from argv, where every user can read it in ps
+	std::string masterPassword;
+	const char* fromEnvironment = std::getenv("PM_MASTER_PASSWORD");
+	if (fromEnvironment != nullptr)
+	{
+		masterPassword = fromEnvironment;
+		unsetenv("PM_MASTER_PASSWORD");
+	}
+	else if (std::getline(std::cin, masterPassword) && !masterPassword.empty() && masterPassword.back() == '\r')
+	{
+		masterPassword.pop_back();
+	}
+	if (masterPassword.empty())
+	{
+		throw std::invalid_argument("No master password: set PM_MASTER_PASSWORD or pass it on stdin");
+	}
+	return masterPassword;
+}
+
+int VaultServer::runFromArguments(const std::vector<std::string>& args)
+{
+	// args[0] is "--daemon"
+	if (args.size() != 3 && !(args.size() == 5 && args[3] == "--workers"))
+	{
+		std::cerr << "Usage: --daemon <socket> <vault-file> [--workers N]" << std::endl;
+		std::cerr << "       the master password is read from PM_MASTER_PASSWORD, or else from the first line of stdin" << std::endl;
+		return 1;
+	}
+
+	size_t workers = 0;
+	if (args.size() == 5)
+	{
+		char* end;
+		long value = std::strtol(args[4].c_str(), &end, 10);
+		if (*end != '\0' || value <= 0)
+		{
+			throw std::invalid_argument("Invalid worker count: " + args[4]);
+		}
+		workers = static_cast<size_t>(value);
+	}
+
+	std::string masterPassword = readMasterPassword();
+
+	PasswordManager manager;
+	manager.setOutput(nullptr); // per-request chatter would only slow the daemon down
+	manager.openFile(args[2], masterPassword);
+
+	VaultServer server(&manager, args[1], workers);
+	std::cout << "Serving '" << args[2] << "' on " << args[1] << " (Ctrl+C to stop)" << std::endl;
+	server.run();
+	std::cout << "Daemon stopped." << std::endl;
+	return 0;
+}
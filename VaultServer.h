@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+#include "PasswordManager.h"
+#include "ThreadPool.h"
+#include "VaultProtocol.h"
+
+// Keeps one vault open and serves load/save/update/delete requests over a UNIX domain socket.
+// The event loop owns the epoll set; each ready connection is handed to a pool worker
+// (EPOLLONESHOT guarantees one worker per connection at a time) and re-armed afterwards.
+class VaultServer
+{
+private:
+	struct Connection
+	{
+		int fd;
+		std::string inBuffer;
+		std::string outBuffer;
+	};
+
+	PasswordManager* passwordManager;
+	std::shared_mutex vaultMutex; //readers share the vault, mutations are exclusive
+	std::string socketPath;
+	size_t workerCount;
+
+	int listenFd;
+	int epollFd;
+	int wakeFd; //eventfd used to break the event loop on shutdown
+
+	std::mutex connectionsMutex;
+	std::unordered_set<Connection*> connections;
+
+	static VaultServer* activeServer; //target of SIGINT/SIGTERM
+	static void handleSignal(int signalNumber);
+
+	void openListener();
+	void acceptConnections();
+	void serviceConnection(Connection* connection);
+	void closeConnection(Connection* connection);
+	void closeAll();
+
+	void handleFrame(const VaultProtocol::Frame& request, std::string& response);
+	void writeAll(Connection* connection);
+
+public:
+	VaultServer(PasswordManager* manager, const std::string& socketPath, size_t workerCount = 0);
+	~VaultServer();
+
+	VaultServer(const VaultServer&) = delete;
+	VaultServer& operator=(const VaultServer&) = delete;
+
+	void run(); //blocks until stop() or a termination signal
+	void stop();
+
+	// from PM_MASTER_PASSWORD (removed from the environment once read) or else the first line of stdin, never argv
+	static std::string readMasterPassword();
+
+	// --daemon <socket> <vault-file> [--workers N], the password from readMasterPassword
+	static int runFromArguments(const std::vector<std::string>& args);
+};
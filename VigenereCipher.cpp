@@ -0,0 +1,193 @@
+#include "VigenereCipher.h"
+#include "CipherRegistry.h"
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VIGENERE_X86 1
+#endif
+
+namespace
+{
+	const CipherRegistry::Registrar registrar(CipherType{ VigenereCipher::TYPE_ID, "vigenere", "<key>", 1, 1,
+		&VigenereCipher::fromParams, &VigenereCipher::decodeConfig, "Vigenere", &VigenereCipher::decodeConfig });
+
+	const size_t STEP = 32; //widest kernel step, the unrolled key covers it
+
+	typedef void (*Kernel)(const unsigned char* in, unsigned char* out, size_t length, const unsigned char* shifts, size_t keyLength);
+
+	// every kernel ends here for the bytes that do not fill a vector
+	void shiftScalar(const unsigned char* in, unsigned char* out, size_t length, const unsigned char* shifts, size_t keyLength, size_t keyPosition)
+	{
+		for (size_t i = 0; i < length; ++i)
+		{
+			unsigned char c = in[i];
+			if (c >= 32 && c <= 126)
+			{
+				unsigned value = c - 32u + shifts[keyPosition];
+				c = static_cast<unsigned char>(32 + (value >= 95 ? value - 95 : value));
+			}
+			out[i] = c;
+			if (++keyPosition == keyLength)
+			{
+				keyPosition = 0;
+			}
+		}
+	}
+
+	void kernelScalar(const unsigned char* in, unsigned char* out, size_t length, const unsigned char* shifts, size_t keyLength)
+	{
+		shiftScalar(in, out, length, shifts, keyLength, 0);
+	}
+
+#ifdef VIGENERE_X86
+	__attribute__((target("sse2")))
+	void kernelSse2(const unsigned char* in, unsigned char* out, size_t length, const unsigned char* shifts, size_t keyLength)
+	{
+		const __m128i low = _mm_set1_epi8(31);
+		const __m128i high = _mm_set1_epi8(127);
+		const __m128i base = _mm_set1_epi8(32);
+		const __m128i range = _mm_set1_epi8(95);
+
+		size_t keyPosition = 0;
+		size_t i = 0;
+		for (; i + 16 <= length; i += 16)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shifts + keyPosition));
+
+			// printable = 31 < x < 127 as signed bytes, which also leaves out 128..255
+			__m128i printable = _mm_and_si128(_mm_cmpgt_epi8(x, low), _mm_cmpgt_epi8(high, x));
+			__m128i value = _mm_add_epi8(_mm_sub_epi8(x, base), s); //0..188, no overflow as unsigned
+			__m128i wrap = _mm_cmpeq_epi8(_mm_max_epu8(value, range), value); //value >= 95
+			value = _mm_add_epi8(_mm_sub_epi8(value, _mm_and_si128(wrap, range)), base);
+			__m128i result = _mm_or_si128(_mm_and_si128(printable, value), _mm_andnot_si128(printable, x));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), result);
+
+			keyPosition = (keyPosition + 16) % keyLength;
+		}
+		shiftScalar(in + i, out + i, length - i, shifts, keyLength, keyPosition);
+	}
+
+	__attribute__((target("avx2")))
+	void kernelAvx2(const unsigned char* in, unsigned char* out, size_t length, const unsigned char* shifts, size_t keyLength)
+	{
+		const __m256i low = _mm256_set1_epi8(31);
+		const __m256i high = _mm256_set1_epi8(127);
+		const __m256i base = _mm256_set1_epi8(32);
+		const __m256i range = _mm256_set1_epi8(95);
+
+		size_t keyPosition = 0;
+		size_t i = 0;
+		for (; i + 32 <= length; i += 32)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+			__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(shifts + keyPosition));
+
+			__m256i printable = _mm256_and_si256(_mm256_cmpgt_epi8(x, low), _mm256_cmpgt_epi8(high, x));
+			__m256i value = _mm256_add_epi8(_mm256_sub_epi8(x, base), s);
+			__m256i wrap = _mm256_cmpeq_epi8(_mm256_max_epu8(value, range), value);
+			value = _mm256_add_epi8(_mm256_sub_epi8(value, _mm256_and_si256(wrap, range)), base);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_blendv_epi8(x, value, printable));
+
+			keyPosition = (keyPosition + 32) % keyLength;
+		}
+		shiftScalar(in + i, out + i, length - i, shifts, keyLength, keyPosition);
+	}
+#endif
+
+	Kernel bestKernel()
+	{
+#ifdef VIGENERE_X86
+		if (__builtin_cpu_supports("avx2"))
+		{
+			return kernelAvx2;
+		}
+		if (__builtin_cpu_supports("sse2"))
+		{
+			return kernelSse2;
+		}
+#endif
+		return kernelScalar;
+	}
+}
+
+VigenereCipher::VigenereCipher(const std::string& key) : key(key)
+{
+	if (key.empty())
+	{
+		throw std::invalid_argument("Vigenere key cannot be empty");
+	}
+
+	// unrolled so that shifts[p .. p + 31] exists for every key position p
+	encryptShifts.resize(key.size() + STEP);
+	decryptShifts.resize(key.size() + STEP);
+	for (size_t i = 0; i < encryptShifts.size(); ++i)
+	{
+		char c = key[i % key.size()];
+		if (c < 32 || c > 126)
+		{
+			throw std::invalid_argument("Vigenere key must be printable ASCII");
+		}
+		encryptShifts[i] = static_cast<unsigned char>(c - 32);
+		decryptShifts[i] = static_cast<unsigned char>((95 - (c - 32)) % 95);
+	}
+}
+
+std::string VigenereCipher::apply(const std::string& input, const std::vector<unsigned char>& shifts) const
+{
+	static const Kernel kernel = bestKernel();
+
+	std::string result(input.size(), '\0');
+	if (!input.empty())
+	{
+		kernel(reinterpret_cast<const unsigned char*>(input.data()), reinterpret_cast<unsigned char*>(&result[0]),
+			input.size(), shifts.data(), key.size());
+	}
+	return result;
+}
+
+std::string VigenereCipher::encrypt(const std::string& input)
+{
+	return apply(input, encryptShifts);
+}
+
+std::string VigenereCipher::decrypt(const std::string& input)
+{
+	return apply(input, decryptShifts);
+}
+
+std::string VigenereCipher::serialize() const
+{
+	return "Vigenere " + key;
+}
+
+Cipher* VigenereCipher::clone() const
+{
+	return new VigenereCipher(key);
+}
+
+std::string VigenereCipher::getType() const
+{
+	return "Vigenere";
+}
+
+std::string VigenereCipher::getConfig() const
+{
+	return key;
+}
+
+std::string VigenereCipher::encodeConfig() const
+{
+	return key;
+}
+
+Cipher* VigenereCipher::fromParams(const std::vector<std::string>& params)
+{
+	return new VigenereCipher(params[0]);
+}
+
+Cipher* VigenereCipher::decodeConfig(const std::string& config)
+{
+	return new VigenereCipher(config);
+}